@@ -0,0 +1,161 @@
+// Runs the plugin's per-frame CPU path without Unity or a GPU.
+//
+// The generation pipeline feeds a RenderAPI_Null through the same RenderCommandList and
+// DispatchRenderAPI calls OnFrame makes, one thread playing both Unity's main thread
+// (OnTimeFromUnity) and its render thread. Every uploaded frame is checked against the
+// backend's host copy, so this doubles as a smoke test of the Null backend.
+//
+//   HeadlessHost [frames] [textureSize] [gridSize] [frameIntervalUs]
+//
+// Frames start frameIntervalUs apart, as Unity's would; the workers generate in between.
+// Prints per-frame main and render thread times; RENDERINGPLUGIN_WORKERS and RENDERINGPLUGIN_SIMD
+// apply as they do in the plugin.
+
+#include "PlatformBase.h"
+#include "GenerationPipeline.h"
+#include "RenderAPI.h"
+#include "RenderAPIDispatch.h"
+#include "RenderAPI_Null.h"
+#include "RenderCommandList.h"
+#include "SimdMath.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedUs(Clock::time_point begin, Clock::time_point end)
+{
+	return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+// A flat gridSize x gridSize quad grid, like the plane UseRenderingPlugin.cs hands over
+static void BuildGrid(int gridSize, std::vector<float>* positions, std::vector<float>* uvs)
+{
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			const float u = (float)x / (gridSize - 1);
+			const float v = (float)z / (gridSize - 1);
+			positions->push_back(u * 10.0f - 5.0f);
+			positions->push_back(0.0f);
+			positions->push_back(v * 10.0f - 5.0f);
+			uvs->push_back(u);
+			uvs->push_back(v);
+		}
+	}
+}
+
+static bool MatchesFrame(const RenderAPI_Null& api, void* texture, void* vertexBuffer, const GeneratedFrame& frame)
+{
+	const unsigned char* pixels = api.GetTextureData(texture);
+	const int rowPitch = api.GetTextureRowPitch(texture);
+	const size_t rowBytes = (size_t)frame.textureWidth * 4;
+	for (int y = 0; y < frame.textureHeight; ++y)
+	{
+		if (memcmp(pixels + (size_t)y * rowPitch, frame.texture + y * rowBytes, rowBytes) != 0)
+			return false;
+	}
+	return memcmp(api.GetVertexBufferData(vertexBuffer), frame.vertices, (size_t)frame.vertexCount * sizeof(MeshVertex)) == 0;
+}
+
+static double Percentile(std::vector<double> samples, double fraction)
+{
+	if (samples.empty())
+		return 0.0;
+	std::sort(samples.begin(), samples.end());
+	return samples[(size_t)(fraction * (samples.size() - 1))];
+}
+
+int main(int argc, char** argv)
+{
+	const int frameCount = argc > 1 ? atoi(argv[1]) : 600;
+	const int textureSize = argc > 2 ? atoi(argv[2]) : 256;
+	const int gridSize = argc > 3 ? atoi(argv[3]) : 64;
+	const int frameIntervalUs = argc > 4 ? atoi(argv[4]) : 4000;
+	if (frameCount <= 0 || textureSize <= 0 || gridSize < 2 || frameIntervalUs < 0)
+	{
+		fprintf(stderr, "usage: %s [frames] [textureSize] [gridSize] [frameIntervalUs]\n", argv[0]);
+		return 2;
+	}
+
+	// What OnGraphicsDeviceEvent gets for Unity's null device
+	std::unique_ptr<RenderAPI> api(CreateRenderAPI(kUnityGfxRendererNull));
+	RenderAPI_Null* nullApi = static_cast<RenderAPI_Null*>(api.get());
+	api->ProcessDeviceEvent(kUnityGfxDeviceEventInitialize, NULL);
+
+	const int vertexCount = gridSize * gridSize;
+	void* texture = nullApi->CreateTexture(textureSize, textureSize);
+	void* vertexBuffer = nullApi->CreateVertexBuffer((size_t)vertexCount * sizeof(MeshVertex));
+
+	WorkerPool pool;
+	GenerationPipeline pipeline(&pool);
+	std::vector<float> positions, uvs;
+	BuildGrid(gridSize, &positions, &uvs);
+	pipeline.SetTextureSize(textureSize, textureSize);
+	pipeline.SetMeshSource(vertexCount, positions.data(), uvs.data());
+
+	RenderCommandList commands;
+	std::vector<double> feedUs, renderUs;
+	int uploadedFrames = 0;
+	int mismatches = 0;
+	const Clock::time_point start = Clock::now();
+	for (int i = 0; i < frameCount; ++i)
+	{
+		std::this_thread::sleep_until(start + std::chrono::microseconds((long long)i * frameIntervalUs));
+
+		// Main thread: SetTimeFromUnity
+		const Clock::time_point feedBegin = Clock::now();
+		pipeline.OnTimeFromUnity(i / 60.0f);
+		feedUs.push_back(ElapsedUs(feedBegin, Clock::now()));
+
+		// Render thread: the uploads half of OnFrame
+		const Clock::time_point renderBegin = Clock::now();
+		const GeneratedFrame* frame = pipeline.AcquireLatest();
+		if (frame)
+		{
+			commands.Reset();
+			commands.UploadTexture(texture, frame->textureWidth, frame->textureHeight, frame->textureWidth * 4, frame->texture);
+			commands.UploadVertexBuffer(vertexBuffer, (size_t)frame->vertexCount * sizeof(MeshVertex), frame->vertices);
+			DispatchRenderAPI(api.get(), [&](auto* backend) {
+				backend->ExecuteCommandList(commands);
+			});
+		}
+		renderUs.push_back(ElapsedUs(renderBegin, Clock::now()));
+
+		if (frame)
+		{
+			++uploadedFrames;
+			if (!MatchesFrame(*nullApi, texture, vertexBuffer, *frame))
+				++mismatches;
+			pipeline.Release(frame);
+		}
+	}
+	const double totalMs = ElapsedUs(start, Clock::now()) / 1000.0;
+
+	const RenderAPI_Null::Counters& counters = nullApi->GetCounters();
+	printf("workers %d, simd %s, texture %dx%d, %d vertices, frames %d us apart\n",
+		pool.GetThreadCount(), GetSimdLevelName(GetSimdLevel()), textureSize, textureSize, vertexCount, frameIntervalUs);
+	printf("%d frames in %.1f ms, %d with a new generated frame\n", frameCount, totalMs, uploadedFrames);
+	printf("feed   (us): p50 %8.1f  p99 %8.1f\n", Percentile(feedUs, 0.5), Percentile(feedUs, 0.99));
+	printf("render (us): p50 %8.1f  p99 %8.1f\n", Percentile(renderUs, 0.5), Percentile(renderUs, 0.99));
+	printf("uploads: %llu texture (%llu bytes), %llu vertex buffer (%llu bytes), %llu failed maps\n",
+		counters.textureUploads, counters.textureBytes, counters.vertexBufferUploads, counters.vertexBufferBytes, counters.failedMaps);
+
+	api->ProcessDeviceEvent(kUnityGfxDeviceEventShutdown, NULL);
+	if (mismatches || counters.failedMaps || (unsigned long long)uploadedFrames != counters.textureUploads)
+	{
+		printf("FAILED: %d frames differ from the backend's copy\n", mismatches);
+		return 1;
+	}
+	return 0;
+}
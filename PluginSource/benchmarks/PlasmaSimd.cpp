@@ -0,0 +1,66 @@
+// Single-threaded cost of the plasma fill: GeneratePlasmaRows at the SIMD level the plugin
+// would pick against GeneratePlasmaRows_Scalar, the original formulation, on the same
+// frames. Also reports the largest difference between the two outputs.
+//
+//   PlasmaSimd [textureSize] [frames]
+//
+// RENDERINGPLUGIN_SIMD (scalar, sse41, avx2, avx512) caps the level as it does in the
+// plugin; "make run" goes through all of them.
+
+#include "PlasmaKernel.h"
+#include "SimdMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+static double Median(std::vector<double> samples)
+{
+	std::sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+	const int size = argc > 1 ? atoi(argv[1]) : 2048;
+	const int frames = argc > 2 ? atoi(argv[2]) : 20;
+	if (size <= 0 || frames <= 0)
+	{
+		fprintf(stderr, "usage: %s [textureSize] [frames]\n", argv[0]);
+		return 2;
+	}
+
+	const int rowPitch = size * 4;
+	std::vector<unsigned char> reference((size_t)rowPitch * size);
+	std::vector<unsigned char> vectorized((size_t)rowPitch * size);
+	std::vector<double> scalarMs, vectorizedMs;
+	int maxDifference = 0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		const float t = frame * 0.016f * 4.0f;
+
+		Clock::time_point begin = Clock::now();
+		GeneratePlasmaRows_Scalar(reference.data(), size, 0, size, rowPitch, t);
+		scalarMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+
+		begin = Clock::now();
+		GeneratePlasmaRows(vectorized.data(), size, 0, size, rowPitch, t);
+		vectorizedMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+
+		for (size_t i = 0; i < reference.size(); ++i)
+			maxDifference = std::max(maxDifference, abs((int)reference[i] - (int)vectorized[i]));
+	}
+
+	const double scalar = Median(scalarMs);
+	const double simd = Median(vectorizedMs);
+	printf("%dx%d, %d frames, median per frame: scalar %.2f ms, %s %.2f ms, %.1fx, max difference %d\n",
+		size, size, frames, scalar, GetSimdLevelName(GetSimdLevel()), simd, scalar / simd, maxDifference);
+
+	// The kernel promises one step of 8-bit output at most
+	return maxDifference > 1 ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+// Cost of calling a backend through the RenderAPI vtable against DispatchRenderAPI, which
+// casts to the final backend class once per batch. The backend is RenderAPI_Null from
+// CreateRenderAPI, so the compiler can't see through the pointer on the virtual path; a
+// batch is BeginModifyVertexBuffer, a one-byte write and EndModifyVertexBuffer.
+//
+//   VirtualDispatch [batches]
+//
+// The calls land in RenderAPI_Null.cpp, so they only inline with link-time optimization:
+// "make LTO=1" builds everything with -flto.
+
+#include "PlatformBase.h"
+#include "RenderAPI.h"
+#include "RenderAPIDispatch.h"
+#include "RenderAPI_Null.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const int kRounds = 15;
+
+// One Begin/write/End batch; Api is RenderAPI on the virtual path, RenderAPI_Null otherwise
+template<typename Api>
+static inline void UpdateBuffer(Api* api, void* buffer, int value)
+{
+	size_t size = 0;
+	if (unsigned char* data = static_cast<unsigned char*>(api->BeginModifyVertexBuffer(buffer, &size)))
+	{
+		data[0] = (unsigned char)value;
+		api->EndModifyVertexBuffer(buffer);
+	}
+}
+
+static double Median(std::vector<double> samples)
+{
+	std::sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+	const int batches = argc > 1 ? atoi(argv[1]) : 1000000;
+	if (batches <= 0)
+	{
+		fprintf(stderr, "usage: %s [batches]\n", argv[0]);
+		return 2;
+	}
+
+	std::unique_ptr<RenderAPI> api(CreateRenderAPI(kUnityGfxRendererNull));
+	api->ProcessDeviceEvent(kUnityGfxDeviceEventInitialize, NULL);
+	void* buffer = static_cast<RenderAPI_Null*>(api.get())->CreateVertexBuffer(64);
+
+	// Alternate the two so frequency changes hit both alike
+	std::vector<double> virtualNs, dispatchNs;
+	for (int round = 0; round < kRounds; ++round)
+	{
+		Clock::time_point begin = Clock::now();
+		for (int i = 0; i < batches; ++i)
+			UpdateBuffer(api.get(), buffer, i);
+		virtualNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / batches);
+
+		begin = Clock::now();
+		for (int i = 0; i < batches; ++i)
+		{
+			DispatchRenderAPI(api.get(), [&](auto* backend) {
+				UpdateBuffer(backend, buffer, i);
+			});
+		}
+		dispatchNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / batches);
+	}
+
+	printf("%d batches x %d rounds, median per batch: virtual %.2f ns, DispatchRenderAPI %.2f ns\n",
+		batches, kRounds, Median(virtualNs), Median(dispatchNs));
+
+	const unsigned long long uploads = static_cast<RenderAPI_Null*>(api.get())->GetCounters().vertexBufferUploads;
+	const unsigned long long expected = (unsigned long long)batches * kRounds * 2;
+	api->ProcessDeviceEvent(kUnityGfxDeviceEventShutdown, NULL);
+	if (uploads != expected)
+	{
+		printf("FAILED: %llu uploads, expected %llu\n", uploads, expected);
+		return 1;
+	}
+	return 0;
+}
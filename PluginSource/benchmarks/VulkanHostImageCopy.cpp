@@ -0,0 +1,428 @@
+// Texture upload cost of the two paths RenderAPI_Vulkan takes, on whatever Vulkan driver the
+// loader picks (point VK_DRIVER_FILES at lavapipe's ICD json to run it without a GPU):
+//
+//   staging: memcpy into a mapped staging buffer, record barrier + vkCmdCopyBufferToImage +
+//            barrier, submit (CopyStagingToTexture)
+//   host:    a new image per upload, moved out of UNDEFINED with vkTransitionImageLayoutEXT
+//            and written with vkCopyMemoryToImageEXT (HostCopyToTexture with
+//            kUnityVulkanResourceAccess_Recreate); old images are kept for kFramesInFlight
+//
+//   VulkanHostImageCopy [frames] [textureSize]
+//
+// Times are CPU time per upload on the calling thread. The staging path also waits for its
+// submission each frame so both paths end with the texels in the image. The host path is
+// skipped when the device has no VK_EXT_host_image_copy. Needs the Vulkan SDK; not part of
+// "make all".
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const int kFramesInFlight = 3;
+static const VkFormat kFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+#define VK_CHECK(call) do { VkResult checkResult_ = (call); if (checkResult_ != VK_SUCCESS) { \
+	fprintf(stderr, "%s failed: %d\n", #call, (int)checkResult_); exit(1); } } while (0)
+
+struct Context
+{
+	VkInstance instance;
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	uint32_t queueFamily;
+	VkQueue queue;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	bool hostImageCopy;
+	VkImageLayout hostCopyLayout;
+	PFN_vkTransitionImageLayoutEXT transitionImageLayout;
+	PFN_vkCopyMemoryToImageEXT copyMemoryToImage;
+	PFN_vkCopyImageToMemoryEXT copyImageToMemory;
+};
+
+struct Image
+{
+	VkImage image;
+	VkDeviceMemory memory;
+};
+
+static double Percentile(std::vector<double> samples, double fraction)
+{
+	if (samples.empty())
+		return 0.0;
+	std::sort(samples.begin(), samples.end());
+	return samples[(size_t)(fraction * (samples.size() - 1))];
+}
+
+static uint32_t FindMemoryType(const Context& ctx, uint32_t typeBits, VkMemoryPropertyFlags flags)
+{
+	for (uint32_t i = 0; i < ctx.memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeBits & (1u << i)) && (ctx.memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+			return i;
+	}
+	fprintf(stderr, "no memory type with flags 0x%x\n", flags);
+	exit(1);
+}
+
+static bool HasDeviceExtension(VkPhysicalDevice physicalDevice, const char* name)
+{
+	uint32_t count = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, NULL);
+	std::vector<VkExtensionProperties> extensions(count);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, extensions.data());
+	for (const VkExtensionProperties& extension : extensions)
+	{
+		if (strcmp(extension.extensionName, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void CreateContext(Context* ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "VulkanHostImageCopy";
+	appInfo.apiVersion = VK_API_VERSION_1_3;
+	VkInstanceCreateInfo instanceInfo = {};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+	VK_CHECK(vkCreateInstance(&instanceInfo, NULL, &ctx->instance));
+
+	uint32_t count = 1;
+	VkResult result = vkEnumeratePhysicalDevices(ctx->instance, &count, &ctx->physicalDevice);
+	if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || count == 0)
+	{
+		fprintf(stderr, "no Vulkan device\n");
+		exit(1);
+	}
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(ctx->physicalDevice, &properties);
+	vkGetPhysicalDeviceMemoryProperties(ctx->physicalDevice, &ctx->memoryProperties);
+	printf("device: %s (Vulkan %u.%u)\n", properties.deviceName, VK_API_VERSION_MAJOR(properties.apiVersion), VK_API_VERSION_MINOR(properties.apiVersion));
+
+	count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(ctx->physicalDevice, &count, NULL);
+	std::vector<VkQueueFamilyProperties> families(count);
+	vkGetPhysicalDeviceQueueFamilyProperties(ctx->physicalDevice, &count, families.data());
+	ctx->queueFamily = 0;
+	while (ctx->queueFamily < count && !(families[ctx->queueFamily].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+		++ctx->queueFamily;
+
+	// Same feature checks Hook_vkCreateDevice does before enabling the extension
+	VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures = {};
+	hostImageCopyFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+	std::vector<const char*> extensions;
+	if (properties.apiVersion >= VK_API_VERSION_1_3 && HasDeviceExtension(ctx->physicalDevice, VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceFeatures2 features = {};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &hostImageCopyFeatures;
+		vkGetPhysicalDeviceFeatures2(ctx->physicalDevice, &features);
+		ctx->hostImageCopy = hostImageCopyFeatures.hostImageCopy == VK_TRUE;
+	}
+	if (ctx->hostImageCopy)
+		extensions.push_back(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+
+	const float priority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo = {};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = ctx->queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &priority;
+	VkDeviceCreateInfo deviceInfo = {};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.pNext = ctx->hostImageCopy ? &hostImageCopyFeatures : NULL;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	deviceInfo.enabledExtensionCount = (uint32_t)extensions.size();
+	deviceInfo.ppEnabledExtensionNames = extensions.data();
+	VK_CHECK(vkCreateDevice(ctx->physicalDevice, &deviceInfo, NULL, &ctx->device));
+	vkGetDeviceQueue(ctx->device, ctx->queueFamily, 0, &ctx->queue);
+	if (!ctx->hostImageCopy)
+		return;
+
+	ctx->transitionImageLayout = (PFN_vkTransitionImageLayoutEXT)vkGetDeviceProcAddr(ctx->device, "vkTransitionImageLayoutEXT");
+	ctx->copyMemoryToImage = (PFN_vkCopyMemoryToImageEXT)vkGetDeviceProcAddr(ctx->device, "vkCopyMemoryToImageEXT");
+	ctx->copyImageToMemory = (PFN_vkCopyImageToMemoryEXT)vkGetDeviceProcAddr(ctx->device, "vkCopyImageToMemoryEXT");
+
+	// Prefer the layout the texture is sampled in, like ChooseHostImageCopyDstLayout
+	VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties = {};
+	hostImageCopyProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties2 = {};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &hostImageCopyProperties;
+	vkGetPhysicalDeviceProperties2(ctx->physicalDevice, &properties2);
+	std::vector<VkImageLayout> layouts(hostImageCopyProperties.copyDstLayoutCount);
+	hostImageCopyProperties.pCopyDstLayouts = layouts.data();
+	vkGetPhysicalDeviceProperties2(ctx->physicalDevice, &properties2);
+	ctx->hostCopyLayout = VK_IMAGE_LAYOUT_GENERAL;
+	for (VkImageLayout layout : layouts)
+	{
+		if (layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+			ctx->hostCopyLayout = layout;
+	}
+}
+
+static Image CreateImage(const Context& ctx, int size, VkImageUsageFlags usage)
+{
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = kFormat;
+	imageInfo.extent.width = size;
+	imageInfo.extent.height = size;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	Image image;
+	VK_CHECK(vkCreateImage(ctx.device, &imageInfo, NULL, &image.image));
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(ctx.device, image.image, &requirements);
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(ctx, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VK_CHECK(vkAllocateMemory(ctx.device, &allocInfo, NULL, &image.memory));
+	VK_CHECK(vkBindImageMemory(ctx.device, image.image, image.memory, 0));
+	return image;
+}
+
+static void DestroyImage(const Context& ctx, const Image& image)
+{
+	vkDestroyImage(ctx.device, image.image, NULL);
+	vkFreeMemory(ctx.device, image.memory, NULL);
+}
+
+static void FillPixels(std::vector<unsigned char>* pixels, int frame)
+{
+	for (size_t i = 0; i < pixels->size(); ++i)
+		(*pixels)[i] = (unsigned char)(i * 7 + frame);
+}
+
+static void Report(const char* name, const std::vector<double>& samples, int size)
+{
+	const double megabytes = (double)size * size * 4 / (1024.0 * 1024.0);
+	const double p50 = Percentile(samples, 0.5);
+	printf("%-8s p50 %8.1f us  p99 %8.1f us  (%.0f MB/s at p50)\n", name, p50, Percentile(samples, 0.99), megabytes / (p50 / 1e6));
+}
+
+static std::vector<double> RunStaging(const Context& ctx, int frames, int size, std::vector<unsigned char>* pixels)
+{
+	const VkDeviceSize bytes = (VkDeviceSize)size * size * 4;
+	Image image = CreateImage(ctx, size, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = bytes;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	VkBuffer staging;
+	VK_CHECK(vkCreateBuffer(ctx.device, &bufferInfo, NULL, &staging));
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(ctx.device, staging, &requirements);
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(ctx, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	VkDeviceMemory stagingMemory;
+	VK_CHECK(vkAllocateMemory(ctx.device, &allocInfo, NULL, &stagingMemory));
+	VK_CHECK(vkBindBufferMemory(ctx.device, staging, stagingMemory, 0));
+	void* mapped;
+	VK_CHECK(vkMapMemory(ctx.device, stagingMemory, 0, bytes, 0, &mapped));
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = ctx.queueFamily;
+	VkCommandPool pool;
+	VK_CHECK(vkCreateCommandPool(ctx.device, &poolInfo, NULL, &pool));
+	VkCommandBufferAllocateInfo commandInfo = {};
+	commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandInfo.commandPool = pool;
+	commandInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandInfo.commandBufferCount = 1;
+	VkCommandBuffer commandBuffer;
+	VK_CHECK(vkAllocateCommandBuffers(ctx.device, &commandInfo, &commandBuffer));
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	VK_CHECK(vkCreateFence(ctx.device, &fenceInfo, NULL, &fence));
+
+	std::vector<double> samples;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		FillPixels(pixels, frame);
+		const Clock::time_point begin = Clock::now();
+		memcpy(mapped, pixels->data(), bytes);
+
+		VK_CHECK(vkResetCommandPool(ctx.device, pool, 0));
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image.image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = 1;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+		VkBufferImageCopy region = {};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent.width = size;
+		region.imageExtent.height = size;
+		region.imageExtent.depth = 1;
+		vkCmdCopyBufferToImage(commandBuffer, staging, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+		VK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		VK_CHECK(vkQueueSubmit(ctx.queue, 1, &submitInfo, fence));
+		VK_CHECK(vkWaitForFences(ctx.device, 1, &fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK(vkResetFences(ctx.device, 1, &fence));
+		samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+	}
+
+	vkDestroyFence(ctx.device, fence, NULL);
+	vkDestroyCommandPool(ctx.device, pool, NULL);
+	vkDestroyBuffer(ctx.device, staging, NULL);
+	vkFreeMemory(ctx.device, stagingMemory, NULL);
+	DestroyImage(ctx, image);
+	return samples;
+}
+
+static std::vector<double> RunHostCopy(const Context& ctx, int frames, int size, std::vector<unsigned char>* pixels, bool* outMatches)
+{
+	std::deque<Image> inFlight;
+	std::vector<double> samples;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		FillPixels(pixels, frame);
+		const Clock::time_point begin = Clock::now();
+		Image image = CreateImage(ctx, size, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT);
+
+		VkHostImageLayoutTransitionInfoEXT transition = {};
+		transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+		transition.image = image.image;
+		transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		transition.newLayout = ctx.hostCopyLayout;
+		transition.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		transition.subresourceRange.levelCount = 1;
+		transition.subresourceRange.layerCount = 1;
+		VK_CHECK(ctx.transitionImageLayout(ctx.device, 1, &transition));
+
+		VkMemoryToImageCopyEXT region = {};
+		region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+		region.pHostPointer = pixels->data();
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent.width = size;
+		region.imageExtent.height = size;
+		region.imageExtent.depth = 1;
+		VkCopyMemoryToImageInfoEXT copyInfo = {};
+		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+		copyInfo.dstImage = image.image;
+		copyInfo.dstImageLayout = ctx.hostCopyLayout;
+		copyInfo.regionCount = 1;
+		copyInfo.pRegions = &region;
+		VK_CHECK(ctx.copyMemoryToImage(ctx.device, &copyInfo));
+
+		// What Unity does with the image it replaced once the frames sampling it retired
+		inFlight.push_back(image);
+		if ((int)inFlight.size() > kFramesInFlight)
+		{
+			DestroyImage(ctx, inFlight.front());
+			inFlight.pop_front();
+		}
+		samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+	}
+
+	// The last upload has to read back as written
+	std::vector<unsigned char> readback(pixels->size());
+	VkImageToMemoryCopyEXT region = {};
+	region.sType = VK_STRUCTURE_TYPE_IMAGE_TO_MEMORY_COPY_EXT;
+	region.pHostPointer = readback.data();
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent.width = size;
+	region.imageExtent.height = size;
+	region.imageExtent.depth = 1;
+	VkCopyImageToMemoryInfoEXT copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_TO_MEMORY_INFO_EXT;
+	copyInfo.srcImage = inFlight.back().image;
+	copyInfo.srcImageLayout = ctx.hostCopyLayout;
+	copyInfo.regionCount = 1;
+	copyInfo.pRegions = &region;
+	*outMatches = ctx.copyImageToMemory(ctx.device, &copyInfo) == VK_SUCCESS && readback == *pixels;
+
+	for (const Image& image : inFlight)
+		DestroyImage(ctx, image);
+	return samples;
+}
+
+int main(int argc, char** argv)
+{
+	const int frames = argc > 1 ? atoi(argv[1]) : 200;
+	const int size = argc > 2 ? atoi(argv[2]) : 1024;
+	if (frames <= 0 || size <= 0)
+	{
+		fprintf(stderr, "usage: %s [frames] [textureSize]\n", argv[0]);
+		return 2;
+	}
+
+	Context ctx;
+	CreateContext(&ctx);
+	printf("%d uploads of a %dx%d RGBA8 texture\n", frames, size, size);
+
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	Report("staging", RunStaging(ctx, frames, size, &pixels), size);
+
+	int status = 0;
+	if (ctx.hostImageCopy)
+	{
+		bool matches = false;
+		Report("host", RunHostCopy(ctx, frames, size, &pixels, &matches), size);
+		if (!matches)
+		{
+			printf("FAILED: host copy read back different texels\n");
+			status = 1;
+		}
+	}
+	else
+	{
+		printf("host     skipped, no VK_EXT_host_image_copy\n");
+	}
+
+	vkDestroyDevice(ctx.device, NULL);
+	vkDestroyInstance(ctx.instance, NULL);
+	return status;
+}
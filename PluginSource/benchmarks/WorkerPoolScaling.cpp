@@ -0,0 +1,109 @@
+// How the plasma fill scales with the worker pool: the texture split into the same row
+// tiles GenerationPipeline uses, run with ParallelFor on pools of 1, 2, 4... threads up to
+// maxThreads, against one call on the calling thread. Also times an empty ParallelFor, the
+// pool's fixed cost per job.
+//
+//   WorkerPoolScaling [textureSize] [frames] [maxThreads]
+//
+// maxThreads defaults to hardware_concurrency. Counts above the core count only measure
+// the pool's overhead.
+
+#include "PlasmaKernel.h"
+#include "SimdMath.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+struct FillContext
+{
+	unsigned char* pixels;
+	int size;
+	int tileRows;
+	float t;
+};
+
+static void FillTiles(void* context, int begin, int end)
+{
+	const FillContext* fill = static_cast<const FillContext*>(context);
+	for (int tile = begin; tile < end; ++tile)
+	{
+		const int rowBegin = tile * fill->tileRows;
+		const int rowEnd = std::min(rowBegin + fill->tileRows, fill->size);
+		GeneratePlasmaRows(fill->pixels, fill->size, rowBegin, rowEnd, fill->size * 4, fill->t);
+	}
+}
+
+static void EmptyTiles(void*, int, int)
+{
+}
+
+static double Median(std::vector<double> samples)
+{
+	std::sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+	const int size = argc > 1 ? atoi(argv[1]) : 2048;
+	const int frames = argc > 2 ? atoi(argv[2]) : 20;
+	const int maxThreads = argc > 3 ? atoi(argv[3]) : std::max(1, (int)std::thread::hardware_concurrency());
+	if (size <= 0 || frames <= 0 || maxThreads <= 0)
+	{
+		fprintf(stderr, "usage: %s [textureSize] [frames] [maxThreads]\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<unsigned char> pixels((size_t)size * 4 * size);
+	std::vector<double> samples;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		const Clock::time_point begin = Clock::now();
+		GeneratePlasmaRows(pixels.data(), size, 0, size, size * 4, frame * 0.064f);
+		samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+	}
+	const double direct = Median(samples);
+	printf("%dx%d, %s, %u hardware threads, median per frame\n", size, size,
+		GetSimdLevelName(GetSimdLevel()), std::thread::hardware_concurrency());
+	printf("calling thread: %8.2f ms\n", direct);
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		WorkerPool pool(threads);
+		FillContext fill;
+		fill.pixels = pixels.data();
+		fill.size = size;
+		fill.tileRows = pool.GetRowTileGrain(size, size * 4);
+		const int tiles = (size + fill.tileRows - 1) / fill.tileRows;
+
+		samples.clear();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			fill.t = frame * 0.064f;
+			const Clock::time_point begin = Clock::now();
+			pool.ParallelFor(tiles, 1, FillTiles, &fill);
+			samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+		}
+		const double filled = Median(samples);
+
+		samples.clear();
+		for (int i = 0; i < 1000; ++i)
+		{
+			const Clock::time_point begin = Clock::now();
+			pool.ParallelFor(tiles, 1, EmptyTiles, NULL);
+			samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+		}
+
+		printf("%2d workers:     %8.2f ms  %5.2fx  (%d tiles of %d rows, empty job %.1f us)\n",
+			threads, filled, direct / filled, tiles, fill.tileRows, Median(samples));
+	}
+	return 0;
+}
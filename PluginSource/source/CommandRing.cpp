@@ -0,0 +1,70 @@
+#include "CommandRing.h"
+
+#include <iostream>
+#include <new>
+#include <string.h>
+
+static_assert(offsetof(CommandRingShared, writePosition) == 64, "layout is shared with UseRenderingPlugin.cs");
+static_assert(offsetof(CommandRingShared, readPosition) == 128, "layout is shared with UseRenderingPlugin.cs");
+static_assert(offsetof(CommandRingShared, data) == 192, "layout is shared with UseRenderingPlugin.cs");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "the script stores positions as plain uint32");
+
+static const size_t kSharedAlignment = 64;
+
+CommandRing::CommandRing(uint32_t capacity)
+{
+	// Power of two, so a position maps to an offset with a mask
+	uint32_t roundedCapacity = 64;
+	while (roundedCapacity < capacity)
+		roundedCapacity <<= 1;
+
+	m_SharedSize = offsetof(CommandRingShared, data) + roundedCapacity;
+	void* memory = ::operator new(m_SharedSize, std::align_val_t(kSharedAlignment));
+	memset(memory, 0, m_SharedSize);
+	m_Shared = new (memory) CommandRingShared;
+	m_Shared->capacity = roundedCapacity;
+	m_Shared->writePosition.store(0, std::memory_order_relaxed);
+	m_Shared->readPosition.store(0, std::memory_order_relaxed);
+}
+
+CommandRing::~CommandRing()
+{
+	m_Shared->~CommandRingShared();
+	::operator delete(m_Shared, std::align_val_t(kSharedAlignment));
+}
+
+int CommandRing::Drain(PluginCommandFunc func)
+{
+	const uint32_t capacity = m_Shared->capacity;
+	uint32_t read = m_Shared->readPosition.load(std::memory_order_relaxed);
+	// Pairs with the script's barrier before it stores the write position
+	const uint32_t write = m_Shared->writePosition.load(std::memory_order_acquire);
+
+	int commandCount = 0;
+	while (read != write)
+	{
+		const uint32_t offset = read & (capacity - 1);
+		const PluginCommandHeader* command = reinterpret_cast<const PluginCommandHeader*>(m_Shared->data + offset);
+
+		// A command the script got wrong would send us past what it published; drop the rest
+		const uint32_t size = command->size;
+		if (size < sizeof(PluginCommandHeader) || (size & 7) != 0 || size > write - read || size > capacity - offset)
+		{
+			std::cout << "CommandRing: malformed command (type " << command->type << ", size " << size
+				<< "), dropping " << (write - read) << " bytes" << std::endl;
+			read = write;
+			break;
+		}
+
+		if (command->type != kPluginCommand_Padding)
+		{
+			func(command);
+			++commandCount;
+		}
+		read += size;
+	}
+
+	// The script may reuse the space (and unpin mesh arrays) once it sees this
+	m_Shared->readPosition.store(read, std::memory_order_release);
+	return commandCount;
+}
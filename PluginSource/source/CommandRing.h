@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Commands the script writes into the ring; mirrored in UseRenderingPlugin.cs.
+// Every command starts with a PluginCommandHeader and is a multiple of 8 bytes.
+enum PluginCommandType
+{
+	kPluginCommand_Padding = 0, // fills the end of the ring when the next command doesn't fit there
+	kPluginCommand_SetTime = 1,
+	kPluginCommand_SetTexture = 2,
+	kPluginCommand_SetMeshBuffers = 3,
+	kPluginCommand_DestroyExternalImage = 4,
+	kPluginCommand_SetGenerateMips = 5,
+	kPluginCommand_SetUploadArena = 6,
+};
+
+struct PluginCommandHeader
+{
+	uint32_t type;
+	uint32_t size; // whole command in bytes, header included
+};
+
+struct PluginCommand_SetTime
+{
+	PluginCommandHeader header;
+	float time;
+	uint32_t padding;
+};
+
+struct PluginCommand_SetTexture
+{
+	PluginCommandHeader header;
+	uint64_t textureHandle;
+	int32_t width;
+	int32_t height;
+};
+
+// The arrays stay pinned by the script until ring's read position has passed this command
+struct PluginCommand_SetMeshBuffers
+{
+	PluginCommandHeader header;
+	uint64_t vertexBufferHandle;
+	uint64_t positions;
+	uint64_t normals;
+	uint64_t uvs;
+	int32_t vertexCount;
+	uint32_t padding;
+};
+
+struct PluginCommand_DestroyExternalImage
+{
+	PluginCommandHeader header;
+	uint32_t handle; // from CreateExternalImage
+	uint32_t padding;
+};
+
+// Texture uploads from then on rebuild the texture's mip chain on the GPU, see
+// RenderAPI::SetGenerateMipsOnUpload
+struct PluginCommand_SetGenerateMips
+{
+	PluginCommandHeader header;
+	int32_t enabled;
+	uint32_t padding;
+};
+
+// Host memory the generated frames are written into and uploaded from, see
+// RenderAPI::RegisterHostMemory; memory 0 takes the arena back. The memory is page aligned
+// and stays allocated until a kPluginEvent_Flush issued after memory 0 has completed.
+struct PluginCommand_SetUploadArena
+{
+	PluginCommandHeader header;
+	uint64_t memory;
+	uint64_t size;
+};
+
+// Layout of the memory shared with the script, which maps it as a NativeArray<byte>:
+//   [0, 4)       capacity of the data area in bytes, a power of two
+//   [64, 68)     write position, only the script stores it
+//   [128, 132)   read position, only the render thread stores it
+//   [192, ...)   command data
+// Positions are free-running byte counts; a command lives at position & (capacity - 1).
+struct CommandRingShared
+{
+	uint32_t capacity;
+	alignas(64) std::atomic<uint32_t> writePosition;
+	alignas(64) std::atomic<uint32_t> readPosition;
+	alignas(64) unsigned char data[1];
+};
+
+typedef void (*PluginCommandFunc)(const PluginCommandHeader* command);
+
+// Single-producer, single-consumer command ring between the script (producer, main
+// thread) and the render thread (consumer). The script appends a frame's commands with
+// plain stores into the NativeArray, then publishes them by storing the write position
+// after a memory barrier; one render event drains them all. No locks and no managed-to-
+// native transition per command.
+class CommandRing
+{
+public:
+	explicit CommandRing(uint32_t capacity);
+	~CommandRing();
+
+	void* GetSharedMemory() const { return m_Shared; }
+	size_t GetSharedMemorySize() const { return m_SharedSize; }
+
+	// Render thread: calls func for every published command, in order, and hands the
+	// space back. Returns the number of commands run.
+	int Drain(PluginCommandFunc func);
+
+private:
+	CommandRingShared* m_Shared;
+	size_t m_SharedSize;
+};
@@ -0,0 +1,279 @@
+#include "GenerationPipeline.h"
+#include "PlasmaKernel.h"
+
+GenerationPipeline::GenerationPipeline(WorkerPool* pool)
+	: m_Pool(pool)
+	, m_SafeGpuFrame(0)
+	, m_TextureWidth(0)
+	, m_TextureHeight(0)
+	, m_Arena(NULL)
+	, m_ArenaSize(0)
+	, m_LastTime(0.0f)
+	, m_HasLastTime(false)
+	, m_NextSequence(0)
+	, m_GeneratingSlot(NULL)
+{
+	for (Slot& slot : m_Slots)
+	{
+		slot.owner = this;
+		slot.frame.time = 0.0f;
+		slot.frame.textureWidth = 0;
+		slot.frame.textureHeight = 0;
+		slot.frame.texture = NULL;
+		slot.frame.vertices = NULL;
+		slot.frame.vertexCount = 0;
+		slot.state = kSlot_Free;
+		slot.arenaRegion = -1;
+		slot.sequence = 0;
+		slot.textureTiles = 0;
+		slot.tileRows = 1;
+		slot.tileVertices = 1;
+	}
+	for (ArenaRegion& region : m_ArenaRegions)
+	{
+		region.inUse = false;
+		region.lastUseFrame = 0;
+	}
+}
+
+GenerationPipeline::~GenerationPipeline()
+{
+	// The workers write into our slots
+	WaitForGeneration();
+}
+
+void GenerationPipeline::WaitForGeneration()
+{
+	if (m_GeneratingSlot)
+	{
+		m_Pool->Wait(&m_GeneratingSlot->job);
+		m_GeneratingSlot = NULL;
+	}
+}
+
+void GenerationPipeline::SetTextureSize(int width, int height)
+{
+	WaitForGeneration();
+	m_TextureWidth = width;
+	m_TextureHeight = height;
+}
+
+void GenerationPipeline::SetMeshSource(int vertexCount, const float* positions, const float* uvs)
+{
+	WaitForGeneration();
+	BuildHeightfieldSource(&m_MeshSource, vertexCount, positions, uvs);
+}
+
+void GenerationPipeline::SetUploadArena(void* base, size_t size)
+{
+	WaitForGeneration();
+	m_Arena = base ? static_cast<unsigned char*>(base) : NULL;
+	m_ArenaSize = base ? size : 0;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (Slot& slot : m_Slots)
+	{
+		if (slot.arenaRegion < 0)
+			continue;
+		// Nothing reads these again; a frame being copied keeps its pointers but no longer
+		// holds a region of the new arena
+		if (slot.state == kSlot_Ready)
+			slot.state = kSlot_Free;
+		slot.arenaRegion = -1;
+	}
+	for (ArenaRegion& region : m_ArenaRegions)
+	{
+		region.inUse = false;
+		region.lastUseFrame = 0;
+	}
+}
+
+// Points the slot's frame at an arena region the GPU is done with if one fits the current
+// inputs, else at the slot's own storage
+void GenerationPipeline::AssignStorage(Slot* slot)
+{
+	GeneratedFrame& frame = slot->frame;
+	const size_t textureBytes = (size_t)m_TextureWidth * 4 * m_TextureHeight;
+	const size_t vertexBytes = (size_t)m_MeshSource.vertexCount * sizeof(MeshVertex);
+
+	// Texture first, vertices after it; regions and the vertices start on cache lines
+	const size_t vertexOffset = (textureBytes + 63) & ~size_t(63);
+	const size_t regionSize = (vertexOffset + vertexBytes + 63) & ~size_t(63);
+	if (m_Arena && regionSize > 0 && regionSize <= m_ArenaSize / kArenaRegionCount)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (int i = 0; i < kArenaRegionCount; ++i)
+		{
+			ArenaRegion& region = m_ArenaRegions[i];
+			if (region.inUse || region.lastUseFrame > m_SafeGpuFrame)
+				continue;
+			region.inUse = true;
+			slot->arenaRegion = i;
+			unsigned char* memory = m_Arena + regionSize * i;
+			frame.texture = memory;
+			frame.vertices = reinterpret_cast<MeshVertex*>(memory + vertexOffset);
+			return;
+		}
+	}
+
+	slot->textureStorage.resize(textureBytes);
+	slot->vertexStorage.resize(m_MeshSource.vertexCount);
+	frame.texture = slot->textureStorage.data();
+	frame.vertices = slot->vertexStorage.data();
+}
+
+void GenerationPipeline::PromoteFinished()
+{
+	Slot* finished = NULL;
+	for (Slot& slot : m_Slots)
+	{
+		if (slot.state == kSlot_Generating && slot.job.IsDone())
+		{
+			slot.state = kSlot_Ready;
+			finished = &slot;
+		}
+	}
+	if (!finished)
+		return;
+
+	// Only the newest finished frame is worth showing
+	for (Slot& slot : m_Slots)
+	{
+		if (&slot != finished && slot.state == kSlot_Ready && slot.sequence < finished->sequence)
+			FreeSlot(&slot);
+	}
+}
+
+void GenerationPipeline::FreeSlot(Slot* slot)
+{
+	slot->state = kSlot_Free;
+	if (slot->arenaRegion >= 0)
+	{
+		m_ArenaRegions[slot->arenaRegion].inUse = false;
+		slot->arenaRegion = -1;
+	}
+}
+
+void GenerationPipeline::OnTimeFromUnity(float t)
+{
+	// Generate for the time the next frame will most likely get
+	const float nextTime = m_HasLastTime ? t + (t - m_LastTime) : t;
+	m_LastTime = t;
+	m_HasLastTime = true;
+
+	Slot* slot = NULL;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		PromoteFinished();
+
+		// Workers still on the previous frame: skip this one rather than queue up behind it,
+		// the render thread keeps showing the newest finished frame
+		for (Slot& candidate : m_Slots)
+		{
+			if (candidate.state == kSlot_Generating)
+				return;
+		}
+
+		// At most one slot is Ready and one Reading, so one is always free
+		for (Slot& candidate : m_Slots)
+		{
+			if (candidate.state == kSlot_Free)
+			{
+				slot = &candidate;
+				break;
+			}
+		}
+		if (!slot)
+			return;
+		slot->state = kSlot_Generating;
+		slot->sequence = m_NextSequence++;
+	}
+	m_GeneratingSlot = NULL;
+
+	// Nobody else touches a Generating slot, resize outside the lock
+	GeneratedFrame& frame = slot->frame;
+	frame.time = nextTime;
+	frame.textureWidth = m_TextureWidth;
+	frame.textureHeight = m_TextureHeight;
+	frame.vertexCount = m_MeshSource.vertexCount;
+	AssignStorage(slot);
+
+	const int vertexCount = m_MeshSource.vertexCount;
+	slot->tileRows = m_Pool->GetRowTileGrain(m_TextureHeight, m_TextureWidth * 4);
+	slot->textureTiles = m_TextureWidth > 0 ? (m_TextureHeight + slot->tileRows - 1) / slot->tileRows : 0;
+	slot->tileVertices = m_Pool->GetRowTileGrain(vertexCount, sizeof(MeshVertex));
+	const int vertexTiles = (vertexCount + slot->tileVertices - 1) / slot->tileVertices;
+
+	if (slot->textureTiles + vertexTiles == 0)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		FreeSlot(slot);
+		return;
+	}
+
+	m_GeneratingSlot = slot;
+	m_Pool->StartParallelFor(&slot->job, slot->textureTiles + vertexTiles, 1, GenerateTile, slot);
+}
+
+void GenerationPipeline::GenerateTile(void* context, int begin, int end)
+{
+	Slot* slot = static_cast<Slot*>(context);
+	GeneratedFrame& frame = slot->frame;
+	const HeightfieldSource& meshSource = slot->owner->m_MeshSource;
+
+	// Tiles [0, textureTiles) are plasma row tiles, the rest heightfield vertex tiles
+	for (int tile = begin; tile < end; ++tile)
+	{
+		if (tile < slot->textureTiles)
+		{
+			const int rowBegin = tile * slot->tileRows;
+			const int rowEnd = rowBegin + slot->tileRows < frame.textureHeight ? rowBegin + slot->tileRows : frame.textureHeight;
+			GeneratePlasmaRows(frame.texture, frame.textureWidth, rowBegin, rowEnd, frame.textureWidth * 4, frame.time * 4.0f);
+		}
+		else
+		{
+			const int vertexBegin = (tile - slot->textureTiles) * slot->tileVertices;
+			const int vertexEnd = vertexBegin + slot->tileVertices < frame.vertexCount ? vertexBegin + slot->tileVertices : frame.vertexCount;
+			DeformHeightfield(meshSource, vertexBegin, vertexEnd, frame.vertices, frame.time);
+		}
+	}
+}
+
+const GeneratedFrame* GenerationPipeline::AcquireLatest()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	PromoteFinished();
+	for (Slot& slot : m_Slots)
+	{
+		if (slot.state == kSlot_Ready)
+		{
+			slot.state = kSlot_Reading;
+			return &slot.frame;
+		}
+	}
+	return NULL;
+}
+
+void GenerationPipeline::Release(const GeneratedFrame* frame, unsigned long long uploadGpuFrame)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (Slot& slot : m_Slots)
+	{
+		if (&slot.frame != frame)
+			continue;
+		if (slot.arenaRegion >= 0 && uploadGpuFrame > m_ArenaRegions[slot.arenaRegion].lastUseFrame)
+			m_ArenaRegions[slot.arenaRegion].lastUseFrame = uploadGpuFrame;
+		FreeSlot(&slot);
+	}
+}
+
+void GenerationPipeline::SetSafeGpuFrame(unsigned long long safeGpuFrame)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (safeGpuFrame < m_SafeGpuFrame)
+	{
+		for (ArenaRegion& region : m_ArenaRegions)
+			region.lastUseFrame = 0;
+	}
+	m_SafeGpuFrame = safeGpuFrame;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "HeightfieldKernel.h"
+#include "WorkerPool.h"
+
+#include <mutex>
+#include <vector>
+
+// One frame's worth of CPU-generated data, ready to be copied into Unity's resources.
+struct GeneratedFrame
+{
+	float time;
+	int textureWidth;
+	int textureHeight;                 // rows are textureWidth * 4 bytes apart
+	unsigned char* texture;            // textureWidth * 4 * textureHeight bytes
+	MeshVertex* vertices;
+	int vertexCount;
+};
+
+// Runs the plasma and heightfield generators one frame ahead of the render thread.
+//
+// When Unity's time for frame N arrives (OnTimeFromUnity, from the main thread through the
+// exports or from the render thread through the command ring), generation for frame
+// N+1's predicted time starts on the worker pool and the call returns. The render
+// event then only copies the newest finished frame into the Begin*Modify* pointers.
+// Three GeneratedFrames rotate between the roles "being generated", "newest finished"
+// and "being copied", so neither side ever waits on the other; if the workers fall
+// behind, the render thread reuses the last finished frame and the feeding thread skips
+// starting a new one.
+//
+// Frames live in the slots' own storage, or in an upload arena the script handed over
+// (SetUploadArena) so that the backend can copy them to the GPU straight from there. An
+// arena region is only written again once the GPU has finished the frame that last
+// uploaded from it (see Release and SetSafeGpuFrame); when none is, the frame goes to the
+// slot's own storage and is staged as usual.
+class GenerationPipeline
+{
+public:
+	explicit GenerationPipeline(WorkerPool* pool);
+	~GenerationPipeline();
+
+	// Feeding thread (one at a time). The setters wait for an in-flight generation before
+	// changing its inputs.
+	void SetTextureSize(int width, int height);
+	void SetMeshSource(int vertexCount, const float* positions, const float* uvs);
+	// Generate into [base, base + size) from now on, NULL for the slots' own storage again.
+	// Finished frames still in the old arena are dropped, so AcquireLatest never returns
+	// one; a frame the render thread is copying stays where it is until its Release.
+	void SetUploadArena(void* base, size_t size);
+	void OnTimeFromUnity(float t);
+
+	// Render thread. Newest finished frame, or NULL before the first one; hand it back
+	// with Release once copied, along with the GPU frame its uploads were recorded in (0 when
+	// the backend copied the data before returning, see RenderAPI::GetGpuFrameNumbers).
+	const GeneratedFrame* AcquireLatest();
+	void Release(const GeneratedFrame* frame, unsigned long long uploadGpuFrame = 0);
+	// Render thread. Newest GPU frame the GPU has finished; arena regions last uploaded from
+	// in that frame or earlier may be written again. A number lower than the previous one
+	// means a new device, whose predecessor finished everything.
+	void SetSafeGpuFrame(unsigned long long safeGpuFrame);
+
+private:
+	enum SlotState
+	{
+		kSlot_Free,
+		kSlot_Generating,
+		kSlot_Ready,
+		kSlot_Reading,
+	};
+	struct Slot
+	{
+		GenerationPipeline* owner;
+		GeneratedFrame frame;
+		std::vector<unsigned char> textureStorage;
+		std::vector<MeshVertex> vertexStorage;
+		SlotState state;
+		int arenaRegion;               // index into m_ArenaRegions, -1 for the slot's own storage
+		unsigned long long sequence;
+		WorkerPoolJob job;
+		int textureTiles;
+		int tileRows;
+		int tileVertices;
+	};
+	static const int kSlotCount = 3;
+	// One region per slot plus the frames the GPU may still be copying from
+	static const int kArenaRegionCount = kSlotCount + 3;
+	struct ArenaRegion
+	{
+		bool inUse;                       // a slot's frame lives there
+		unsigned long long lastUseFrame;  // GPU frame of the last upload from it
+	};
+
+	static void GenerateTile(void* context, int begin, int end);
+	void PromoteFinished(); // m_Mutex held
+	void FreeSlot(Slot* slot); // m_Mutex held
+	void WaitForGeneration();
+	void AssignStorage(Slot* slot);
+
+	WorkerPool* m_Pool;
+	Slot m_Slots[kSlotCount];
+	std::mutex m_Mutex; // slot states and sequences, arena regions, m_SafeGpuFrame
+	ArenaRegion m_ArenaRegions[kArenaRegionCount];
+	unsigned long long m_SafeGpuFrame;
+
+	// Inputs, only changed on the feeding thread while nothing is generating
+	int m_TextureWidth;
+	int m_TextureHeight;
+	HeightfieldSource m_MeshSource;
+	unsigned char* m_Arena;
+	size_t m_ArenaSize;
+	float m_LastTime;
+	bool m_HasLastTime;
+	unsigned long long m_NextSequence;
+	Slot* m_GeneratingSlot; // feeding thread only
+};
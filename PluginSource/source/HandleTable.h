@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// 32-bit handle to an entry of a HandleTable: slot index in the low kHandleIndexBits,
+// the slot's generation above them. 0 is never a valid handle.
+typedef uint32_t PluginHandle;
+static const PluginHandle kInvalidPluginHandle = 0;
+
+// Slot map for plugin-owned resources handed out to scripts.
+//
+// Values are stored densely (removal moves the last one into the hole), so per-frame
+// work can walk them like a vector. Handles go through a slot array that maps them to
+// the dense position; each slot carries a generation that is bumped on removal, so a
+// stale handle from the script fails Get() instead of reaching a reused entry.
+// Lookup, insertion and removal are O(1). Not thread-safe; the owner locks if needed.
+template<typename T>
+class HandleTable
+{
+public:
+	static const uint32_t kHandleIndexBits = 20;
+	static const uint32_t kMaxEntries = 1u << kHandleIndexBits;
+
+	HandleTable() : m_FreeSlot(kNoSlot) {}
+
+	// kInvalidPluginHandle once kMaxEntries entries are alive
+	PluginHandle Insert(T value)
+	{
+		uint32_t slotIndex = m_FreeSlot;
+		if (slotIndex != kNoSlot)
+		{
+			m_FreeSlot = m_Slots[slotIndex].denseIndex;
+		}
+		else
+		{
+			if (m_Slots.size() >= kMaxEntries)
+				return kInvalidPluginHandle;
+			slotIndex = static_cast<uint32_t>(m_Slots.size());
+			Slot slot = { 0, 1 };
+			m_Slots.push_back(slot);
+		}
+
+		Slot& slot = m_Slots[slotIndex];
+		slot.denseIndex = static_cast<uint32_t>(m_Values.size());
+		m_Values.push_back(std::move(value));
+		m_DenseToSlot.push_back(slotIndex);
+		return MakeHandle(slotIndex, slot.generation);
+	}
+
+	// NULL for stale, removed or invalid handles. Valid until the next Insert/Remove.
+	T* Get(PluginHandle handle)
+	{
+		const uint32_t slotIndex = handle & kIndexMask;
+		if (handle == kInvalidPluginHandle || slotIndex >= m_Slots.size())
+			return NULL;
+		const Slot& slot = m_Slots[slotIndex];
+		if (slot.generation != (handle >> kHandleIndexBits) || slot.denseIndex >= m_Values.size())
+			return NULL;
+		return &m_Values[slot.denseIndex];
+	}
+
+	// Moves the value out into outValue (if given); false for stale handles
+	bool Remove(PluginHandle handle, T* outValue = NULL)
+	{
+		T* value = Get(handle);
+		if (!value)
+			return false;
+		if (outValue)
+			*outValue = std::move(*value);
+
+		const uint32_t slotIndex = handle & kIndexMask;
+		Slot& slot = m_Slots[slotIndex];
+		const uint32_t hole = slot.denseIndex;
+		const uint32_t last = static_cast<uint32_t>(m_Values.size()) - 1;
+		if (hole != last)
+		{
+			m_Values[hole] = std::move(m_Values[last]);
+			m_DenseToSlot[hole] = m_DenseToSlot[last];
+			m_Slots[m_DenseToSlot[hole]].denseIndex = hole;
+		}
+		m_Values.pop_back();
+		m_DenseToSlot.pop_back();
+
+		// Generation 0 is skipped so no handle ever encodes to 0
+		slot.generation = (slot.generation + 1) & kGenerationMask;
+		if (slot.generation == 0)
+			slot.generation = 1;
+		slot.denseIndex = m_FreeSlot;
+		m_FreeSlot = slotIndex;
+		return true;
+	}
+
+	size_t Size() const { return m_Values.size(); }
+
+	// Dense iteration, in no particular order
+	T* begin() { return m_Values.data(); }
+	T* end() { return m_Values.data() + m_Values.size(); }
+	PluginHandle GetHandleAt(size_t denseIndex) const
+	{
+		const uint32_t slotIndex = m_DenseToSlot[denseIndex];
+		return MakeHandle(slotIndex, m_Slots[slotIndex].generation);
+	}
+
+private:
+	static const uint32_t kIndexMask = kMaxEntries - 1;
+	static const uint32_t kGenerationMask = (1u << (32 - kHandleIndexBits)) - 1;
+	static const uint32_t kNoSlot = 0xFFFFFFFFu;
+
+	struct Slot
+	{
+		uint32_t denseIndex; // next free slot while the slot is free
+		uint32_t generation;
+	};
+
+	static PluginHandle MakeHandle(uint32_t slotIndex, uint32_t generation)
+	{
+		return (generation << kHandleIndexBits) | slotIndex;
+	}
+
+	std::vector<T> m_Values;
+	std::vector<uint32_t> m_DenseToSlot;
+	std::vector<Slot> m_Slots;
+	uint32_t m_FreeSlot;
+};
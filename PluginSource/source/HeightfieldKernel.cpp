@@ -0,0 +1,237 @@
+#include "HeightfieldKernel.h"
+#include "SimdMath.h"
+
+#include <math.h>
+#include <stdint.h>
+
+typedef void (*HeightfieldFunc)(const HeightfieldSource& source, int vertexBegin, int vertexEnd, MeshVertex* dst, float t);
+
+// Two scrolling sine waves along x and z
+#define HEIGHT_FREQ_X 1.1f
+#define HEIGHT_AMP_X  0.4f
+#define HEIGHT_FREQ_Z 0.8f
+#define HEIGHT_AMP_Z  0.15f
+#define HALF_PI       1.57079633f
+
+void BuildHeightfieldSource(HeightfieldSource* source, int vertexCount, const float* positions, const float* uvs)
+{
+	source->vertexCount = vertexCount;
+	source->x.resize(vertexCount);
+	source->y.resize(vertexCount);
+	source->z.resize(vertexCount);
+	source->u.resize(vertexCount);
+	source->v.resize(vertexCount);
+	for (int i = 0; i < vertexCount; ++i)
+	{
+		source->x[i] = positions[0];
+		source->y[i] = positions[1];
+		source->z[i] = positions[2];
+		source->u[i] = uvs[0];
+		source->v[i] = uvs[1];
+		positions += 3;
+		uvs += 2;
+	}
+}
+
+static void DeformVertexScalar(const HeightfieldSource& source, int i, MeshVertex& dst, float t)
+{
+	const float x = source.x[i];
+	const float z = source.z[i];
+	const float h = sinf(x * HEIGHT_FREQ_X + t) * HEIGHT_AMP_X + sinf(z * HEIGHT_FREQ_Z - t) * HEIGHT_AMP_Z;
+	const float dhdx = cosf(x * HEIGHT_FREQ_X + t) * (HEIGHT_AMP_X * HEIGHT_FREQ_X);
+	const float dhdz = cosf(z * HEIGHT_FREQ_Z - t) * (HEIGHT_AMP_Z * HEIGHT_FREQ_Z);
+	const float invLength = 1.0f / sqrtf(dhdx * dhdx + 1.0f + dhdz * dhdz);
+
+	dst.pos[0] = x;
+	dst.pos[1] = source.y[i] + h;
+	dst.pos[2] = z;
+	dst.normal[0] = -dhdx * invLength;
+	dst.normal[1] = invLength;
+	dst.normal[2] = -dhdz * invLength;
+	dst.color[0] = 1.0f;
+	dst.color[1] = 1.0f;
+	dst.color[2] = 1.0f;
+	dst.color[3] = 1.0f;
+	dst.uv[0] = source.u[i];
+	dst.uv[1] = source.v[i];
+}
+
+void DeformHeightfield_Scalar(const HeightfieldSource& source, int vertexBegin, int vertexEnd, MeshVertex* dst, float t)
+{
+	for (int i = vertexBegin; i < vertexEnd; ++i)
+		DeformVertexScalar(source, i, dst[i], t);
+}
+
+// The SIMD variants compute each component for 8 (AVX2) or 4 (NEON) vertices at once,
+// then turn the 12 component registers back into whole vertices with three 4x4
+// transposes, one per 16-byte third of a vertex: (px py pz nx) (ny nz r g) (b a u v).
+
+#if SIMD_X86
+
+// Four in-lane 4x4 transposes: lane 0 yields vertices 0-3, lane 1 vertices 4-7
+SIMD_TARGET_AVX2 static inline void Transpose4x4_AVX2(__m256& a, __m256& b, __m256& c, __m256& d)
+{
+	const __m256 t0 = _mm256_unpacklo_ps(a, b);
+	const __m256 t1 = _mm256_unpackhi_ps(a, b);
+	const __m256 t2 = _mm256_unpacklo_ps(c, d);
+	const __m256 t3 = _mm256_unpackhi_ps(c, d);
+	a = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t2)));
+	b = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t2)));
+	c = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t1), _mm256_castps_pd(t3)));
+	d = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t1), _mm256_castps_pd(t3)));
+}
+
+SIMD_TARGET_AVX2 static void DeformHeightfield_AVX2(const HeightfieldSource& source, int vertexBegin, int vertexEnd, MeshVertex* dst, float t)
+{
+	// Streaming stores need 16-byte aligned vertices; MeshVertex is 48 bytes so that is
+	// true for all of them or none
+	const bool stream = (reinterpret_cast<uintptr_t>(dst) & 15) == 0;
+
+	const __m256 vt = _mm256_set1_ps(t);
+	const __m256 freqX = _mm256_set1_ps(HEIGHT_FREQ_X);
+	const __m256 freqZ = _mm256_set1_ps(HEIGHT_FREQ_Z);
+	const __m256 ampX = _mm256_set1_ps(HEIGHT_AMP_X);
+	const __m256 ampZ = _mm256_set1_ps(HEIGHT_AMP_Z);
+	const __m256 slopeX = _mm256_set1_ps(HEIGHT_AMP_X * HEIGHT_FREQ_X);
+	const __m256 slopeZ = _mm256_set1_ps(HEIGHT_AMP_Z * HEIGHT_FREQ_Z);
+	const __m256 halfPi = _mm256_set1_ps(HALF_PI);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+	int i = vertexBegin;
+	for (; i + 8 <= vertexEnd; i += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(&source.x[i]);
+		const __m256 y = _mm256_loadu_ps(&source.y[i]);
+		const __m256 z = _mm256_loadu_ps(&source.z[i]);
+		__m256 u = _mm256_loadu_ps(&source.u[i]);
+		__m256 v = _mm256_loadu_ps(&source.v[i]);
+
+		// cos(a) = sin(a + pi/2)
+		const __m256 phaseX = _mm256_fmadd_ps(x, freqX, vt);
+		const __m256 phaseZ = _mm256_fmsub_ps(z, freqZ, vt);
+		const __m256 h = _mm256_fmadd_ps(SinPoly_AVX2(phaseX), ampX, _mm256_mul_ps(SinPoly_AVX2(phaseZ), ampZ));
+		const __m256 dhdx = _mm256_mul_ps(SinPoly_AVX2(_mm256_add_ps(phaseX, halfPi)), slopeX);
+		const __m256 dhdz = _mm256_mul_ps(SinPoly_AVX2(_mm256_add_ps(phaseZ, halfPi)), slopeZ);
+		const __m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(dhdx, dhdx, _mm256_fmadd_ps(dhdz, dhdz, one))));
+
+		__m256 px = x;
+		__m256 py = _mm256_add_ps(y, h);
+		__m256 pz = z;
+		__m256 nx = _mm256_xor_ps(_mm256_mul_ps(dhdx, invLength), signMask);
+		__m256 ny = invLength;
+		__m256 nz = _mm256_xor_ps(_mm256_mul_ps(dhdz, invLength), signMask);
+		__m256 cr = one, cg = one, cb = one, ca = one;
+
+		Transpose4x4_AVX2(px, py, pz, nx);
+		Transpose4x4_AVX2(ny, nz, cr, cg);
+		Transpose4x4_AVX2(cb, ca, u, v);
+		const __m256 parts[12] = { px, ny, cb, py, nz, ca, pz, cr, u, nx, cg, v };
+
+		// Vertex k of the block: three 16-byte parts from lane k / 4 of parts[3 * (k % 4) + 0..2]
+		float* out = dst[i].pos;
+		for (int k = 0; k < 4; ++k)
+		{
+			for (int part = 0; part < 3; ++part)
+			{
+				const __m256 r = parts[3 * k + part];
+				if (stream)
+				{
+					_mm_stream_ps(out + 12 * k + 4 * part, _mm256_castps256_ps128(r));
+					_mm_stream_ps(out + 12 * (k + 4) + 4 * part, _mm256_extractf128_ps(r, 1));
+				}
+				else
+				{
+					_mm_storeu_ps(out + 12 * k + 4 * part, _mm256_castps256_ps128(r));
+					_mm_storeu_ps(out + 12 * (k + 4) + 4 * part, _mm256_extractf128_ps(r, 1));
+				}
+			}
+		}
+	}
+
+	// Streaming stores are weakly ordered; fence before whoever waits on us reads the buffer
+	if (stream)
+		_mm_sfence();
+
+	DeformHeightfield_Scalar(source, i, vertexEnd, dst, t);
+}
+
+#elif SIMD_NEON
+
+static inline void Transpose4x4_NEON(float32x4_t& a, float32x4_t& b, float32x4_t& c, float32x4_t& d)
+{
+	const float32x4_t t0 = vzip1q_f32(a, c);
+	const float32x4_t t1 = vzip1q_f32(b, d);
+	const float32x4_t t2 = vzip2q_f32(a, c);
+	const float32x4_t t3 = vzip2q_f32(b, d);
+	a = vzip1q_f32(t0, t1);
+	b = vzip2q_f32(t0, t1);
+	c = vzip1q_f32(t2, t3);
+	d = vzip2q_f32(t2, t3);
+}
+
+static void DeformHeightfield_NEON(const HeightfieldSource& source, int vertexBegin, int vertexEnd, MeshVertex* dst, float t)
+{
+	const float32x4_t vt = vdupq_n_f32(t);
+	const float32x4_t halfPi = vdupq_n_f32(HALF_PI);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+
+	int i = vertexBegin;
+	for (; i + 4 <= vertexEnd; i += 4)
+	{
+		const float32x4_t x = vld1q_f32(&source.x[i]);
+		const float32x4_t y = vld1q_f32(&source.y[i]);
+		const float32x4_t z = vld1q_f32(&source.z[i]);
+		float32x4_t u = vld1q_f32(&source.u[i]);
+		float32x4_t v = vld1q_f32(&source.v[i]);
+
+		const float32x4_t phaseX = vmlaq_n_f32(vt, x, HEIGHT_FREQ_X);
+		const float32x4_t phaseZ = vsubq_f32(vmulq_n_f32(z, HEIGHT_FREQ_Z), vt);
+		const float32x4_t h = vmlaq_n_f32(vmulq_n_f32(SinPoly_NEON(phaseZ), HEIGHT_AMP_Z), SinPoly_NEON(phaseX), HEIGHT_AMP_X);
+		const float32x4_t dhdx = vmulq_n_f32(SinPoly_NEON(vaddq_f32(phaseX, halfPi)), HEIGHT_AMP_X * HEIGHT_FREQ_X);
+		const float32x4_t dhdz = vmulq_n_f32(SinPoly_NEON(vaddq_f32(phaseZ, halfPi)), HEIGHT_AMP_Z * HEIGHT_FREQ_Z);
+		const float32x4_t invLength = vdivq_f32(one, vsqrtq_f32(vmlaq_f32(vmlaq_f32(one, dhdz, dhdz), dhdx, dhdx)));
+
+		float32x4_t px = x;
+		float32x4_t py = vaddq_f32(y, h);
+		float32x4_t pz = z;
+		float32x4_t nx = vnegq_f32(vmulq_f32(dhdx, invLength));
+		float32x4_t ny = invLength;
+		float32x4_t nz = vnegq_f32(vmulq_f32(dhdz, invLength));
+		float32x4_t cr = one, cg = one, cb = one, ca = one;
+
+		Transpose4x4_NEON(px, py, pz, nx);
+		Transpose4x4_NEON(ny, nz, cr, cg);
+		Transpose4x4_NEON(cb, ca, u, v);
+		const float32x4_t parts[12] = { px, ny, cb, py, nz, ca, pz, cr, u, nx, cg, v };
+
+		// No streaming store intrinsic on NEON; plain stores of whole lines
+		float* out = dst[i].pos;
+		for (int part = 0; part < 12; ++part)
+			vst1q_f32(out + 4 * part, parts[part]);
+	}
+
+	DeformHeightfield_Scalar(source, i, vertexEnd, dst, t);
+}
+
+#endif
+
+static HeightfieldFunc SelectHeightfieldKernel()
+{
+	switch (GetSimdLevel())
+	{
+#if SIMD_X86
+	case kSimdLevel_AVX512:
+	case kSimdLevel_AVX2: return DeformHeightfield_AVX2;
+#elif SIMD_NEON
+	case kSimdLevel_NEON: return DeformHeightfield_NEON;
+#endif
+	default: return DeformHeightfield_Scalar;
+	}
+}
+
+void DeformHeightfield(const HeightfieldSource& source, int vertexBegin, int vertexEnd, MeshVertex* dst, float t)
+{
+	static const HeightfieldFunc s_Kernel = SelectHeightfieldKernel();
+	s_Kernel(source, vertexBegin, vertexEnd, dst, t);
+}
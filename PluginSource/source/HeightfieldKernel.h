@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+// Vertex layout UseRenderingPlugin.cs sets on the mesh: pos3, normal3, color4, uv2 floats.
+struct MeshVertex
+{
+	float pos[3];
+	float normal[3];
+	float color[4];
+	float uv[2];
+};
+
+// The mesh Unity passed in, kept as one array per component so the deformation
+// kernels can load eight vertices' x (or z, ...) with a single instruction.
+// Normals are not kept; the deformed surface gets new ones analytically.
+struct HeightfieldSource
+{
+	std::vector<float> x, y, z;
+	std::vector<float> u, v;
+	int vertexCount = 0;
+};
+
+// Copies Unity's position (float3) and uv (float2) arrays. Unity frees them right
+// after SetMeshBuffersFromUnity returns, so this is the only time they are read.
+void BuildHeightfieldSource(HeightfieldSource* source, int vertexCount, const float* positions, const float* uvs);
+
+// Writes vertices [vertexBegin, vertexEnd) of the deformed mesh into dst (the start of
+// the vertex buffer, 16-byte aligned for the streaming path):
+//   y' = y + 0.4 sin(1.1 x + t) + 0.15 sin(0.8 z - t)
+//   normal = normalize(-dy'/dx, 1, -dy'/dz)
+// Uses AVX2 or NEON when available and bypasses the cache with streaming stores where
+// the destination allows, since the CPU never reads the buffer back.
+void DeformHeightfield(const HeightfieldSource& source, int vertexBegin, int vertexEnd, MeshVertex* dst, float t);
+
+// One vertex at a time with sinf/cosf; reference and fallback.
+void DeformHeightfield_Scalar(const HeightfieldSource& source, int vertexBegin, int vertexEnd, MeshVertex* dst, float t);
@@ -0,0 +1,215 @@
+#include "PlasmaKernel.h"
+#include "SimdMath.h"
+
+#include <math.h>
+
+typedef void (*PlasmaRowsFunc)(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t);
+
+// One row, columns [xBegin, xEnd); also finishes the columns the SIMD loops leave over
+static void PlasmaRowScalar(unsigned char* row, int xBegin, int xEnd, int y, float t)
+{
+	unsigned char* ptr = row + xBegin * 4;
+	for (int x = xBegin; x < xEnd; ++x)
+	{
+		// Simple "plasma effect": several combined sine waves
+		int vv = int(
+			(127.0f + (127.0f * sinf(x / 7.0f + t))) +
+			(127.0f + (127.0f * sinf(y / 5.0f - t))) +
+			(127.0f + (127.0f * sinf((x + y) / 6.0f - t))) +
+			(127.0f + (127.0f * sinf(sqrtf(float(x*x + y*y)) / 4.0f - t)))
+			) / 4;
+
+		// Write the texture pixel
+		ptr[0] = vv;
+		ptr[1] = vv;
+		ptr[2] = vv;
+		ptr[3] = vv;
+
+		// To next pixel (our pixels are 4 bpp)
+		ptr += 4;
+	}
+}
+
+void GeneratePlasmaRows_Scalar(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t)
+{
+	for (int y = rowBegin; y < rowEnd; ++y)
+		PlasmaRowScalar(dst + (size_t)y * rowPitch, 0, width, y, t);
+}
+
+// All variants compute, per lane:
+//   v = 4*127 + 127 * (sin(x/7 + t) + sin(y/5 - t) + sin((x+y)/6 - t) + sin(|(x,y)|/4 - t))
+// with the y-only term hoisted out of the row, then truncate, divide by 4 and
+// saturate to bytes, replicating the byte into R, G, B and A.
+
+#if SIMD_X86
+
+SIMD_TARGET_SSE41 static void GeneratePlasmaRows_SSE41(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t)
+{
+	const __m128 inv7 = _mm_set1_ps(1.0f / 7.0f);
+	const __m128 inv6 = _mm_set1_ps(1.0f / 6.0f);
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	const __m128 vt = _mm_set1_ps(t);
+	const __m128 scale = _mm_set1_ps(127.0f);
+	const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+	for (int y = rowBegin; y < rowEnd; ++y)
+	{
+		unsigned char* row = dst + (size_t)y * rowPitch;
+		const float fy = float(y);
+		const __m128 vy = _mm_set1_ps(fy);
+		const __m128 vy2 = _mm_set1_ps(fy * fy);
+		const __m128 bias = _mm_set1_ps(4.0f * 127.0f + 127.0f * SinPoly(fy / 5.0f - t));
+
+		__m128 vx = lane;
+		int x = 0;
+		for (; x + 4 <= width; x += 4, vx = _mm_add_ps(vx, _mm_set1_ps(4.0f)))
+		{
+			__m128 sum = SinPoly_SSE41(_mm_add_ps(_mm_mul_ps(vx, inv7), vt));
+			sum = _mm_add_ps(sum, SinPoly_SSE41(_mm_sub_ps(_mm_mul_ps(_mm_add_ps(vx, vy), inv6), vt)));
+			const __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), vy2));
+			sum = _mm_add_ps(sum, SinPoly_SSE41(_mm_sub_ps(_mm_mul_ps(dist, quarter), vt)));
+
+			__m128i vv = _mm_srai_epi32(_mm_cvttps_epi32(_mm_add_ps(bias, _mm_mul_ps(scale, sum))), 2);
+			vv = _mm_packus_epi32(vv, vv);
+			vv = _mm_packus_epi16(vv, vv);
+			vv = _mm_unpacklo_epi8(vv, vv);
+			vv = _mm_unpacklo_epi16(vv, vv);
+			_mm_storeu_si128((__m128i*)(row + x * 4), vv);
+		}
+		PlasmaRowScalar(row, x, width, y, t);
+	}
+}
+
+SIMD_TARGET_AVX2 static void GeneratePlasmaRows_AVX2(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t)
+{
+	const __m256 inv7 = _mm256_set1_ps(1.0f / 7.0f);
+	const __m256 inv6 = _mm256_set1_ps(1.0f / 6.0f);
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+	const __m256 vt = _mm256_set1_ps(t);
+	const __m256 scale = _mm256_set1_ps(127.0f);
+	const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+	for (int y = rowBegin; y < rowEnd; ++y)
+	{
+		unsigned char* row = dst + (size_t)y * rowPitch;
+		const float fy = float(y);
+		const __m256 vy = _mm256_set1_ps(fy);
+		const __m256 vy2 = _mm256_set1_ps(fy * fy);
+		const __m256 bias = _mm256_set1_ps(4.0f * 127.0f + 127.0f * SinPoly(fy / 5.0f - t));
+
+		__m256 vx = lane;
+		int x = 0;
+		for (; x + 8 <= width; x += 8, vx = _mm256_add_ps(vx, _mm256_set1_ps(8.0f)))
+		{
+			__m256 sum = SinPoly_AVX2(_mm256_fmadd_ps(vx, inv7, vt));
+			sum = _mm256_add_ps(sum, SinPoly_AVX2(_mm256_fmsub_ps(_mm256_add_ps(vx, vy), inv6, vt)));
+			const __m256 dist = _mm256_sqrt_ps(_mm256_fmadd_ps(vx, vx, vy2));
+			sum = _mm256_add_ps(sum, SinPoly_AVX2(_mm256_fmsub_ps(dist, quarter, vt)));
+
+			// Packs work per 128-bit lane, which keeps pixels 0-3 and 4-7 in order
+			__m256i vv = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_fmadd_ps(scale, sum, bias)), 2);
+			vv = _mm256_packus_epi32(vv, vv);
+			vv = _mm256_packus_epi16(vv, vv);
+			vv = _mm256_unpacklo_epi8(vv, vv);
+			vv = _mm256_unpacklo_epi16(vv, vv);
+			_mm256_storeu_si256((__m256i*)(row + x * 4), vv);
+		}
+		PlasmaRowScalar(row, x, width, y, t);
+	}
+}
+
+SIMD_TARGET_AVX512 static void GeneratePlasmaRows_AVX512(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t)
+{
+	const __m512 inv7 = _mm512_set1_ps(1.0f / 7.0f);
+	const __m512 inv6 = _mm512_set1_ps(1.0f / 6.0f);
+	const __m512 quarter = _mm512_set1_ps(0.25f);
+	const __m512 vt = _mm512_set1_ps(t);
+	const __m512 scale = _mm512_set1_ps(127.0f);
+	const __m512 lane = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+		8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+
+	for (int y = rowBegin; y < rowEnd; ++y)
+	{
+		unsigned char* row = dst + (size_t)y * rowPitch;
+		const float fy = float(y);
+		const __m512 vy = _mm512_set1_ps(fy);
+		const __m512 vy2 = _mm512_set1_ps(fy * fy);
+		const __m512 bias = _mm512_set1_ps(4.0f * 127.0f + 127.0f * SinPoly(fy / 5.0f - t));
+
+		__m512 vx = lane;
+		int x = 0;
+		for (; x + 16 <= width; x += 16, vx = _mm512_add_ps(vx, _mm512_set1_ps(16.0f)))
+		{
+			__m512 sum = SinPoly_AVX512(_mm512_fmadd_ps(vx, inv7, vt));
+			sum = _mm512_add_ps(sum, SinPoly_AVX512(_mm512_fmsub_ps(_mm512_add_ps(vx, vy), inv6, vt)));
+			const __m512 dist = _mm512_sqrt_ps(_mm512_fmadd_ps(vx, vx, vy2));
+			sum = _mm512_add_ps(sum, SinPoly_AVX512(_mm512_fmsub_ps(dist, quarter, vt)));
+
+			__m512i vv = _mm512_srai_epi32(_mm512_cvttps_epi32(_mm512_fmadd_ps(scale, sum, bias)), 2);
+			vv = _mm512_packus_epi32(vv, vv);
+			vv = _mm512_packus_epi16(vv, vv);
+			vv = _mm512_unpacklo_epi8(vv, vv);
+			vv = _mm512_unpacklo_epi16(vv, vv);
+			_mm512_storeu_si512((void*)(row + x * 4), vv);
+		}
+		PlasmaRowScalar(row, x, width, y, t);
+	}
+}
+
+#elif SIMD_NEON
+
+static void GeneratePlasmaRows_NEON(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t)
+{
+	const float32x4_t vt = vdupq_n_f32(t);
+	const float lanes[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	const float32x4_t lane = vld1q_f32(lanes);
+
+	for (int y = rowBegin; y < rowEnd; ++y)
+	{
+		unsigned char* row = dst + (size_t)y * rowPitch;
+		const float fy = float(y);
+		const float32x4_t vy = vdupq_n_f32(fy);
+		const float32x4_t vy2 = vdupq_n_f32(fy * fy);
+		const float32x4_t bias = vdupq_n_f32(4.0f * 127.0f + 127.0f * SinPoly(fy / 5.0f - t));
+
+		float32x4_t vx = lane;
+		int x = 0;
+		for (; x + 4 <= width; x += 4, vx = vaddq_f32(vx, vdupq_n_f32(4.0f)))
+		{
+			float32x4_t sum = SinPoly_NEON(vmlaq_n_f32(vt, vx, 1.0f / 7.0f));
+			sum = vaddq_f32(sum, SinPoly_NEON(vsubq_f32(vmulq_n_f32(vaddq_f32(vx, vy), 1.0f / 6.0f), vt)));
+			const float32x4_t dist = vsqrtq_f32(vmlaq_f32(vy2, vx, vx));
+			sum = vaddq_f32(sum, SinPoly_NEON(vsubq_f32(vmulq_n_f32(dist, 0.25f), vt)));
+
+			const int32x4_t vi = vshrq_n_s32(vcvtq_s32_f32(vmlaq_n_f32(bias, sum, 127.0f)), 2);
+			// Saturating narrow to bytes, then replicate each byte across its pixel
+			const uint8x8_t bytes = vqmovn_u16(vcombine_u16(vqmovun_s32(vi), vdup_n_u16(0)));
+			const uint32x4_t pixels = vmulq_n_u32(vmovl_u16(vget_low_u16(vmovl_u8(bytes))), 0x01010101u);
+			vst1q_u8(row + x * 4, vreinterpretq_u8_u32(pixels));
+		}
+		PlasmaRowScalar(row, x, width, y, t);
+	}
+}
+
+#endif
+
+static PlasmaRowsFunc SelectPlasmaKernel()
+{
+	switch (GetSimdLevel())
+	{
+#if SIMD_X86
+	case kSimdLevel_AVX512: return GeneratePlasmaRows_AVX512;
+	case kSimdLevel_AVX2: return GeneratePlasmaRows_AVX2;
+	case kSimdLevel_SSE41: return GeneratePlasmaRows_SSE41;
+#elif SIMD_NEON
+	case kSimdLevel_NEON: return GeneratePlasmaRows_NEON;
+#endif
+	default: return GeneratePlasmaRows_Scalar;
+	}
+}
+
+void GeneratePlasmaRows(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t)
+{
+	static const PlasmaRowsFunc s_Kernel = SelectPlasmaKernel();
+	s_Kernel(dst, width, rowBegin, rowEnd, rowPitch, t);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// The animated "plasma" texture: four combined sine waves per pixel, written as
+// RGBA8 with the same value in all four channels.
+//
+// dst points at row 0 of the texture and rows are rowPitch bytes apart (as returned
+// by RenderAPI::BeginModifyTexture); only rows [rowBegin, rowEnd) are written, so
+// callers can split the texture into independent row ranges. t is the animation
+// time, already scaled.
+
+// Vectorized for the best SIMD level the CPU has (see SimdMath.h). Matches the
+// scalar reference to within one step of 8-bit output.
+void GeneratePlasmaRows(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t);
+
+// Plain sinf/sqrtf per pixel, the original formulation. Kept for comparison and as the
+// fallback on CPUs without SSE4.1.
+void GeneratePlasmaRows_Scalar(unsigned char* dst, int width, int rowBegin, int rowEnd, int rowPitch, float t);
@@ -0,0 +1,117 @@
+#include "ReadbackQueue.h"
+
+#include <string.h>
+
+PluginHandle ReadbackQueue::Request(void* textureHandle, int x, int y, int width, int height)
+{
+	if (!textureHandle || x < 0 || y < 0 || width <= 0 || height <= 0)
+		return kInvalidPluginHandle;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Readbacks.Size() >= kMaxReadbacks)
+		return kInvalidPluginHandle;
+
+	Readback readback;
+	readback.request.id = kInvalidPluginHandle;
+	readback.request.textureHandle = textureHandle;
+	readback.request.x = x;
+	readback.request.y = y;
+	readback.request.width = width;
+	readback.request.height = height;
+	readback.status = kReadback_Pending;
+	readback.inFlight = false;
+	const PluginHandle id = m_Readbacks.Insert(std::move(readback));
+	if (id != kInvalidPluginHandle)
+	{
+		m_Readbacks.Get(id)->request.id = id;
+		m_Requests.push_back(id);
+	}
+	return id;
+}
+
+ReadbackStatus ReadbackQueue::TryGet(PluginHandle id, void* dest, size_t destSize)
+{
+	Readback readback;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Readback* found = m_Readbacks.Get(id);
+		if (!found)
+			return kReadback_Failed;
+		if (found->status == kReadback_Pending)
+			return kReadback_Pending;
+		m_Readbacks.Remove(id, &readback);
+	}
+
+	// Copy outside the lock, the render thread may be completing others meanwhile
+	if (readback.status != kReadback_Ready || !dest || destSize < readback.data.size())
+		return kReadback_Failed;
+	memcpy(dest, readback.data.data(), readback.data.size());
+	return kReadback_Ready;
+}
+
+void ReadbackQueue::TakeRequests(std::vector<ReadbackRequest>* requests)
+{
+	requests->clear();
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (size_t i = 0; i < m_Requests.size(); ++i)
+	{
+		// Requests are only removed by TryGet once they are no longer pending, so this can't miss
+		if (Readback* readback = m_Readbacks.Get(m_Requests[i]))
+		{
+			readback->inFlight = true;
+			requests->push_back(readback->request);
+		}
+	}
+	m_Requests.clear();
+}
+
+void ReadbackQueue::Complete(PluginHandle id, const void* data, size_t rowPitch)
+{
+	int width, height;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Readback* readback = m_Readbacks.Get(id);
+		if (!readback || !readback->inFlight)
+			return;
+		width = readback->request.width;
+		height = readback->request.height;
+	}
+
+	// Copied out here, so the backend gets its memory back right away and the script never
+	// touches backend memory
+	const size_t packedPitch = (size_t)width * 4;
+	std::vector<unsigned char> packed(packedPitch * height);
+	for (int row = 0; row < height; ++row)
+		memcpy(&packed[row * packedPitch], static_cast<const unsigned char*>(data) + row * rowPitch, packedPitch);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (Readback* readback = m_Readbacks.Get(id))
+	{
+		readback->data.swap(packed);
+		readback->status = kReadback_Ready;
+		readback->inFlight = false;
+	}
+}
+
+void ReadbackQueue::Fail(PluginHandle id)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (Readback* readback = m_Readbacks.Get(id))
+	{
+		readback->status = kReadback_Failed;
+		readback->inFlight = false;
+	}
+}
+
+void ReadbackQueue::FailInFlight()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (Readback& readback : m_Readbacks)
+	{
+		if (readback.inFlight)
+		{
+			readback.status = kReadback_Failed;
+			readback.inFlight = false;
+		}
+	}
+}
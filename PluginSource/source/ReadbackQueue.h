@@ -0,0 +1,68 @@
+#pragma once
+
+#include "HandleTable.h"
+
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+// A texture rectangle the script asked to read back. Only 4 bytes per texel formats
+// (RGBA8/BGRA8) are supported; the result is width * height * 4 bytes, rows packed, in the
+// order they are stored in the texture, texels as stored.
+struct ReadbackRequest
+{
+	PluginHandle id;
+	void* textureHandle; // Unity's native texture pointer
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+// TryGetReadback results; mirrored in UseRenderingPlugin.cs
+enum ReadbackStatus
+{
+	kReadback_Failed = -1,  // unknown or stale id, the backend couldn't copy it, or dest too small; id released
+	kReadback_Pending = 0,  // not copied yet, ask again next frame
+	kReadback_Ready = 1,    // copied into dest; id released
+};
+
+// Asynchronous GPU readbacks, handed between the script and the render thread.
+//
+// The script requests a rectangle (main thread) and gets an id back right away. The next
+// frame event passes new requests to the backend, which records a copy into memory the CPU
+// can read and returns; a later frame event collects the copies the GPU has finished and
+// hands them to Complete. The script polls TryGet until its data is there, usually a couple
+// of frames later. Nobody waits for the GPU.
+class ReadbackQueue
+{
+public:
+	// Requested but not collected by the script; Request fails beyond that
+	static const int kMaxReadbacks = 64;
+
+	// Main thread. kInvalidPluginHandle for empty rectangles or too many readbacks.
+	PluginHandle Request(void* textureHandle, int x, int y, int width, int height);
+	// Main thread. dest gets the data once it's there; destSize must hold all of it.
+	ReadbackStatus TryGet(PluginHandle id, void* dest, size_t destSize);
+
+	// Render thread: the requests made since the last call, oldest first
+	void TakeRequests(std::vector<ReadbackRequest>* requests);
+	// Render thread: the copy of id has landed, rows rowPitch bytes apart
+	void Complete(PluginHandle id, const void* data, size_t rowPitch);
+	void Fail(PluginHandle id);
+	// Render thread, device shutdown: whatever the backend still had in flight is gone
+	void FailInFlight();
+
+private:
+	struct Readback
+	{
+		ReadbackRequest request;
+		ReadbackStatus status;
+		bool inFlight; // taken by the render thread, not completed or failed yet
+		std::vector<unsigned char> data;
+	};
+
+	std::mutex m_Mutex;
+	HandleTable<Readback> m_Readbacks;
+	std::vector<PluginHandle> m_Requests; // not taken yet, oldest first
+};
@@ -1,7 +1,48 @@
 #include "RenderAPI.h"
 #include "PlatformBase.h"
+#include "RenderCommandList.h"
 #include "Unity/IUnityGraphics.h"
 
+#include <string.h>
+
+
+void RenderAPI::ExecuteCommandList(const RenderCommandList& commandList)
+{
+	for (const RenderCommand& command : commandList)
+	{
+		switch (command.type)
+		{
+		case kRenderCommand_UploadTexture:
+		{
+			int rowPitch;
+			unsigned char* dst = (unsigned char*)BeginModifyTexture(command.resource, command.width, command.height, &rowPitch);
+			if (!dst)
+				break;
+			const unsigned char* src = (const unsigned char*)command.data;
+			const size_t rowBytes = (size_t)command.width * 4;
+			for (int y = 0; y < command.height; ++y)
+				memcpy(dst + (size_t)y * rowPitch, src + (size_t)y * command.rowPitch, rowBytes);
+			EndModifyTexture(command.resource, command.width, command.height, rowPitch, dst);
+			break;
+		}
+		case kRenderCommand_UploadVertexBuffer:
+		{
+			size_t bufferSize;
+			void* dst = BeginModifyVertexBuffer(command.resource, &bufferSize);
+			if (!dst)
+				break;
+			if (bufferSize == command.size)
+				memcpy(dst, command.data, command.size);
+			EndModifyVertexBuffer(command.resource);
+			break;
+		}
+		case kRenderCommand_DrawTriangles:
+			DrawSimpleTriangles(command.worldMatrix, command.triangleCount, command.data);
+			break;
+		}
+	}
+}
+
 RenderAPI* CreateRenderAPI(UnityGfxRenderer apiType)
 {
 #	if SUPPORT_D3D11
@@ -12,5 +53,27 @@ RenderAPI* CreateRenderAPI(UnityGfxRenderer apiType)
 	}
 #	endif // if SUPPORT_D3D11
 
+#	if SUPPORT_VULKAN
+	if (apiType == kUnityGfxRendererVulkan)
+	{
+		extern RenderAPI* CreateRenderAPI_Vulkan();
+		return CreateRenderAPI_Vulkan();
+	}
+#	endif // if SUPPORT_VULKAN
+
+#	if SUPPORT_OPENGL_UNIFIED
+	if (apiType == kUnityGfxRendererOpenGLCore || apiType == kUnityGfxRendererOpenGLES30)
+	{
+		extern RenderAPI* CreateRenderAPI_OpenGLCoreES(UnityGfxRenderer apiType);
+		return CreateRenderAPI_OpenGLCoreES(apiType);
+	}
+#	endif // if SUPPORT_OPENGL_UNIFIED
+
+	if (apiType == kUnityGfxRendererNull)
+	{
+		extern RenderAPI* CreateRenderAPI_Null();
+		return CreateRenderAPI_Null();
+	}
+
 	return NULL;
 }
@@ -5,6 +5,10 @@
 #include <stddef.h>
 
 struct IUnityInterfaces;
+class ReadbackQueue;
+class RenderCommandList;
+class WorkerPool;
+struct ReadbackRequest;
 
 // Super-simple "graphics abstraction". This is nothing like how a proper platform abstraction layer would look like;
 // all this does is a base interface for whatever our plugin sample needs. Which is only "draw some triangles"
@@ -14,8 +18,13 @@ struct IUnityInterfaces;
 class RenderAPI
 {
 public:
+	RenderAPI() : m_RendererType(kUnityGfxRendererNull) { }
+	explicit RenderAPI(UnityGfxRenderer rendererType) : m_RendererType(rendererType) { }
 	virtual ~RenderAPI() { }
 
+	// Which backend this is, without a virtual call; see RenderAPIDispatch.h
+	UnityGfxRenderer GetRendererType() const { return m_RendererType; }
+
 
 	// Process general event like initialization, shutdown, device loss/reset etc.
 	virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces) = 0;
@@ -47,6 +56,54 @@ public:
 	// End modifying vertex buffer data.
 	virtual void EndModifyVertexBuffer(void* bufferHandle) = 0;
 
+
+	// Run a frame's recorded operations (see RenderCommandList.h). The default plays them back
+	// through the calls above one by one; backends where each of those calls has a fixed cost
+	// (state queries, staging allocations, flushes) override it to do that work once per list.
+	virtual void ExecuteCommandList(const RenderCommandList& commandList);
+
+	// Zero-copy uploads. Registers a caller-owned host allocation (base and size aligned to
+	// the backend's import granularity, a page on most drivers) with backends that can read
+	// host memory directly; uploads in a command list whose data lies inside it are then
+	// copied by the GPU from there instead of through a staging buffer. Registration is
+	// meant for long-lived arenas: it is imported once and reused for every frame.
+	// While registered, the memory must stay allocated and data must not be overwritten
+	// until the GPU has finished the frame that uploads it (rotate per frame in flight).
+	// Returns false where this isn't supported; uploads then copy as usual.
+	virtual bool RegisterHostMemory(const void* base, size_t size) { return false; }
+	// The import goes away once the GPU is done with it, so keep the memory allocated for
+	// the frames in flight after this, or until the backend is destroyed.
+	virtual void UnregisterHostMemory(const void* base) { }
+	// The GPU frame being recorded and the newest one the GPU has finished, for keeping
+	// registered memory untouched until the frames that upload from it are done. False on
+	// backends that don't count frames; those don't import registered memory, so every
+	// upload has been copied by the time its call returns.
+	virtual bool GetGpuFrameNumbers(unsigned long long* outCurrentFrame, unsigned long long* outSafeFrame) { return false; }
+	// Calls done(userData) once the GPU has finished everything recorded so far, so that
+	// memory unregistered before can go back to its owner. Backends that don't import host
+	// memory call it right away; others may call it later and from another thread.
+	virtual void CallWhenGpuIdle(void (*done)(void* userData), void* userData) { done(userData); }
+
+	// The plugin's worker threads, for backends that can record a large command list in
+	// parallel (see RenderAPI_Vulkan::ExecuteCommandList). NULL takes them away again; the
+	// pool outlives every call made while it is set.
+	virtual void SetWorkerPool(WorkerPool* pool) { }
+
+	// Texture uploads only write mip 0. With this on, every upload (EndModifyTexture and
+	// command list uploads) is followed by rebuilding the rest of the texture's mip chain from
+	// it on the GPU, each level filtered down from the one above. Textures without mips, and
+	// backends or formats that can't do it, are uploaded as before. Off by default.
+	virtual void SetGenerateMipsOnUpload(bool enabled) { }
+
+	// Asynchronous readback (see ReadbackQueue.h), both called from the frame event, outside
+	// any render pass. BeginReadback records a copy of the request's rectangle into memory
+	// the CPU can read and returns without waiting; false if it can't (unsupported backend or
+	// format, rectangle outside the texture), and the request fails. PollReadbacks hands every
+	// copy the GPU has finished since the last call to queue->Complete. Neither may wait for
+	// the GPU.
+	virtual bool BeginReadback(const ReadbackRequest& request) { return false; }
+	virtual void PollReadbacks(ReadbackQueue* queue) { }
+
 	// --------------------------------------------------------------------------
 	// DX12 plugin specific functions
 	// --------------------------------------------------------------------------
@@ -81,6 +138,9 @@ public:
 	virtual unsigned int getSyncInterval() { return 0; }
 	virtual unsigned int getBackbufferWidth() { return 0;  }
 	virtual unsigned int getBackbufferHeight() { return 0; }
+
+private:
+	UnityGfxRenderer m_RendererType;
 };
 
 
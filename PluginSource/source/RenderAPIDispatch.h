@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PlatformBase.h"
+#include "RenderAPI.h"
+#include "RenderAPI_D3D11.h"
+#include "RenderAPI_Null.h"
+#include "RenderAPI_OpenGLCoreES.h"
+#include "RenderAPI_Vulkan.h"
+
+// Backends CreateRenderAPI can return in this build, RenderAPI_Null included
+#define RENDERAPI_BACKEND_COUNT (SUPPORT_D3D11 + SUPPORT_VULKAN + SUPPORT_OPENGL_UNIFIED + 1)
+
+// Calls body(backend) with api cast to its concrete backend class. The backends are
+// final, so every call body makes on them is a direct call the compiler may inline
+// (across translation units with link-time code generation), instead of a vtable load
+// per call.
+//
+// With one backend compiled in there is nothing to pick and the cast is unconditional.
+// With several it is one switch on RenderAPI::GetRendererType() per batch of calls, so
+// put the whole batch (Begin, write, End) in body rather than dispatching per call.
+// Anything else (e.g. a backend from another build flavour) takes the virtual path.
+template<typename Body>
+inline void DispatchRenderAPI(RenderAPI* api, const Body& body)
+{
+#if RENDERAPI_BACKEND_COUNT == 1
+	body(static_cast<RenderAPI_Null*>(api));
+#else
+	switch (api->GetRendererType())
+	{
+#	if SUPPORT_D3D11
+	case kUnityGfxRendererD3D11:
+		body(static_cast<RenderAPI_D3D11*>(api));
+		break;
+#	endif
+#	if SUPPORT_VULKAN
+	case kUnityGfxRendererVulkan:
+		body(static_cast<RenderAPI_Vulkan*>(api));
+		break;
+#	endif
+#	if SUPPORT_OPENGL_UNIFIED
+	case kUnityGfxRendererOpenGLCore:
+	case kUnityGfxRendererOpenGLES30:
+		body(static_cast<RenderAPI_OpenGLCoreES*>(api));
+		break;
+#	endif
+	case kUnityGfxRendererNull:
+		body(static_cast<RenderAPI_Null*>(api));
+		break;
+	default:
+		body(api);
+		break;
+	}
+#endif
+}
@@ -1,50 +1,13 @@
-#include "RenderAPI.h"
-#include "PlatformBase.h"
+#include "RenderAPI_D3D11.h"
 
 // Direct3D 11 implementation of RenderAPI.
 
 #if SUPPORT_D3D11
 
 #include <assert.h>
-#include <d3d11.h>
 #include "Unity/IUnityGraphicsD3D11.h"
 
 
-class RenderAPI_D3D11 : public RenderAPI
-{
-public:
-	RenderAPI_D3D11();
-	virtual ~RenderAPI_D3D11() { }
-
-	virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
-
-	virtual bool GetUsesReverseZ() { return (int)m_Device->GetFeatureLevel() >= (int)D3D_FEATURE_LEVEL_10_0; }
-
-	virtual void DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
-
-	virtual void* BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch);
-	virtual void EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr);
-
-	virtual void* BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize);
-	virtual void EndModifyVertexBuffer(void* bufferHandle);
-
-private:
-	void CreateResources();
-	void ReleaseResources();
-
-private:
-	ID3D11Device* m_Device;
-	ID3D11Buffer* m_VB; // vertex buffer
-	ID3D11Buffer* m_CB; // constant buffer
-	ID3D11VertexShader* m_VertexShader;
-	ID3D11PixelShader* m_PixelShader;
-	ID3D11InputLayout* m_InputLayout;
-	ID3D11RasterizerState* m_RasterState;
-	ID3D11BlendState* m_BlendState;
-	ID3D11DepthStencilState* m_DepthState;
-};
-
-
 RenderAPI* CreateRenderAPI_D3D11()
 {
 	return new RenderAPI_D3D11();
@@ -104,7 +67,8 @@ const BYTE kPixelShaderCode[]=
 
 
 RenderAPI_D3D11::RenderAPI_D3D11()
-	: m_Device(NULL)
+	: RenderAPI(kUnityGfxRendererD3D11)
+	, m_Device(NULL)
 	, m_VB(NULL)
 	, m_CB(NULL)
 	, m_VertexShader(NULL)
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "PlatformBase.h"
+#include "RenderAPI.h"
+
+#if SUPPORT_D3D11
+
+#include <d3d11.h>
+
+// Declared here rather than in RenderAPI_D3D11.cpp so RenderAPIDispatch.h can call it
+// directly; final, so those calls need no vtable.
+class RenderAPI_D3D11 final : public RenderAPI
+{
+public:
+	RenderAPI_D3D11();
+	virtual ~RenderAPI_D3D11() { }
+
+	virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
+
+	virtual bool GetUsesReverseZ() { return (int)m_Device->GetFeatureLevel() >= (int)D3D_FEATURE_LEVEL_10_0; }
+
+	virtual void DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
+
+	virtual void* BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch);
+	virtual void EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr);
+
+	virtual void* BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize);
+	virtual void EndModifyVertexBuffer(void* bufferHandle);
+
+private:
+	void CreateResources();
+	void ReleaseResources();
+
+private:
+	ID3D11Device* m_Device;
+	ID3D11Buffer* m_VB; // vertex buffer
+	ID3D11Buffer* m_CB; // constant buffer
+	ID3D11VertexShader* m_VertexShader;
+	ID3D11PixelShader* m_PixelShader;
+	ID3D11InputLayout* m_InputLayout;
+	ID3D11RasterizerState* m_RasterState;
+	ID3D11BlendState* m_BlendState;
+	ID3D11DepthStencilState* m_DepthState;
+};
+
+#endif // #if SUPPORT_D3D11
@@ -0,0 +1,184 @@
+#include "RenderAPI_Null.h"
+
+// Host-memory implementation of RenderAPI; see RenderAPI_Null.h.
+
+#include <string.h>
+
+
+// Padded like D3D12's upload pitch, so callers always exercise their row-by-row copy
+// rather than getting away with one memcpy because the pitch happened to be tight.
+static const int kTextureRowAlignment = 256;
+
+
+RenderAPI* CreateRenderAPI_Null()
+{
+	return new RenderAPI_Null();
+}
+
+
+RenderAPI_Null::RenderAPI_Null()
+	: RenderAPI(kUnityGfxRendererNull)
+{
+	memset(&m_Counters, 0, sizeof(m_Counters));
+}
+
+
+void RenderAPI_Null::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces)
+{
+	// No device to set up or lose; resources live as long as the backend
+}
+
+
+void RenderAPI_Null::DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4)
+{
+	if (triangleCount <= 0)
+		return;
+
+	// float3 position + byte4 color
+	const size_t vertexCount = (size_t)triangleCount * 3;
+	DrawRecord record;
+	memcpy(record.worldMatrix, worldMatrix, sizeof(record.worldMatrix));
+	record.firstVertex = m_VertexLog.size() / 16;
+	record.triangleCount = triangleCount;
+	m_DrawLog.push_back(record);
+
+	const unsigned char* vertices = (const unsigned char*)verticesFloat3Byte4;
+	m_VertexLog.insert(m_VertexLog.end(), vertices, vertices + vertexCount * 16);
+
+	++m_Counters.draws;
+	m_Counters.triangles += triangleCount;
+}
+
+
+void* RenderAPI_Null::BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch)
+{
+	HostResource* texture = LookupResource(textureHandle);
+	if (!texture || texture->width == 0 || texture->mapped
+		|| texture->width != textureWidth || texture->height != textureHeight)
+	{
+		++m_Counters.failedMaps;
+		return NULL;
+	}
+
+	texture->mapped = true;
+	*outRowPitch = texture->rowPitch;
+	return texture->data.data();
+}
+
+
+void RenderAPI_Null::EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr)
+{
+	HostResource* texture = LookupResource(textureHandle);
+	if (!texture || !texture->mapped)
+		return;
+
+	texture->mapped = false;
+	++m_Counters.textureUploads;
+	m_Counters.textureBytes += (unsigned long long)textureWidth * 4 * textureHeight;
+}
+
+
+void* RenderAPI_Null::BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize)
+{
+	HostResource* buffer = LookupResource(bufferHandle);
+	if (!buffer || buffer->width != 0 || buffer->mapped)
+	{
+		++m_Counters.failedMaps;
+		return NULL;
+	}
+
+	buffer->mapped = true;
+	*outBufferSize = buffer->data.size();
+	return buffer->data.data();
+}
+
+
+void RenderAPI_Null::EndModifyVertexBuffer(void* bufferHandle)
+{
+	HostResource* buffer = LookupResource(bufferHandle);
+	if (!buffer || !buffer->mapped)
+		return;
+
+	buffer->mapped = false;
+	++m_Counters.vertexBufferUploads;
+	m_Counters.vertexBufferBytes += buffer->data.size();
+}
+
+
+void* RenderAPI_Null::CreateTexture(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return NULL;
+
+	std::unique_ptr<HostResource> texture(new HostResource());
+	texture->width = width;
+	texture->height = height;
+	texture->rowPitch = (width * 4 + kTextureRowAlignment - 1) / kTextureRowAlignment * kTextureRowAlignment;
+	texture->data.resize((size_t)texture->rowPitch * height);
+	texture->mapped = false;
+
+	void* handle = texture.get();
+	m_Resources[handle] = std::move(texture);
+	return handle;
+}
+
+
+void* RenderAPI_Null::CreateVertexBuffer(size_t sizeInBytes)
+{
+	if (sizeInBytes == 0)
+		return NULL;
+
+	std::unique_ptr<HostResource> buffer(new HostResource());
+	buffer->width = 0;
+	buffer->height = 0;
+	buffer->rowPitch = 0;
+	buffer->data.resize(sizeInBytes);
+	buffer->mapped = false;
+
+	void* handle = buffer.get();
+	m_Resources[handle] = std::move(buffer);
+	return handle;
+}
+
+
+const unsigned char* RenderAPI_Null::GetTextureData(void* textureHandle) const
+{
+	const HostResource* texture = LookupResource(textureHandle);
+	return texture && texture->width != 0 ? texture->data.data() : NULL;
+}
+
+
+const unsigned char* RenderAPI_Null::GetVertexBufferData(void* bufferHandle) const
+{
+	const HostResource* buffer = LookupResource(bufferHandle);
+	return buffer && buffer->width == 0 ? buffer->data.data() : NULL;
+}
+
+
+int RenderAPI_Null::GetTextureRowPitch(void* textureHandle) const
+{
+	const HostResource* texture = LookupResource(textureHandle);
+	return texture ? texture->rowPitch : 0;
+}
+
+
+void RenderAPI_Null::ResetCounters()
+{
+	memset(&m_Counters, 0, sizeof(m_Counters));
+	m_VertexLog.clear();
+	m_DrawLog.clear();
+}
+
+
+RenderAPI_Null::HostResource* RenderAPI_Null::LookupResource(void* handle)
+{
+	std::map<void*, std::unique_ptr<HostResource>>::iterator it = m_Resources.find(handle);
+	return it != m_Resources.end() ? it->second.get() : NULL;
+}
+
+
+const RenderAPI_Null::HostResource* RenderAPI_Null::LookupResource(void* handle) const
+{
+	std::map<void*, std::unique_ptr<HostResource>>::const_iterator it = m_Resources.find(handle);
+	return it != m_Resources.end() ? it->second.get() : NULL;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "PlatformBase.h"
+#include "RenderAPI.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+// Host-memory implementation of RenderAPI, created for Unity's null device (batch mode,
+// -nographics) or directly by a benchmark/test host.
+//
+// It honours the whole contract without a driver: Begin*Modify* hand out real buffers,
+// draws are appended to a vertex log, and every call is counted. That leaves only the
+// plugin's own CPU work (recording, copying, dispatch) to measure, and the results are
+// the same on every run and machine.
+//
+// Unity's null device has no native resources, so texture and vertex buffer handles come
+// from CreateTexture/CreateVertexBuffer; Begin*Modify* return NULL for anything else.
+// Single-threaded, like the other backends (render thread only).
+class RenderAPI_Null final : public RenderAPI
+{
+public:
+	struct Counters
+	{
+		unsigned long long draws;
+		unsigned long long triangles;
+		unsigned long long textureUploads;
+		unsigned long long textureBytes;
+		unsigned long long vertexBufferUploads;
+		unsigned long long vertexBufferBytes;
+		unsigned long long failedMaps; // unknown handle, wrong size, or already mapped
+	};
+
+	// One DrawSimpleTriangles call; its vertices are GetVertexLog()[firstVertex * 16 ...]
+	struct DrawRecord
+	{
+		float worldMatrix[16];
+		size_t firstVertex;
+		int triangleCount;
+	};
+
+	RenderAPI_Null();
+	virtual ~RenderAPI_Null() { }
+
+	virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
+
+	virtual bool GetUsesReverseZ() { return false; }
+
+	virtual void DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
+
+	virtual void* BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch);
+	virtual void EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr);
+
+	virtual void* BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize);
+	virtual void EndModifyVertexBuffer(void* bufferHandle);
+
+	// RGBA8 texture / vertex buffer in host memory, alive until the backend is destroyed.
+	// The returned handles are what Unity's GetNative*Ptr would return on a real device.
+	void* CreateTexture(int width, int height);
+	void* CreateVertexBuffer(size_t sizeInBytes);
+
+	// Current contents, NULL for unknown handles; rows of a texture are GetTextureRowPitch() apart
+	const unsigned char* GetTextureData(void* textureHandle) const;
+	const unsigned char* GetVertexBufferData(void* bufferHandle) const;
+	int GetTextureRowPitch(void* textureHandle) const;
+
+	const Counters& GetCounters() const { return m_Counters; }
+	const std::vector<unsigned char>& GetVertexLog() const { return m_VertexLog; }
+	const std::vector<DrawRecord>& GetDrawLog() const { return m_DrawLog; }
+	// Clears counters and logs, keeps resources (and the logs' capacity)
+	void ResetCounters();
+
+private:
+	struct HostResource
+	{
+		std::vector<unsigned char> data;
+		int width;     // textures only
+		int height;
+		int rowPitch;
+		bool mapped;
+	};
+
+	HostResource* LookupResource(void* handle);
+	const HostResource* LookupResource(void* handle) const;
+
+	std::map<void*, std::unique_ptr<HostResource>> m_Resources;
+	Counters m_Counters;
+	std::vector<unsigned char> m_VertexLog;
+	std::vector<DrawRecord> m_DrawLog;
+};
@@ -1,5 +1,4 @@
-#include "RenderAPI.h"
-#include "PlatformBase.h"
+#include "RenderAPI_OpenGLCoreES.h"
 
 // OpenGL Core profile (desktop) or OpenGL ES (mobile) implementation of RenderAPI.
 // Supports several flavors: Core, ES2, ES3
@@ -9,62 +8,11 @@
 
 
 #include <assert.h>
-#if UNITY_IOS || UNITY_TVOS
-#	include <OpenGLES/ES2/gl.h>
-#elif UNITY_ANDROID || UNITY_WEBGL
-#	include <GLES2/gl2.h>
-#elif UNITY_OSX
-#	include <OpenGL/gl3.h>
-#elif UNITY_WIN
-// On Windows, use gl3w to initialize and load OpenGL Core functions. In principle any other
-// library (like GLEW, GLFW etc.) can be used; here we use gl3w since it's simple and
-// straightforward.
-#	include "gl3w/gl3w.h"
-#elif UNITY_LINUX
-#	define GL_GLEXT_PROTOTYPES
-#	include <GL/gl.h>
-#elif UNITY_EMBEDDED_LINUX
-#	include <GLES2/gl2.h>
-#if SUPPORT_OPENGL_CORE
-#	define GL_GLEXT_PROTOTYPES
-#	include <GL/gl.h>
-#endif
-#else
-#	error Unknown platform
-#endif
-
-
-class RenderAPI_OpenGLCoreES : public RenderAPI
-{
-public:
-	RenderAPI_OpenGLCoreES(UnityGfxRenderer apiType);
-	virtual ~RenderAPI_OpenGLCoreES() { }
-
-	virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
 
-	virtual bool GetUsesReverseZ() { return false; }
-
-	virtual void DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
-
-	virtual void* BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch);
-	virtual void EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr);
-
-	virtual void* BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize);
-	virtual void EndModifyVertexBuffer(void* bufferHandle);
-
-private:
-	void CreateResources();
-
-private:
-	UnityGfxRenderer m_APIType;
-	GLuint m_VertexShader;
-	GLuint m_FragmentShader;
-	GLuint m_Program;
-	GLuint m_VertexArray;
-	GLuint m_VertexBuffer;
-	int m_UniformWorldMatrix;
-	int m_UniformProjMatrix;
-};
+// ES 3.0, missing from the ES2 headers used on mobile
+#ifndef GL_TEXTURE_MAX_LEVEL
+#	define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
 
 
 RenderAPI* CreateRenderAPI_OpenGLCoreES(UnityGfxRenderer apiType)
@@ -193,7 +141,12 @@ void RenderAPI_OpenGLCoreES::CreateResources()
 
 
 RenderAPI_OpenGLCoreES::RenderAPI_OpenGLCoreES(UnityGfxRenderer apiType)
-	: m_APIType(apiType)
+	: RenderAPI(apiType)
+	, m_APIType(apiType)
+	, m_GenerateMips(false)
+#	if SUPPORT_OPENGL_CORE
+	, m_ReadbackFramebuffer(0)
+#	endif
 {
 }
 
@@ -207,6 +160,7 @@ void RenderAPI_OpenGLCoreES::ProcessDeviceEvent(UnityGfxDeviceEventType type, IU
 	else if (type == kUnityGfxDeviceEventShutdown)
 	{
 		//@TODO: release resources
+		DestroyReadbacks();
 	}
 }
 
@@ -284,6 +238,16 @@ void RenderAPI_OpenGLCoreES::EndModifyTexture(void* textureHandle, int textureWi
 	glBindTexture(GL_TEXTURE_2D, gltex);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGBA, GL_UNSIGNED_BYTE, dataPtr);
 	delete[](unsigned char*)dataPtr;
+
+	// Unity sets the max level to the texture's last mip. A texture without mips would get
+	// levels Unity doesn't know about, so leave it alone.
+	if (m_GenerateMips)
+	{
+		GLint maxLevel = 0;
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+		if (maxLevel > 0)
+			glGenerateMipmap(GL_TEXTURE_2D);
+	}
 }
 
 void* RenderAPI_OpenGLCoreES::BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize)
@@ -309,4 +273,133 @@ void RenderAPI_OpenGLCoreES::EndModifyVertexBuffer(void* bufferHandle)
 #	endif
 }
 
+// Readbacks need pack buffers and fences; the ES headers used here are ES2 only, so ES goes
+// without them
+static const size_t kMaxReadbackSlots = 16;
+
+bool RenderAPI_OpenGLCoreES::BeginReadback(const ReadbackRequest& request)
+{
+#	if SUPPORT_OPENGL_CORE
+	if (m_APIType != kUnityGfxRendererOpenGLCore)
+		return false;
+
+	// A free slot, else a new one while under the limit
+	ReadbackSlot* slot = NULL;
+	for (size_t i = 0; i < m_ReadbackSlots.size() && !slot; ++i)
+		if (!m_ReadbackSlots[i].fence)
+			slot = &m_ReadbackSlots[i];
+	if (!slot)
+	{
+		if (m_ReadbackSlots.size() >= kMaxReadbackSlots)
+			return false;
+		ReadbackSlot newSlot = {};
+		glGenBuffers(1, &newSlot.buffer);
+		m_ReadbackSlots.push_back(newSlot);
+		slot = &m_ReadbackSlots.back();
+	}
+	if (!m_ReadbackFramebuffer)
+		glGenFramebuffers(1, &m_ReadbackFramebuffer);
+
+	// Leave Unity's bindings as they were
+	GLint previousFramebuffer = 0, previousPackBuffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPackBuffer);
+
+	const GLsizeiptr size = (GLsizeiptr)request.width * request.height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+	if (slot->capacity < size)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		slot->capacity = size;
+	}
+
+	// Our own framebuffer around the texture, never the default one
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_ReadbackFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, (GLuint)(size_t)request.textureHandle, 0);
+	const bool complete = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	if (complete)
+	{
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(request.x, request.y, request.width, request.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot->id = request.id;
+		slot->width = request.width;
+		slot->height = request.height;
+	}
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, previousPackBuffer);
+	return complete && slot->fence;
+#	else
+	return false;
+#	endif
+}
+
+void RenderAPI_OpenGLCoreES::PollReadbacks(ReadbackQueue* queue)
+{
+#	if SUPPORT_OPENGL_CORE
+	GLint previousPackBuffer = -1;
+	for (size_t i = 0; i < m_ReadbackSlots.size(); )
+	{
+		ReadbackSlot& slot = m_ReadbackSlots[i];
+		if (!slot.fence)
+		{
+			++i;
+			continue;
+		}
+		// Zero timeout: only asks. No flush either, Unity flushes at least once a frame.
+		const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+		{
+			++i;
+			continue;
+		}
+		if (status == GL_WAIT_FAILED)
+		{
+			// Nothing says the copy ever lands in this buffer; give up on both
+			queue->Fail(slot.id);
+			glDeleteSync(slot.fence);
+			glDeleteBuffers(1, &slot.buffer);
+			m_ReadbackSlots.erase(m_ReadbackSlots.begin() + i);
+			continue;
+		}
+
+		if (previousPackBuffer < 0)
+			glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPackBuffer);
+		const GLsizeiptr size = (GLsizeiptr)slot.width * slot.height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		if (const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT))
+		{
+			queue->Complete(slot.id, data, (size_t)slot.width * 4);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		else
+			queue->Fail(slot.id);
+		glDeleteSync(slot.fence);
+		slot.fence = NULL;
+		++i;
+	}
+	if (previousPackBuffer >= 0)
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, previousPackBuffer);
+#	endif
+}
+
+void RenderAPI_OpenGLCoreES::DestroyReadbacks()
+{
+#	if SUPPORT_OPENGL_CORE
+	for (size_t i = 0; i < m_ReadbackSlots.size(); ++i)
+	{
+		if (m_ReadbackSlots[i].fence)
+			glDeleteSync(m_ReadbackSlots[i].fence);
+		glDeleteBuffers(1, &m_ReadbackSlots[i].buffer);
+	}
+	m_ReadbackSlots.clear();
+	if (m_ReadbackFramebuffer)
+		glDeleteFramebuffers(1, &m_ReadbackFramebuffer);
+	m_ReadbackFramebuffer = 0;
+#	endif
+}
+
 #endif // #if SUPPORT_OPENGL_UNIFIED
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "PlatformBase.h"
+#include "ReadbackQueue.h"
+#include "RenderAPI.h"
+
+#if SUPPORT_OPENGL_UNIFIED
+
+#if UNITY_IOS || UNITY_TVOS
+#	include <OpenGLES/ES2/gl.h>
+#elif UNITY_ANDROID || UNITY_WEBGL
+#	include <GLES2/gl2.h>
+#elif UNITY_OSX
+#	include <OpenGL/gl3.h>
+#elif UNITY_WIN
+// On Windows, use gl3w to initialize and load OpenGL Core functions. In principle any other
+// library (like GLEW, GLFW etc.) can be used; here we use gl3w since it's simple and
+// straightforward.
+#	include "gl3w/gl3w.h"
+#elif UNITY_LINUX
+#	define GL_GLEXT_PROTOTYPES
+#	include <GL/gl.h>
+#elif UNITY_EMBEDDED_LINUX
+#	include <GLES2/gl2.h>
+#if SUPPORT_OPENGL_CORE
+#	define GL_GLEXT_PROTOTYPES
+#	include <GL/gl.h>
+#endif
+#else
+#	error Unknown platform
+#endif
+
+#include <vector>
+
+// OpenGL Core profile (desktop) or OpenGL ES (mobile) implementation of RenderAPI.
+// Declared here rather than in RenderAPI_OpenGLCoreES.cpp so RenderAPIDispatch.h can call it
+// directly; final, so those calls need no vtable.
+class RenderAPI_OpenGLCoreES final : public RenderAPI
+{
+public:
+	RenderAPI_OpenGLCoreES(UnityGfxRenderer apiType);
+	virtual ~RenderAPI_OpenGLCoreES() { }
+
+	virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
+
+	virtual bool GetUsesReverseZ() { return false; }
+
+	virtual void DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
+
+	virtual void* BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch);
+	virtual void EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr);
+
+	virtual void* BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize);
+	virtual void EndModifyVertexBuffer(void* bufferHandle);
+
+	virtual void SetGenerateMipsOnUpload(bool enabled) { m_GenerateMips = enabled; }
+
+	virtual bool BeginReadback(const ReadbackRequest& request);
+	virtual void PollReadbacks(ReadbackQueue* queue);
+
+private:
+	void CreateResources();
+	void DestroyReadbacks();
+
+private:
+	UnityGfxRenderer m_APIType;
+	GLuint m_VertexShader;
+	GLuint m_FragmentShader;
+	GLuint m_Program;
+	GLuint m_VertexArray;
+	GLuint m_VertexBuffer;
+	int m_UniformWorldMatrix;
+	int m_UniformProjMatrix;
+	bool m_GenerateMips;
+
+#	if SUPPORT_OPENGL_CORE
+	// Readbacks go through a ring of pack buffers: glReadPixels into a bound
+	// GL_PIXEL_PACK_BUFFER only queues the copy, and the fence after it says when the
+	// buffer can be mapped without a stall. Slots are reused oldest first.
+	struct ReadbackSlot
+	{
+		GLuint buffer;
+		GLsizeiptr capacity;
+		GLsync fence;        // NULL while the slot is free
+		PluginHandle id;
+		int width;
+		int height;
+	};
+	std::vector<ReadbackSlot> m_ReadbackSlots;
+	GLuint m_ReadbackFramebuffer;
+#	endif
+};
+
+#endif // #if SUPPORT_OPENGL_UNIFIED
@@ -1,64 +1,79 @@
 #include "RenderAPI.h"
+#include "RenderAPI_Vulkan.h"
 #include "PlatformBase.h"
+#include "RenderCommandList.h"
 
 #if SUPPORT_VULKAN
 
+#include <algorithm>
+#include <iostream>
 #include <string.h>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <math.h>
 
-// This plugin does not link to the Vulkan loader, easier to support multiple APIs and systems that don't have Vulkan support
-#define VK_NO_PROTOTYPES
-#include "Unity/IUnityGraphicsVulkan.h"
-
-#define UNITY_USED_VULKAN_API_FUNCTIONS(apply) \
-    apply(vkCreateInstance); \
-    apply(vkCmdBeginRenderPass); \
-    apply(vkCreateBuffer); \
-    apply(vkGetPhysicalDeviceMemoryProperties); \
-    apply(vkGetBufferMemoryRequirements); \
-    apply(vkMapMemory); \
-    apply(vkBindBufferMemory); \
-    apply(vkAllocateMemory); \
-    apply(vkDestroyBuffer); \
-    apply(vkFreeMemory); \
-    apply(vkUnmapMemory); \
-    apply(vkQueueWaitIdle); \
-    apply(vkDeviceWaitIdle); \
-    apply(vkCmdCopyBufferToImage); \
-    apply(vkFlushMappedMemoryRanges); \
-    apply(vkCreatePipelineLayout); \
-    apply(vkCreateShaderModule); \
-    apply(vkDestroyShaderModule); \
-    apply(vkCreateGraphicsPipelines); \
-    apply(vkCmdBindPipeline); \
-    apply(vkCmdDraw); \
-    apply(vkCmdPushConstants); \
-    apply(vkCmdBindVertexBuffers); \
-    apply(vkDestroyPipeline); \
-    apply(vkDestroyPipelineLayout);
-    
-#define VULKAN_DEFINE_API_FUNCPTR(func) static PFN_##func func
-VULKAN_DEFINE_API_FUNCPTR(vkGetInstanceProcAddr);
-UNITY_USED_VULKAN_API_FUNCTIONS(VULKAN_DEFINE_API_FUNCPTR);
-#undef VULKAN_DEFINE_API_FUNCPTR
-
-static void LoadVulkanAPI(PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance)
-{
-    if (!vkGetInstanceProcAddr && getInstanceProcAddr)
-        vkGetInstanceProcAddr = getInstanceProcAddr;
-
-	if (!vkCreateInstance)
-		vkCreateInstance = (PFN_vkCreateInstance)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance");
-
-#define LOAD_VULKAN_FUNC(fn) if (!fn) fn = (PFN_##fn)vkGetInstanceProcAddr(instance, #fn)
-    UNITY_USED_VULKAN_API_FUNCTIONS(LOAD_VULKAN_FUNC);
-#undef LOAD_VULKAN_FUNC
+#include "VulkanDispatch.h"
+#include "VulkanProfiler.h"
+#include "WorkerPool.h"
+
+// Loader entry points the creation hooks below need before any device exists; everything
+// else goes through the device's VulkanDispatch table
+static PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = NULL;
+static PFN_vkCreateInstance vkCreateInstance = NULL;
+// What Unity's vkCmdBeginRenderPass resolved to before Hook_vkCmdBeginRenderPass replaced it
+static PFN_vkCmdBeginRenderPass s_UnityCmdBeginRenderPass = NULL;
+static PFN_vkCmdNextSubpass s_UnityCmdNextSubpass = NULL;
+static PFN_vkDestroyRenderPass s_UnityDestroyRenderPass = NULL;
+// Pipelines cached per render pass by the live RenderAPI_Vulkan, for Hook_vkDestroyRenderPass
+static std::mutex s_TrianglePipelinesMutex;
+static VulkanTrianglePipelines* s_TrianglePipelines = NULL;
+
+// Set up by Hook_vkCreateDevice when VK_EXT_nested_command_buffer got enabled. Unity's subpasses
+// then begin with VK_SUBPASS_CONTENTS_INLINE_AND_SECONDARY_COMMAND_BUFFERS_EXT, so the plugin
+// may add secondaries recorded on its workers next to Unity's inline commands.
+static bool s_NestedCommandBuffersEnabled = false;
+
+// Set up by Hook_vkCreateDevice when VK_EXT_graphics_pipeline_library got enabled and the
+// driver says linking libraries is fast; VulkanTrianglePipelines then builds from parts.
+static bool s_GraphicsPipelineLibraryEnabled = false;
+
+// The subpass each of Unity's command buffers is in, as far as the hooks above saw it begin.
+// Secondaries have to name the render pass, subpass and framebuffer they continue, and get
+// the render area as viewport and scissor since they don't inherit dynamic state.
+struct SecondaryRenderPassState
+{
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+    uint32_t subpass;
+    VkRect2D renderArea;
+};
+static std::mutex s_SecondaryRenderPassMutex;
+static std::map<VkCommandBuffer, SecondaryRenderPassState> s_SecondaryRenderPasses;
+
+static VkSubpassContents AllowSecondaries(VkSubpassContents contents)
+{
+#ifdef VK_EXT_nested_command_buffer
+    if (s_NestedCommandBuffersEnabled && contents == VK_SUBPASS_CONTENTS_INLINE)
+        return VK_SUBPASS_CONTENTS_INLINE_AND_SECONDARY_COMMAND_BUFFERS_EXT;
+#endif
+    return contents;
 }
 
 static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdBeginRenderPass(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, VkSubpassContents contents)
 {
+    contents = AllowSecondaries(contents);
+    if (contents != VK_SUBPASS_CONTENTS_INLINE && contents != VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+    {
+        SecondaryRenderPassState state;
+        state.renderPass = pRenderPassBegin->renderPass;
+        state.framebuffer = pRenderPassBegin->framebuffer;
+        state.subpass = 0;
+        state.renderArea = pRenderPassBegin->renderArea;
+        std::lock_guard<std::mutex> lock(s_SecondaryRenderPassMutex);
+        s_SecondaryRenderPasses[commandBuffer] = state;
+    }
+
     // Change this to 'true' to override the clear color with green
 	const bool allowOverrideClearColor = false;
     if (pRenderPassBegin->clearValueCount <= 16 && pRenderPassBegin->clearValueCount > 0 && allowOverrideClearColor)
@@ -75,41 +90,530 @@ static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdBeginRenderPass(VkCommandBuffer comm
             clearValues[i].color.float32[2] = 0.0;
             clearValues[i].color.float32[3] = 1.0;
         }
-        vkCmdBeginRenderPass(commandBuffer, &patchedBeginInfo, contents);
+        s_UnityCmdBeginRenderPass(commandBuffer, &patchedBeginInfo, contents);
     }
     else
     {
-        vkCmdBeginRenderPass(commandBuffer, pRenderPassBegin, contents);
+        s_UnityCmdBeginRenderPass(commandBuffer, pRenderPassBegin, contents);
+    }
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdNextSubpass(VkCommandBuffer commandBuffer, VkSubpassContents contents)
+{
+    contents = AllowSecondaries(contents);
+    if (contents != VK_SUBPASS_CONTENTS_INLINE && contents != VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+    {
+        std::lock_guard<std::mutex> lock(s_SecondaryRenderPassMutex);
+        std::map<VkCommandBuffer, SecondaryRenderPassState>::iterator it = s_SecondaryRenderPasses.find(commandBuffer);
+        if (it != s_SecondaryRenderPasses.end())
+            ++it->second.subpass;
+    }
+    s_UnityCmdNextSubpass(commandBuffer, contents);
+}
+
+// Unity may create a new render pass with the handle value of one it destroyed, so the
+// pipelines built for the old one have to go with it
+static VKAPI_ATTR void VKAPI_CALL Hook_vkDestroyRenderPass(VkDevice device, VkRenderPass renderPass, const VkAllocationCallbacks* pAllocator)
+{
+    {
+        std::lock_guard<std::mutex> lock(s_TrianglePipelinesMutex);
+        if (s_TrianglePipelines)
+            s_TrianglePipelines->OnRenderPassDestroyed(renderPass);
+    }
+    s_UnityDestroyRenderPass(device, renderPass, pAllocator);
+}
+
+// Whether secondaries may be executed in the subpass recordingState is in, and how to inherit it
+static bool GetSecondaryRenderPassState(const UnityVulkanRecordingState& recordingState, SecondaryRenderPassState* outState)
+{
+    if (!s_NestedCommandBuffersEnabled || recordingState.commandBufferLevel != VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+        return false;
+    std::lock_guard<std::mutex> lock(s_SecondaryRenderPassMutex);
+    std::map<VkCommandBuffer, SecondaryRenderPassState>::const_iterator it = s_SecondaryRenderPasses.find(recordingState.commandBuffer);
+    // A pass Unity began some other way (vkCmdBeginRenderPass2) leaves a stale entry behind;
+    // it can't match what Unity reports now. recordingState.renderPass may only be compatible
+    // with the one Unity began, so the framebuffer is what identifies the pass.
+    if (it == s_SecondaryRenderPasses.end() || it->second.framebuffer != recordingState.framebuffer
+        || static_cast<int>(it->second.subpass) != recordingState.subPassIndex)
+        return false;
+    *outState = it->second;
+    return true;
+}
+
+// Extensions the hooks below managed to enable on Unity's instance and device
+static VulkanInjectedExtensions s_InjectedExtensions = { false, false, false, false, false, false, false, false, false, false, -1, -1 };
+static VkInstance s_HookedInstance = VK_NULL_HANDLE;
+
+#ifdef VK_EXT_host_image_copy
+// Set up by Hook_vkCreateDevice when VK_EXT_host_image_copy got enabled, read-only afterwards
+static VkPhysicalDevice s_HostImageCopyPhysicalDevice = VK_NULL_HANDLE;
+static PFN_vkGetPhysicalDeviceImageFormatProperties2 s_GetPhysicalDeviceImageFormatProperties2 = NULL;
+static bool s_HostImageCopyEnabled = false;
+static std::vector<VkImageLayout> s_HostImageCopyDstLayouts;
+// What Unity's vkCreateImage resolved to before Hook_vkCreateImage replaced it
+static PFN_vkCreateImage s_UnityCreateImage = NULL;
+#endif
+
+// Set up by Hook_vkCreateDevice when VK_EXT_external_memory_host got enabled
+static VkDeviceSize s_MinImportedHostPointerAlignment = 0;
+
+static bool HasExtension(const std::vector<VkExtensionProperties>& available, const char* name)
+{
+    for (size_t i = 0; i < available.size(); ++i)
+        if (strcmp(available[i].extensionName, name) == 0)
+            return true;
+    return false;
+}
+
+// Adds the extension to the enabled list unless Unity already asked for it.
+// Returns whether the extension ends up enabled.
+static bool AppendExtension(std::vector<const char*>& enabled, const std::vector<VkExtensionProperties>& available, const char* name)
+{
+    for (size_t i = 0; i < enabled.size(); ++i)
+        if (strcmp(enabled[i], name) == 0)
+            return true;
+
+    if (!HasExtension(available, name))
+        return false;
+
+    enabled.push_back(name);
+    return true;
+}
+
+// A feature bit set in one of Unity's own structs for the patched vkCreateDevice, and what
+// Unity had there
+struct PatchedFeatureFlag
+{
+    VkBool32* flag;
+    VkBool32 original;
+};
+
+static void PatchFeatureFlag(VkBool32* flag, std::vector<PatchedFeatureFlag>* patchedFlags)
+{
+    PatchedFeatureFlag patched = { flag, *flag };
+    patchedFlags->push_back(patched);
+    *flag = VK_TRUE;
+}
+
+// The structs belong to Unity's create info: put them back as they were once the patched call
+// is done, so a retry with Unity's create info asks for exactly what Unity asked for
+static void RestoreFeatureFlags(std::vector<PatchedFeatureFlag>* patchedFlags)
+{
+    for (size_t i = patchedFlags->size(); i-- > 0; )
+        *(*patchedFlags)[i].flag = (*patchedFlags)[i].original;
+    patchedFlags->clear();
+}
+
+// Unity may already chain its own feature structs; the spec does not allow the same feature
+// struct (or VkPhysicalDeviceVulkan12Features next to an individual one) twice, so set the bit
+// in place when it is there (recorded in patchedFlags). Returns false if the caller has to
+// chain its own struct.
+static bool EnableTimelineSemaphoreFeatureInChain(const void* pNext, std::vector<PatchedFeatureFlag>* patchedFlags)
+{
+    for (VkBaseOutStructure* it = (VkBaseOutStructure*)pNext; it != NULL; it = it->pNext)
+    {
+        if (it->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES)
+        {
+            PatchFeatureFlag(&((VkPhysicalDeviceVulkan12Features*)it)->timelineSemaphore, patchedFlags);
+            return true;
+        }
+        if (it->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES)
+        {
+            PatchFeatureFlag(&((VkPhysicalDeviceTimelineSemaphoreFeatures*)it)->timelineSemaphore, patchedFlags);
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef VK_EXT_host_image_copy
+// Same as above for the host image copy feature, which Vulkan 1.4 moved into VkPhysicalDeviceVulkan14Features
+static bool EnableHostImageCopyFeatureInChain(const void* pNext, std::vector<PatchedFeatureFlag>* patchedFlags)
+{
+    for (VkBaseOutStructure* it = (VkBaseOutStructure*)pNext; it != NULL; it = it->pNext)
+    {
+#ifdef VK_VERSION_1_4
+        if (it->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES)
+        {
+            PatchFeatureFlag(&((VkPhysicalDeviceVulkan14Features*)it)->hostImageCopy, patchedFlags);
+            return true;
+        }
+#endif
+        if (it->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT)
+        {
+            PatchFeatureFlag(&((VkPhysicalDeviceHostImageCopyFeaturesEXT*)it)->hostImageCopy, patchedFlags);
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+#ifdef VK_EXT_nested_command_buffer
+// Same for VK_EXT_nested_command_buffer, which no core version has taken in yet
+static bool EnableNestedCommandBufferFeatureInChain(const void* pNext, std::vector<PatchedFeatureFlag>* patchedFlags)
+{
+    for (VkBaseOutStructure* it = (VkBaseOutStructure*)pNext; it != NULL; it = it->pNext)
+    {
+        if (it->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_NESTED_COMMAND_BUFFER_FEATURES_EXT)
+        {
+            PatchFeatureFlag(&((VkPhysicalDeviceNestedCommandBufferFeaturesEXT*)it)->nestedCommandBuffer, patchedFlags);
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+#ifdef VK_EXT_graphics_pipeline_library
+static bool EnableGraphicsPipelineLibraryFeatureInChain(const void* pNext, std::vector<PatchedFeatureFlag>* patchedFlags)
+{
+    for (VkBaseOutStructure* it = (VkBaseOutStructure*)pNext; it != NULL; it = it->pNext)
+    {
+        if (it->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT)
+        {
+            PatchFeatureFlag(&((VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT*)it)->graphicsPipelineLibrary, patchedFlags);
+            return true;
+        }
     }
+    return false;
+}
+#endif
+
+#ifdef VK_EXT_host_image_copy
+// Layouts vkCopyMemoryToImageEXT may write in on this device
+static void QueryHostImageCopyDstLayouts(VkPhysicalDevice physicalDevice)
+{
+    PFN_vkGetPhysicalDeviceProperties2 getPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceProperties2");
+    if (!getPhysicalDeviceProperties2)
+        getPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceProperties2KHR");
+    s_HostImageCopyDstLayouts.clear();
+    if (!getPhysicalDeviceProperties2)
+        return;
+
+    VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties = {};
+    hostImageCopyProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &hostImageCopyProperties;
+    getPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    s_HostImageCopyDstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+    hostImageCopyProperties.pCopyDstLayouts = s_HostImageCopyDstLayouts.data();
+    hostImageCopyProperties.pCopySrcLayouts = NULL;
+    hostImageCopyProperties.copySrcLayoutCount = 0;
+    getPhysicalDeviceProperties2(physicalDevice, &properties);
+    s_HostImageCopyDstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
 }
 
+static bool IsHostImageCopyDstLayout(VkImageLayout layout)
+{
+    for (size_t i = 0; i < s_HostImageCopyDstLayouts.size(); ++i)
+        if (s_HostImageCopyDstLayouts[i] == layout)
+            return true;
+    return false;
+}
+
+// The layout a recreated image is put in for host copies: the one Unity samples from if the
+// device allows it, so Unity's next barrier has nothing to do
+static VkImageLayout ChooseHostImageCopyDstLayout()
+{
+    if (IsHostImageCopyDstLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL))
+        return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    if (IsHostImageCopyDstLayout(VK_IMAGE_LAYOUT_GENERAL))
+        return VK_IMAGE_LAYOUT_GENERAL;
+    return s_HostImageCopyDstLayouts.empty() ? VK_IMAGE_LAYOUT_GENERAL : s_HostImageCopyDstLayouts[0];
+}
+
+// Only plain sampled 2D textures the plugin could upload to get the usage, and only if the
+// driver says it costs nothing on the GPU side (host-transferable images may otherwise lose
+// framebuffer compression or a faster tiling).
+static bool WantsHostTransferUsage(const VkImageCreateInfo& createInfo)
+{
+    const VkImageUsageFlags unwantedUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    const VkImageUsageFlags requiredUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (!s_HostImageCopyEnabled || !s_GetPhysicalDeviceImageFormatProperties2 || createInfo.pNext != NULL
+        || createInfo.imageType != VK_IMAGE_TYPE_2D || createInfo.samples != VK_SAMPLE_COUNT_1_BIT
+        || createInfo.tiling != VK_IMAGE_TILING_OPTIMAL || createInfo.mipLevels != 1 || createInfo.arrayLayers != 1
+        || (createInfo.usage & requiredUsage) != requiredUsage || (createInfo.usage & unwantedUsage) != 0)
+        return false;
+
+    VkPhysicalDeviceImageFormatInfo2 formatInfo = {};
+    formatInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2;
+    formatInfo.format = createInfo.format;
+    formatInfo.type = createInfo.imageType;
+    formatInfo.tiling = createInfo.tiling;
+    formatInfo.usage = createInfo.usage | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+    formatInfo.flags = createInfo.flags;
+
+    VkHostImageCopyDevicePerformanceQueryEXT performance = {};
+    performance.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT;
+    VkImageFormatProperties2 formatProperties = {};
+    formatProperties.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2;
+    formatProperties.pNext = &performance;
+    if (s_GetPhysicalDeviceImageFormatProperties2(s_HostImageCopyPhysicalDevice, &formatInfo, &formatProperties) != VK_SUCCESS)
+        return false;
+    return performance.optimalDeviceAccess == VK_TRUE;
+}
+
+// Installed through IUnityGraphicsVulkan::InterceptVulkanAPI, so it sees every image Unity creates
+static VKAPI_ATTR VkResult VKAPI_CALL Hook_vkCreateImage(VkDevice device, const VkImageCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkImage* pImage)
+{
+    if (WantsHostTransferUsage(*pCreateInfo))
+    {
+        VkImageCreateInfo patchedCreateInfo = *pCreateInfo;
+        patchedCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+        if (s_UnityCreateImage(device, &patchedCreateInfo, pAllocator, pImage) == VK_SUCCESS)
+            return VK_SUCCESS;
+    }
+    return s_UnityCreateImage(device, pCreateInfo, pAllocator, pImage);
+}
+#endif // #ifdef VK_EXT_host_image_copy
+
 static VKAPI_ATTR VkResult VKAPI_CALL Hook_vkCreateInstance(const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkInstance* pInstance)
 {
     vkCreateInstance = (PFN_vkCreateInstance)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance");
-    VkResult result = vkCreateInstance(pCreateInfo, pAllocator, pInstance);
+    PFN_vkEnumerateInstanceExtensionProperties enumerateInstanceExtensionProperties =
+        (PFN_vkEnumerateInstanceExtensionProperties)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceExtensionProperties");
+
+    std::vector<VkExtensionProperties> availableExtensions;
+    if (enumerateInstanceExtensionProperties)
+    {
+        uint32_t count = 0;
+        enumerateInstanceExtensionProperties(NULL, &count, NULL);
+        availableExtensions.resize(count);
+        enumerateInstanceExtensionProperties(NULL, &count, availableExtensions.data());
+        availableExtensions.resize(count);
+    }
+
+    // Instance side of external memory sharing; the device extensions depend on these
+    std::vector<const char*> extensions(pCreateInfo->ppEnabledExtensionNames, pCreateInfo->ppEnabledExtensionNames + pCreateInfo->enabledExtensionCount);
+    AppendExtension(extensions, availableExtensions, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    s_InjectedExtensions.externalMemoryCapabilities = AppendExtension(extensions, availableExtensions, VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+    AppendExtension(extensions, availableExtensions, VK_KHR_EXTERNAL_SEMAPHORE_CAPABILITIES_EXTENSION_NAME);
+
+    VkInstanceCreateInfo patchedCreateInfo = *pCreateInfo;
+    patchedCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    patchedCreateInfo.ppEnabledExtensionNames = extensions.data();
+
+    VkResult result = vkCreateInstance(&patchedCreateInfo, pAllocator, pInstance);
+    if (result != VK_SUCCESS)
+    {
+        // Never be the reason Unity fails to start; retry with exactly what it asked for
+        s_InjectedExtensions.externalMemoryCapabilities = false;
+        result = vkCreateInstance(pCreateInfo, pAllocator, pInstance);
+    }
+
     if (result == VK_SUCCESS)
-        LoadVulkanAPI(vkGetInstanceProcAddr, *pInstance);
- 
+        s_HookedInstance = *pInstance;
+
     return result;
 }
 
-static int FindMemoryTypeIndex(VkPhysicalDeviceMemoryProperties const & physicalDeviceMemoryProperties, VkMemoryRequirements const & memoryRequirements, VkMemoryPropertyFlags memoryPropertyFlags)
+static VKAPI_ATTR VkResult VKAPI_CALL Hook_vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDevice* pDevice)
 {
-    uint32_t memoryTypeBits = memoryRequirements.memoryTypeBits;
+    PFN_vkCreateDevice createDevice = (PFN_vkCreateDevice)vkGetInstanceProcAddr(s_HookedInstance, "vkCreateDevice");
+    PFN_vkEnumerateDeviceExtensionProperties enumerateDeviceExtensionProperties =
+        (PFN_vkEnumerateDeviceExtensionProperties)vkGetInstanceProcAddr(s_HookedInstance, "vkEnumerateDeviceExtensionProperties");
+    PFN_vkGetPhysicalDeviceFeatures2 getPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceFeatures2");
+    if (!getPhysicalDeviceFeatures2)
+        getPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceFeatures2KHR");
+
+    std::vector<VkExtensionProperties> availableExtensions;
+    {
+        uint32_t count = 0;
+        enumerateDeviceExtensionProperties(physicalDevice, NULL, &count, NULL);
+        availableExtensions.resize(count);
+        enumerateDeviceExtensionProperties(physicalDevice, NULL, &count, availableExtensions.data());
+        availableExtensions.resize(count);
+    }
 
-    // Search memtypes to find first index with those properties
-    for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < VK_MAX_MEMORY_TYPES; ++memoryTypeIndex)
+    std::vector<const char*> extensions(pCreateInfo->ppEnabledExtensionNames, pCreateInfo->ppEnabledExtensionNames + pCreateInfo->enabledExtensionCount);
+
+    VulkanInjectedExtensions injected = {};
+    injected.externalMemoryCapabilities = s_InjectedExtensions.externalMemoryCapabilities;
+    injected.externalMemory = injected.externalMemoryCapabilities && AppendExtension(extensions, availableExtensions, VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME);
+#if defined(_WIN32)
+    injected.externalMemoryPlatform = injected.externalMemory && AppendExtension(extensions, availableExtensions, "VK_KHR_external_memory_win32");
+    injected.externalSemaphore = AppendExtension(extensions, availableExtensions, VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME) &&
+        AppendExtension(extensions, availableExtensions, "VK_KHR_external_semaphore_win32");
+#else
+    injected.externalMemoryPlatform = injected.externalMemory && AppendExtension(extensions, availableExtensions, "VK_KHR_external_memory_fd");
+    injected.externalSemaphore = AppendExtension(extensions, availableExtensions, VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME) &&
+        AppendExtension(extensions, availableExtensions, "VK_KHR_external_semaphore_fd");
+#endif
+    injected.memoryBudget = AppendExtension(extensions, availableExtensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    // Lets RegisterHostMemory use caller memory as a copy source (see RenderAPI_Vulkan::RegisterHostMemory)
+    injected.externalMemoryHost = injected.externalMemory && AppendExtension(extensions, availableExtensions, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+
+    VkDeviceCreateInfo patchedCreateInfo = *pCreateInfo;
+
+    // Bits set in Unity's feature structs below, undone right after the patched call
+    std::vector<PatchedFeatureFlag> patchedFlags;
+
+    // Timeline semaphores need the feature enabled, not just the extension
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    if (getPhysicalDeviceFeatures2 && HasExtension(availableExtensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &timelineFeatures;
+        getPhysicalDeviceFeatures2(physicalDevice, &features);
+    }
+    if (timelineFeatures.timelineSemaphore)
+    {
+        injected.timelineSemaphore = AppendExtension(extensions, availableExtensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        timelineFeatures.pNext = const_cast<void*>(patchedCreateInfo.pNext);
+        if (!EnableTimelineSemaphoreFeatureInChain(patchedCreateInfo.pNext, &patchedFlags))
+            patchedCreateInfo.pNext = &timelineFeatures;
+    }
+
+#ifdef VK_EXT_host_image_copy
+    // Lets texture uploads write straight into the image from the CPU (see RenderAPI_Vulkan::HostCopyToTexture)
+    VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures = {};
+    hostImageCopyFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+    if (getPhysicalDeviceFeatures2 && HasExtension(availableExtensions, VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME)
+        && HasExtension(availableExtensions, VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME) && HasExtension(availableExtensions, VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &hostImageCopyFeatures;
+        getPhysicalDeviceFeatures2(physicalDevice, &features);
+    }
+    if (hostImageCopyFeatures.hostImageCopy)
     {
-        if ((memoryTypeBits & 1) == 1)
+        AppendExtension(extensions, availableExtensions, VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME);
+        AppendExtension(extensions, availableExtensions, VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME);
+        injected.hostImageCopy = AppendExtension(extensions, availableExtensions, VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+        hostImageCopyFeatures.pNext = const_cast<void*>(patchedCreateInfo.pNext);
+        if (!EnableHostImageCopyFeatureInChain(patchedCreateInfo.pNext, &patchedFlags))
+            patchedCreateInfo.pNext = &hostImageCopyFeatures;
+    }
+#endif
+
+#ifdef VK_EXT_nested_command_buffer
+    // Lets the plugin execute secondaries inside Unity's inline subpasses (see Hook_vkCmdBeginRenderPass)
+    VkPhysicalDeviceNestedCommandBufferFeaturesEXT nestedCommandBufferFeatures = {};
+    nestedCommandBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_NESTED_COMMAND_BUFFER_FEATURES_EXT;
+    if (getPhysicalDeviceFeatures2 && HasExtension(availableExtensions, VK_EXT_NESTED_COMMAND_BUFFER_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &nestedCommandBufferFeatures;
+        getPhysicalDeviceFeatures2(physicalDevice, &features);
+    }
+    if (nestedCommandBufferFeatures.nestedCommandBuffer)
+    {
+        injected.nestedCommandBuffer = AppendExtension(extensions, availableExtensions, VK_EXT_NESTED_COMMAND_BUFFER_EXTENSION_NAME);
+        // Only the base feature is needed; don't turn on more than that
+        nestedCommandBufferFeatures.nestedCommandBufferRendering = VK_FALSE;
+        nestedCommandBufferFeatures.nestedCommandBufferSimultaneousUse = VK_FALSE;
+        nestedCommandBufferFeatures.pNext = const_cast<void*>(patchedCreateInfo.pNext);
+        if (!EnableNestedCommandBufferFeatureInChain(patchedCreateInfo.pNext, &patchedFlags))
+            patchedCreateInfo.pNext = &nestedCommandBufferFeatures;
+    }
+#endif
+
+#ifdef VK_EXT_graphics_pipeline_library
+    // Lets the triangle pipeline be built from parts off the render thread (see VulkanTrianglePipelines)
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures = {};
+    graphicsPipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    if (getPhysicalDeviceFeatures2 && HasExtension(availableExtensions, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)
+        && HasExtension(availableExtensions, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &graphicsPipelineLibraryFeatures;
+        getPhysicalDeviceFeatures2(physicalDevice, &features);
+    }
+    if (graphicsPipelineLibraryFeatures.graphicsPipelineLibrary)
+    {
+        AppendExtension(extensions, availableExtensions, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        injected.graphicsPipelineLibrary = AppendExtension(extensions, availableExtensions, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        graphicsPipelineLibraryFeatures.pNext = const_cast<void*>(patchedCreateInfo.pNext);
+        if (!EnableGraphicsPipelineLibraryFeatureInChain(patchedCreateInfo.pNext, &patchedFlags))
+            patchedCreateInfo.pNext = &graphicsPipelineLibraryFeatures;
+    }
+#endif
+
+    patchedCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    patchedCreateInfo.ppEnabledExtensionNames = extensions.data();
+
+    VkResult result = createDevice(physicalDevice, &patchedCreateInfo, pAllocator, pDevice);
+    RestoreFeatureFlags(&patchedFlags);
+    if (result != VK_SUCCESS)
+    {
+        // Same as for the instance: the plugin's extras are optional, Unity's device is not
+        injected = VulkanInjectedExtensions();
+        result = createDevice(physicalDevice, pCreateInfo, pAllocator, pDevice);
+    }
+
+    if (result == VK_SUCCESS)
+        s_InjectedExtensions = injected;
+
+    s_NestedCommandBuffersEnabled = result == VK_SUCCESS && injected.nestedCommandBuffer;
+
+    s_MinImportedHostPointerAlignment = 0;
+    if (result == VK_SUCCESS && injected.externalMemoryHost)
+    {
+        PFN_vkGetPhysicalDeviceProperties2 getPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceProperties2");
+        if (!getPhysicalDeviceProperties2)
+            getPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceProperties2KHR");
+        if (getPhysicalDeviceProperties2)
         {
-            // Type is available, does it match user properties?
-            if ((physicalDeviceMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
-                return memoryTypeIndex;
+            VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties = {};
+            hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+            VkPhysicalDeviceProperties2 properties = {};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &hostProperties;
+            getPhysicalDeviceProperties2(physicalDevice, &properties);
+            s_MinImportedHostPointerAlignment = hostProperties.minImportedHostPointerAlignment;
         }
-        memoryTypeBits >>= 1;
     }
 
-    return -1;
+#ifdef VK_EXT_graphics_pipeline_library
+    // Without fast linking, linking at first use could take as long as a full compile; such
+    // drivers get the monolithic path
+    s_GraphicsPipelineLibraryEnabled = false;
+    if (result == VK_SUCCESS && injected.graphicsPipelineLibrary)
+    {
+        PFN_vkGetPhysicalDeviceProperties2 getPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceProperties2");
+        if (!getPhysicalDeviceProperties2)
+            getPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceProperties2KHR");
+        if (getPhysicalDeviceProperties2)
+        {
+            VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties = {};
+            libraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+            VkPhysicalDeviceProperties2 properties = {};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &libraryProperties;
+            getPhysicalDeviceProperties2(physicalDevice, &properties);
+            s_GraphicsPipelineLibraryEnabled = libraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
+        }
+    }
+#endif
+
+#ifdef VK_EXT_host_image_copy
+    s_HostImageCopyEnabled = false;
+    if (result == VK_SUCCESS && injected.hostImageCopy)
+    {
+        s_GetPhysicalDeviceImageFormatProperties2 = (PFN_vkGetPhysicalDeviceImageFormatProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceImageFormatProperties2");
+        if (!s_GetPhysicalDeviceImageFormatProperties2)
+            s_GetPhysicalDeviceImageFormatProperties2 = (PFN_vkGetPhysicalDeviceImageFormatProperties2)vkGetInstanceProcAddr(s_HookedInstance, "vkGetPhysicalDeviceImageFormatProperties2KHR");
+        s_HostImageCopyPhysicalDevice = physicalDevice;
+        QueryHostImageCopyDstLayouts(physicalDevice);
+        s_HostImageCopyEnabled = !s_HostImageCopyDstLayouts.empty();
+    }
+#endif
+
+    return result;
+}
+
+const VulkanInjectedExtensions& RenderAPI_Vulkan_GetInjectedExtensions()
+{
+    return s_InjectedExtensions;
 }
 
 static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL Hook_vkGetInstanceProcAddr(VkInstance device, const char* funcName)
@@ -119,9 +623,11 @@ static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL Hook_vkGetInstanceProcAddr(VkIns
 
 #define INTERCEPT(fn) if (strcmp(funcName, #fn) == 0) return (PFN_vkVoidFunction)&Hook_##fn
     INTERCEPT(vkCreateInstance);
+    INTERCEPT(vkCreateDevice);
 #undef INTERCEPT
 
-    return NULL;
+    // Everything else goes straight to the loader; Unity resolves its whole API through this function
+    return vkGetInstanceProcAddr(device, funcName);
 }
 
 static PFN_vkGetInstanceProcAddr UNITY_INTERFACE_API InterceptVulkanInitialization(PFN_vkGetInstanceProcAddr getInstanceProcAddr, void*)
@@ -138,352 +644,29 @@ extern "C" void RenderAPI_Vulkan_OnPluginLoad(IUnityInterfaces* interfaces)
         vulkanInterface->InterceptInitialization(InterceptVulkanInitialization, NULL);
 }
 
-struct VulkanBuffer
-{
-    VkBuffer buffer;
-    VkDeviceMemory deviceMemory;
-    void* mapped;
-    VkDeviceSize sizeInBytes;
-    VkDeviceSize deviceMemorySize;
-    VkMemoryPropertyFlags deviceMemoryFlags;
-};
-
-static VkPipelineLayout CreateTrianglePipelineLayout(VkDevice device)
-{
-    VkPushConstantRange pushConstantRange;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = 64; // single matrix
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
-    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-
-    VkPipelineLayout pipelineLayout;
-    return vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, &pipelineLayout) == VK_SUCCESS ? pipelineLayout : VK_NULL_HANDLE;
-}
-
-namespace Shader {
-// Source of vertex shader (filename: shader.vert)
-/*
-#version 310 es
-layout(location = 0) in highp vec3 vpos;
-layout(location = 1) in highp vec4 vcol;
-layout(location = 0) out highp vec4 color;
-layout(push_constant) uniform PushConstants { mat4 matrix; };
-void main() {
-    gl_Position = matrix * vec4(vpos, 1.0);
-    color = vcol;
-}
-*/
-
-// Source of fragment shader (filename: shader.frag)
-/*
-#version 310 es
-layout(location = 0) out highp vec4 fragColor;
-layout(location = 0) in highp vec4 color;
-void main() { fragColor = color; }
-*/
-// compiled to SPIR-V using:
-// %VULKAN_SDK%\bin\glslc -mfmt=num shader.frag shader.vert -c
-
-const uint32_t vertexShaderSpirv[] = {
-	0x07230203,0x00010000,0x000d0007,0x00000024,
-	0x00000000,0x00020011,0x00000001,0x0006000b,
-	0x00000001,0x4c534c47,0x6474732e,0x3035342e,
-	0x00000000,0x0003000e,0x00000000,0x00000001,
-	0x0009000f,0x00000000,0x00000004,0x6e69616d,
-	0x00000000,0x0000000a,0x00000016,0x00000020,
-	0x00000022,0x00030003,0x00000001,0x00000136,
-	0x000a0004,0x475f4c47,0x4c474f4f,0x70635f45,
-	0x74735f70,0x5f656c79,0x656e696c,0x7269645f,
-	0x69746365,0x00006576,0x00080004,0x475f4c47,
-	0x4c474f4f,0x6e695f45,0x64756c63,0x69645f65,
-	0x74636572,0x00657669,0x00040005,0x00000004,
-	0x6e69616d,0x00000000,0x00060005,0x00000008,
-	0x505f6c67,0x65567265,0x78657472,0x00000000,
-	0x00060006,0x00000008,0x00000000,0x505f6c67,
-	0x7469736f,0x006e6f69,0x00070006,0x00000008,
-	0x00000001,0x505f6c67,0x746e696f,0x657a6953,
-	0x00000000,0x00030005,0x0000000a,0x00000000,
-	0x00060005,0x0000000e,0x68737550,0x736e6f43,
-	0x746e6174,0x00000073,0x00050006,0x0000000e,
-	0x00000000,0x7274616d,0x00007869,0x00030005,
-	0x00000010,0x00000000,0x00040005,0x00000016,
-	0x736f7076,0x00000000,0x00040005,0x00000020,
-	0x6f6c6f63,0x00000072,0x00040005,0x00000022,
-	0x6c6f6376,0x00000000,0x00050048,0x00000008,
-	0x00000000,0x0000000b,0x00000000,0x00050048,
-	0x00000008,0x00000001,0x0000000b,0x00000001,
-	0x00030047,0x00000008,0x00000002,0x00040048,
-	0x0000000e,0x00000000,0x00000005,0x00050048,
-	0x0000000e,0x00000000,0x00000023,0x00000000,
-	0x00050048,0x0000000e,0x00000000,0x00000007,
-	0x00000010,0x00030047,0x0000000e,0x00000002,
-	0x00040047,0x00000016,0x0000001e,0x00000000,
-	0x00040047,0x00000020,0x0000001e,0x00000000,
-	0x00040047,0x00000022,0x0000001e,0x00000001,
-	0x00020013,0x00000002,0x00030021,0x00000003,
-	0x00000002,0x00030016,0x00000006,0x00000020,
-	0x00040017,0x00000007,0x00000006,0x00000004,
-	0x0004001e,0x00000008,0x00000007,0x00000006,
-	0x00040020,0x00000009,0x00000003,0x00000008,
-	0x0004003b,0x00000009,0x0000000a,0x00000003,
-	0x00040015,0x0000000b,0x00000020,0x00000001,
-	0x0004002b,0x0000000b,0x0000000c,0x00000000,
-	0x00040018,0x0000000d,0x00000007,0x00000004,
-	0x0003001e,0x0000000e,0x0000000d,0x00040020,
-	0x0000000f,0x00000009,0x0000000e,0x0004003b,
-	0x0000000f,0x00000010,0x00000009,0x00040020,
-	0x00000011,0x00000009,0x0000000d,0x00040017,
-	0x00000014,0x00000006,0x00000003,0x00040020,
-	0x00000015,0x00000001,0x00000014,0x0004003b,
-	0x00000015,0x00000016,0x00000001,0x0004002b,
-	0x00000006,0x00000018,0x3f800000,0x00040020,
-	0x0000001e,0x00000003,0x00000007,0x0004003b,
-	0x0000001e,0x00000020,0x00000003,0x00040020,
-	0x00000021,0x00000001,0x00000007,0x0004003b,
-	0x00000021,0x00000022,0x00000001,0x00050036,
-	0x00000002,0x00000004,0x00000000,0x00000003,
-	0x000200f8,0x00000005,0x00050041,0x00000011,
-	0x00000012,0x00000010,0x0000000c,0x0004003d,
-	0x0000000d,0x00000013,0x00000012,0x0004003d,
-	0x00000014,0x00000017,0x00000016,0x00050051,
-	0x00000006,0x00000019,0x00000017,0x00000000,
-	0x00050051,0x00000006,0x0000001a,0x00000017,
-	0x00000001,0x00050051,0x00000006,0x0000001b,
-	0x00000017,0x00000002,0x00070050,0x00000007,
-	0x0000001c,0x00000019,0x0000001a,0x0000001b,
-	0x00000018,0x00050091,0x00000007,0x0000001d,
-	0x00000013,0x0000001c,0x00050041,0x0000001e,
-	0x0000001f,0x0000000a,0x0000000c,0x0003003e,
-	0x0000001f,0x0000001d,0x0004003d,0x00000007,
-	0x00000023,0x00000022,0x0003003e,0x00000020,
-	0x00000023,0x000100fd,0x00010038
-};
-const uint32_t fragmentShaderSpirv[] = {
-    0x07230203,0x00010000,0x000d0006,0x0000000d,
-    0x00000000,0x00020011,0x00000001,0x0006000b,
-    0x00000001,0x4c534c47,0x6474732e,0x3035342e,
-    0x00000000,0x0003000e,0x00000000,0x00000001,
-    0x0007000f,0x00000004,0x00000004,0x6e69616d,
-    0x00000000,0x00000009,0x0000000b,0x00030010,
-    0x00000004,0x00000007,0x00030003,0x00000001,
-    0x00000136,0x000a0004,0x475f4c47,0x4c474f4f,
-    0x70635f45,0x74735f70,0x5f656c79,0x656e696c,
-    0x7269645f,0x69746365,0x00006576,0x00080004,
-    0x475f4c47,0x4c474f4f,0x6e695f45,0x64756c63,
-    0x69645f65,0x74636572,0x00657669,0x00040005,
-    0x00000004,0x6e69616d,0x00000000,0x00050005,
-    0x00000009,0x67617266,0x6f6c6f43,0x00000072,
-    0x00040005,0x0000000b,0x6f6c6f63,0x00000072,
-    0x00040047,0x00000009,0x0000001e,0x00000000,
-    0x00040047,0x0000000b,0x0000001e,0x00000000,
-    0x00020013,0x00000002,0x00030021,0x00000003,
-    0x00000002,0x00030016,0x00000006,0x00000020,
-    0x00040017,0x00000007,0x00000006,0x00000004,
-    0x00040020,0x00000008,0x00000003,0x00000007,
-    0x0004003b,0x00000008,0x00000009,0x00000003,
-    0x00040020,0x0000000a,0x00000001,0x00000007,
-    0x0004003b,0x0000000a,0x0000000b,0x00000001,
-    0x00050036,0x00000002,0x00000004,0x00000000,
-    0x00000003,0x000200f8,0x00000005,0x0004003d,
-    0x00000007,0x0000000c,0x0000000b,0x0003003e,
-    0x00000009,0x0000000c,0x000100fd,0x00010038
-};
-} // namespace Shader
-
-static VkPipeline CreateTrianglePipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkPipelineCache pipelineCache)
-{
-    if (pipelineLayout == VK_NULL_HANDLE)
-        return VK_NULL_HANDLE;  
-    if (device == VK_NULL_HANDLE)
-        return VK_NULL_HANDLE;
-    if (renderPass == VK_NULL_HANDLE)
-        return VK_NULL_HANDLE;
-
-    bool success = true;
-    VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
-     
-    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
-    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderStages[0].pName = "main";
-    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].pName = "main";
-    
-    if (success)
-    {
-        VkShaderModuleCreateInfo moduleCreateInfo = {};
-        moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        moduleCreateInfo.codeSize = sizeof(Shader::vertexShaderSpirv);
-        moduleCreateInfo.pCode = Shader::vertexShaderSpirv;
-        success = vkCreateShaderModule(device, &moduleCreateInfo, NULL, &shaderStages[0].module) == VK_SUCCESS;
-    }
-
-    if (success)
-    {
-        VkShaderModuleCreateInfo moduleCreateInfo = {};
-        moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        moduleCreateInfo.codeSize = sizeof(Shader::fragmentShaderSpirv);
-        moduleCreateInfo.pCode = Shader::fragmentShaderSpirv;
-        success = vkCreateShaderModule(device, &moduleCreateInfo, NULL, &shaderStages[1].module) == VK_SUCCESS;
-    }
-
-    VkPipeline pipeline;
-    if (success)
-    {
-        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineCreateInfo.layout = pipelineLayout;
-        pipelineCreateInfo.renderPass = renderPass;
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {};
-        inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-
-        VkPipelineRasterizationStateCreateInfo rasterizationState = {};
-        rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizationState.cullMode = VK_CULL_MODE_NONE;
-        rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        rasterizationState.depthClampEnable = VK_FALSE;
-        rasterizationState.rasterizerDiscardEnable = VK_FALSE;
-        rasterizationState.depthBiasEnable = VK_FALSE;
-        rasterizationState.lineWidth = 1.0f;
-
-        VkPipelineColorBlendAttachmentState blendAttachmentState[1] = {};
-        blendAttachmentState[0].colorWriteMask = 0xf;
-        blendAttachmentState[0].blendEnable = VK_FALSE;
-        VkPipelineColorBlendStateCreateInfo colorBlendState = {};
-        colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlendState.attachmentCount = 1;
-        colorBlendState.pAttachments = blendAttachmentState;
-
-        VkPipelineViewportStateCreateInfo viewportState = {};
-        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.scissorCount = 1;
-
-        const VkDynamicState dynamicStateEnables[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-        VkPipelineDynamicStateCreateInfo dynamicState = {};
-        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicState.pDynamicStates = dynamicStateEnables;
-        dynamicState.dynamicStateCount = sizeof(dynamicStateEnables) / sizeof(*dynamicStateEnables);
-
-        VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
-        depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencilState.depthTestEnable = VK_TRUE;
-        depthStencilState.depthWriteEnable = VK_TRUE;
-        depthStencilState.depthBoundsTestEnable = VK_FALSE;
-        depthStencilState.stencilTestEnable = VK_FALSE;
-        depthStencilState.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; // Unity/Vulkan uses reverse Z
-        depthStencilState.back.failOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.back.passOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.back.compareOp = VK_COMPARE_OP_ALWAYS;
-        depthStencilState.front = depthStencilState.back;
-
-        VkPipelineMultisampleStateCreateInfo multisampleState = {};
-        multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        multisampleState.pSampleMask = NULL;
-
-        // Vertex:
-        // float3 vpos;
-        // byte4 vcol;
-        VkVertexInputBindingDescription vertexInputBinding = {};
-        vertexInputBinding.binding = 0;
-        vertexInputBinding.stride = 16; 
-        vertexInputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        VkVertexInputAttributeDescription vertexInputAttributes[2];
-        vertexInputAttributes[0].binding = 0;
-        vertexInputAttributes[0].location = 0;
-        vertexInputAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        vertexInputAttributes[0].offset = 0;
-        vertexInputAttributes[1].binding = 0;
-        vertexInputAttributes[1].location = 1;
-        vertexInputAttributes[1].format = VK_FORMAT_R8G8B8A8_UNORM;
-        vertexInputAttributes[1].offset = 12;
-
-        VkPipelineVertexInputStateCreateInfo vertexInputState = {};
-        vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputState.vertexBindingDescriptionCount = 1;
-        vertexInputState.pVertexBindingDescriptions = &vertexInputBinding;
-        vertexInputState.vertexAttributeDescriptionCount = 2;
-        vertexInputState.pVertexAttributeDescriptions = vertexInputAttributes;
-
-        pipelineCreateInfo.stageCount = sizeof(shaderStages) / sizeof(*shaderStages);
-        pipelineCreateInfo.pStages = shaderStages;
-        pipelineCreateInfo.pVertexInputState = &vertexInputState;
-        pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
-        pipelineCreateInfo.pRasterizationState = &rasterizationState;
-        pipelineCreateInfo.pColorBlendState = &colorBlendState;
-        pipelineCreateInfo.pMultisampleState = &multisampleState;
-        pipelineCreateInfo.pViewportState = &viewportState;
-        pipelineCreateInfo.pDepthStencilState = &depthStencilState;
-        pipelineCreateInfo.pDynamicState = &dynamicState;
-
-        success = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, NULL, &pipeline) == VK_SUCCESS;
-    } 
-
-    if (shaderStages[0].module != VK_NULL_HANDLE)
-        vkDestroyShaderModule(device, shaderStages[0].module, NULL);
-    if (shaderStages[1].module != VK_NULL_HANDLE)
-        vkDestroyShaderModule(device, shaderStages[1].module, NULL);
-
-    return success ? pipeline : VK_NULL_HANDLE;
-}
-
-class RenderAPI_Vulkan : public RenderAPI
-{
-public:
-    RenderAPI_Vulkan();
-    virtual ~RenderAPI_Vulkan() { }
-
-    virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
-    virtual bool GetUsesReverseZ() { return true; }
-    virtual void DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
-    virtual void* BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch);
-    virtual void EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr);
-    virtual void* BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize);
-    virtual void EndModifyVertexBuffer(void* bufferHandle);
-
-private:
-    typedef std::vector<VulkanBuffer> VulkanBuffers;
-    typedef std::map<unsigned long long, VulkanBuffers> DeleteQueue;
-
-private:
-    bool CreateVulkanBuffer(size_t bytes, VulkanBuffer* buffer, VkBufferUsageFlags usage);
-    void ImmediateDestroyVulkanBuffer(const VulkanBuffer& buffer);
-    void SafeDestroy(unsigned long long frameNumber, const VulkanBuffer& buffer);
-    void GarbageCollect(bool force = false);
-
-private:
-    IUnityGraphicsVulkan* m_UnityVulkan;
-    UnityVulkanInstance m_Instance;
-    VulkanBuffer m_TextureStagingBuffer;
-    VulkanBuffer m_VertexStagingBuffer;
-    std::map<unsigned long long, VulkanBuffers> m_DeleteQueue;
-    VkPipelineLayout m_TrianglePipelineLayout;
-    VkPipeline m_TrianglePipeline;
-    VkRenderPass m_TrianglePipelineRenderPass;
-};
-
-
 RenderAPI* CreateRenderAPI_Vulkan()
 {
     return new RenderAPI_Vulkan();
 }
 
 RenderAPI_Vulkan::RenderAPI_Vulkan()
-    : m_UnityVulkan(NULL)
+    : RenderAPI(kUnityGfxRendererVulkan)
+    , m_UnityVulkan(NULL)
 	, m_Instance()
+    , m_Vk(NULL)
     , m_TextureStagingBuffer()
     , m_VertexStagingBuffer()
+    , m_TrianglePipelines()
     , m_TrianglePipelineLayout(VK_NULL_HANDLE)
     , m_TrianglePipeline(VK_NULL_HANDLE)
-    , m_TrianglePipelineRenderPass(VK_NULL_HANDLE)
+    , m_NonCoherentAtomSize(1)
+    , m_MemoryProperties()
+    , m_MemoryBudget()
+    , m_HostImageCopy(false)
+    , m_GenerateMips(false)
+    , m_WorkerPool(NULL)
+    , m_ReadbackRing()
+    , m_ReadbackHead(0)
 {
 }
 
@@ -495,8 +678,28 @@ void RenderAPI_Vulkan::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityIn
         m_UnityVulkan = interfaces->Get<IUnityGraphicsVulkan>();
         m_Instance = m_UnityVulkan->Instance();
 
-        // Make sure Vulkan API functions are loaded
-        LoadVulkanAPI(m_Instance.getInstanceProcAddr, m_Instance.instance);
+        // Device-level entry points straight from the driver, shared with anything else on this device
+        m_Vk = AcquireVulkanDispatch(m_Instance.getInstanceProcAddr, m_Instance.instance, m_Instance.device);
+        if (!m_Vk)
+        {
+            std::cout << "RenderAPI_Vulkan: could not load the Vulkan device functions" << std::endl;
+            m_UnityVulkan = NULL;
+            m_Instance = UnityVulkanInstance();
+            break;
+        }
+
+        VkPhysicalDeviceProperties physicalDeviceProperties;
+        m_Vk->vkGetPhysicalDeviceProperties(m_Instance.physicalDevice, &physicalDeviceProperties);
+        m_NonCoherentAtomSize = physicalDeviceProperties.limits.nonCoherentAtomSize > 0 ? physicalDeviceProperties.limits.nonCoherentAtomSize : 1;
+        m_Vk->vkGetPhysicalDeviceMemoryProperties(m_Instance.physicalDevice, &m_MemoryProperties);
+        QueryVulkanMemoryBudget(*m_Vk, m_Instance.physicalDevice, s_InjectedExtensions.memoryBudget, &m_MemoryBudget);
+        m_SecondaryPools.Initialize(m_Vk, m_Instance.queueFamilyIndex);
+        if (!m_TrianglePipelines.Initialize(m_Vk, s_GraphicsPipelineLibraryEnabled))
+            std::cout << "RenderAPI_Vulkan: could not create the triangle pipeline layout or shaders" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(s_TrianglePipelinesMutex);
+            s_TrianglePipelines = &m_TrianglePipelines;
+        }
 
         UnityVulkanPluginEventConfig config_1;
         config_1.graphicsQueueAccess = kUnityVulkanGraphicsQueueAccess_DontCare;
@@ -504,28 +707,67 @@ void RenderAPI_Vulkan::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityIn
         config_1.flags = kUnityVulkanEventConfigFlag_EnsurePreviousFrameSubmission | kUnityVulkanEventConfigFlag_ModifiesCommandBuffersState;
         m_UnityVulkan->ConfigureEvent(1, &config_1);
 
-        // alternative way to intercept API
-        m_UnityVulkan->InterceptVulkanAPI("vkCmdBeginRenderPass", (PFN_vkVoidFunction)Hook_vkCmdBeginRenderPass);
+        // alternative way to intercept API. Once per process: a second Initialize would get
+        // a wrapper of ours back as "previous" and the hooks would call each other.
+        if (!s_UnityCmdBeginRenderPass)
+        {
+            s_UnityCmdBeginRenderPass = m_Vk->vkCmdBeginRenderPass;
+            if (PFN_vkVoidFunction previous = m_UnityVulkan->InterceptVulkanAPI("vkCmdBeginRenderPass", (PFN_vkVoidFunction)Hook_vkCmdBeginRenderPass))
+                s_UnityCmdBeginRenderPass = (PFN_vkCmdBeginRenderPass)previous;
+            s_UnityCmdNextSubpass = (PFN_vkCmdNextSubpass)m_Instance.getInstanceProcAddr(m_Instance.instance, "vkCmdNextSubpass");
+            if (PFN_vkVoidFunction previous = m_UnityVulkan->InterceptVulkanAPI("vkCmdNextSubpass", (PFN_vkVoidFunction)Hook_vkCmdNextSubpass))
+                s_UnityCmdNextSubpass = (PFN_vkCmdNextSubpass)previous;
+            s_UnityDestroyRenderPass = (PFN_vkDestroyRenderPass)m_Instance.getInstanceProcAddr(m_Instance.instance, "vkDestroyRenderPass");
+            if (PFN_vkVoidFunction previous = m_UnityVulkan->InterceptVulkanAPI("vkDestroyRenderPass", (PFN_vkVoidFunction)Hook_vkDestroyRenderPass))
+                s_UnityDestroyRenderPass = (PFN_vkDestroyRenderPass)previous;
+        }
+
+#ifdef VK_EXT_host_image_copy
+        // Textures Unity creates from now on get VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT where that is free
+        if (s_HostImageCopyEnabled && m_Vk->vkCopyMemoryToImageEXT && !s_UnityCreateImage)
+        {
+            s_UnityCreateImage = (PFN_vkCreateImage)m_Instance.getInstanceProcAddr(m_Instance.instance, "vkCreateImage");
+            if (PFN_vkVoidFunction previous = m_UnityVulkan->InterceptVulkanAPI("vkCreateImage", (PFN_vkVoidFunction)Hook_vkCreateImage))
+                s_UnityCreateImage = (PFN_vkCreateImage)previous;
+        }
+        m_HostImageCopy = s_HostImageCopyEnabled && m_Vk->vkCopyMemoryToImageEXT && m_Vk->vkTransitionImageLayoutEXT && s_UnityCreateImage;
+#endif
+
+        // Last, so its wrappers sit in front of the plugin's own
+        if (IsVulkanProfilerRequested())
+            InstallVulkanProfiler(m_UnityVulkan, *m_Vk);
         break;
     case kUnityGfxDeviceEventShutdown:
 
-        if (m_Instance.device != VK_NULL_HANDLE)
+        if (m_Vk)
         {
+            for (std::map<uintptr_t, HostMemoryImport>::iterator it = m_HostMemoryImports.begin(); it != m_HostMemoryImports.end(); ++it)
+                SafeDestroy(0, it->second.buffer);
+            m_HostMemoryImports.clear();
+            if (m_ReadbackRing.buffer != VK_NULL_HANDLE)
+                SafeDestroy(0, m_ReadbackRing);
+            for (size_t i = 0; i < m_RetiredReadbackRings.size(); ++i)
+                SafeDestroy(0, m_RetiredReadbackRings[i]);
+            m_ReadbackRing = VulkanBuffer();
+            m_ReadbackHead = 0;
+            m_PendingReadbacks.clear();
+            m_RetiredReadbackRings.clear();
             GarbageCollect(true);
-            if (m_TrianglePipeline != VK_NULL_HANDLE)
-            {
-                vkDestroyPipeline(m_Instance.device, m_TrianglePipeline, NULL);
-                m_TrianglePipeline = VK_NULL_HANDLE;
-            }
-            if (m_TrianglePipelineLayout != VK_NULL_HANDLE)
+            m_SecondaryPools.Shutdown();
             {
-                vkDestroyPipelineLayout(m_Instance.device, m_TrianglePipelineLayout, NULL);
-                m_TrianglePipelineLayout = VK_NULL_HANDLE;
+                std::lock_guard<std::mutex> lock(s_TrianglePipelinesMutex);
+                s_TrianglePipelines = NULL;
             }
+            m_TrianglePipelines.Shutdown();
         }
 
+        ReleaseVulkanDispatch(m_Vk);
+        m_Vk = NULL;
         m_UnityVulkan = NULL;
-        m_TrianglePipelineRenderPass = VK_NULL_HANDLE;
+        m_TrianglePipelineLayout = VK_NULL_HANDLE;
+        m_TrianglePipeline = VK_NULL_HANDLE;
+        m_WrittenRanges.clear();
+        m_HostImageCopy = false;
         m_Instance = UnityVulkanInstance();
 
         break;
@@ -533,7 +775,34 @@ void RenderAPI_Vulkan::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityIn
 }
 
 
-bool RenderAPI_Vulkan::CreateVulkanBuffer(size_t sizeInBytes, VulkanBuffer* buffer, VkBufferUsageFlags usage)
+// Allocates from the best memory type for memoryUsage (see VulkanMemoryPolicy.h). A type that
+// fails to allocate (e.g. a full BAR heap) is dropped and the next best one tried.
+bool RenderAPI_Vulkan::AllocateVulkanMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags requiredFlags, VulkanMemoryUsage memoryUsage,
+    const void* pNext, VkDeviceMemory* outMemory, int* outMemoryTypeIndex)
+{
+    uint32_t memoryTypeBits = requirements.memoryTypeBits;
+    int memoryTypeIndex;
+    while ((memoryTypeIndex = SelectVulkanMemoryType(m_MemoryProperties, &m_MemoryBudget, memoryTypeBits, requiredFlags, memoryUsage, requirements.size)) >= 0)
+    {
+        VkMemoryAllocateInfo memoryAllocateInfo;
+        memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memoryAllocateInfo.pNext = pNext;
+        memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+        memoryAllocateInfo.allocationSize = requirements.size;
+        if (m_Vk->vkAllocateMemory(m_Instance.device, &memoryAllocateInfo, NULL, outMemory) == VK_SUCCESS)
+        {
+            // Keep the budget honest until the next refresh
+            if (m_MemoryBudget.valid)
+                m_MemoryBudget.usage[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex] += requirements.size;
+            *outMemoryTypeIndex = memoryTypeIndex;
+            return true;
+        }
+        memoryTypeBits &= ~(1u << memoryTypeIndex);
+    }
+    return false;
+}
+
+bool RenderAPI_Vulkan::CreateVulkanBuffer(size_t sizeInBytes, VulkanBuffer* buffer, VkBufferUsageFlags usage, VulkanMemoryUsage memoryUsage)
 {
     if (sizeInBytes == 0)
         return false;
@@ -550,49 +819,34 @@ bool RenderAPI_Vulkan::CreateVulkanBuffer(size_t sizeInBytes, VulkanBuffer* buff
 
     *buffer = VulkanBuffer();
 
-    if (vkCreateBuffer(m_Instance.device, &bufferCreateInfo, NULL, &buffer->buffer) != VK_SUCCESS)
+    if (m_Vk->vkCreateBuffer(m_Instance.device, &bufferCreateInfo, NULL, &buffer->buffer) != VK_SUCCESS)
         return false;
 
-    VkPhysicalDeviceMemoryProperties physicalDeviceProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_Instance.physicalDevice, &physicalDeviceProperties);
-
     VkMemoryRequirements memoryRequirements;
-    vkGetBufferMemoryRequirements(m_Instance.device, buffer->buffer, &memoryRequirements);
-
-    const int memoryTypeIndex = FindMemoryTypeIndex(physicalDeviceProperties, memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    if (memoryTypeIndex < 0)
-    {
-        ImmediateDestroyVulkanBuffer(*buffer);
-        return false;
-    }
+    m_Vk->vkGetBufferMemoryRequirements(m_Instance.device, buffer->buffer, &memoryRequirements);
 
-    VkMemoryAllocateInfo memoryAllocateInfo;
-    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAllocateInfo.pNext = NULL;
-    memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
-    memoryAllocateInfo.allocationSize = memoryRequirements.size;
-
-    if (vkAllocateMemory(m_Instance.device, &memoryAllocateInfo, NULL, &buffer->deviceMemory) != VK_SUCCESS)
+    int memoryTypeIndex;
+    if (!AllocateVulkanMemory(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, memoryUsage, NULL, &buffer->deviceMemory, &memoryTypeIndex))
     {
         ImmediateDestroyVulkanBuffer(*buffer);
         return false;
     }
 
-    if (vkMapMemory(m_Instance.device, buffer->deviceMemory, 0, VK_WHOLE_SIZE, 0, &buffer->mapped) != VK_SUCCESS)
+    if (m_Vk->vkMapMemory(m_Instance.device, buffer->deviceMemory, 0, VK_WHOLE_SIZE, 0, &buffer->mapped) != VK_SUCCESS)
     {
         ImmediateDestroyVulkanBuffer(*buffer);
         return false;
     }
 
-    if (vkBindBufferMemory(m_Instance.device, buffer->buffer, buffer->deviceMemory, 0) != VK_SUCCESS)
+    if (m_Vk->vkBindBufferMemory(m_Instance.device, buffer->buffer, buffer->deviceMemory, 0) != VK_SUCCESS)
     {
         ImmediateDestroyVulkanBuffer(*buffer);
         return false;
     }
 
     buffer->sizeInBytes = sizeInBytes;
-    buffer->deviceMemoryFlags = physicalDeviceProperties.memoryTypes[memoryTypeIndex].propertyFlags;
-    buffer->deviceMemorySize = memoryAllocateInfo.allocationSize;
+    buffer->deviceMemoryFlags = m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    buffer->deviceMemorySize = memoryRequirements.size;
 
     return true;
 }
@@ -600,13 +854,13 @@ bool RenderAPI_Vulkan::CreateVulkanBuffer(size_t sizeInBytes, VulkanBuffer* buff
 void RenderAPI_Vulkan::ImmediateDestroyVulkanBuffer(const VulkanBuffer& buffer)
 {
     if (buffer.buffer != VK_NULL_HANDLE)
-        vkDestroyBuffer(m_Instance.device, buffer.buffer, NULL);
+        m_Vk->vkDestroyBuffer(m_Instance.device, buffer.buffer, NULL);
 
     if (buffer.mapped && buffer.deviceMemory != VK_NULL_HANDLE)
-        vkUnmapMemory(m_Instance.device, buffer.deviceMemory);
+        m_Vk->vkUnmapMemory(m_Instance.device, buffer.deviceMemory);
 
     if (buffer.deviceMemory != VK_NULL_HANDLE)
-        vkFreeMemory(m_Instance.device, buffer.deviceMemory, NULL);
+        m_Vk->vkFreeMemory(m_Instance.device, buffer.deviceMemory, NULL);
 }
 
 
@@ -624,6 +878,10 @@ void RenderAPI_Vulkan::GarbageCollect(bool force /*= false*/)
         if (!m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
             return;
 
+    // Once per plugin event is plenty; AllocateVulkanMemory accounts for our own allocations in between
+    if (!force)
+        QueryVulkanMemoryBudget(*m_Vk, m_Instance.physicalDevice, s_InjectedExtensions.memoryBudget, &m_MemoryBudget);
+
     DeleteQueue::iterator it = m_DeleteQueue.begin();
     while (it != m_DeleteQueue.end())
     {
@@ -638,6 +896,82 @@ void RenderAPI_Vulkan::GarbageCollect(bool force /*= false*/)
     }
 }
 
+// Picks the triangle pipeline for the render pass being recorded. The first time a render
+// pass shows up its pipeline is only queued for compiling, and draws in it are skipped
+// until it is ready (see VulkanTrianglePipelines).
+bool RenderAPI_Vulkan::EnsureTrianglePipeline(const UnityVulkanRecordingState& recordingState)
+{
+    m_TrianglePipelineLayout = m_TrianglePipelines.GetLayout();
+    m_TrianglePipeline = m_TrianglePipelines.Get(recordingState.renderPass, recordingState.currentFrameNumber, recordingState.safeFrameNumber);
+    return m_TrianglePipeline != VK_NULL_HANDLE && m_TrianglePipelineLayout != VK_NULL_HANDLE;
+}
+
+void RenderAPI_Vulkan::SetWorkerPool(WorkerPool* pool)
+{
+    m_WorkerPool = pool;
+    m_TrianglePipelines.SetWorkerPool(pool);
+}
+
+// Records that the CPU wrote [offset, offset + size) of a mapped plugin buffer. Nothing is
+// flushed until FlushWrittenRanges, and only for non-coherent memory.
+void RenderAPI_Vulkan::MarkWritten(const VulkanBuffer& buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    MarkWrittenMemory(buffer.deviceMemory, buffer.deviceMemoryFlags, offset, offset + size, buffer.deviceMemorySize);
+}
+
+// Same for one of Unity's buffers; offset is relative to the buffer, not its memory
+void RenderAPI_Vulkan::MarkWritten(const UnityVulkanBuffer& buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    const VkDeviceSize begin = buffer.memory.offset + offset;
+    MarkWrittenMemory(buffer.memory.memory, buffer.memory.flags, begin, begin + size, buffer.memory.offset + buffer.memory.size);
+}
+
+// begin/end are offsets into memory. Flush ranges have to start and end on nonCoherentAtomSize,
+// unless they run to the end of the allocation: the range is widened to atoms, and when that
+// would cross ownedEnd (where the memory we know we own ends, e.g. the end of Unity's
+// suballocation) it runs to VK_WHOLE_SIZE instead, which is always valid.
+void RenderAPI_Vulkan::MarkWrittenMemory(VkDeviceMemory memory, VkMemoryPropertyFlags flags, VkDeviceSize begin, VkDeviceSize end, VkDeviceSize ownedEnd)
+{
+    if ((flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) || memory == VK_NULL_HANDLE || end <= begin)
+        return;
+
+    const VkDeviceSize atom = m_NonCoherentAtomSize;
+    begin = begin / atom * atom;
+    end = (end + atom - 1) / atom * atom;
+
+    // Writes usually come in order (packed staging, consecutive uploads): extend the last range
+    if (!m_WrittenRanges.empty())
+    {
+        VkMappedMemoryRange& last = m_WrittenRanges.back();
+        if (last.memory == memory && last.size != VK_WHOLE_SIZE && begin >= last.offset && begin <= last.offset + last.size)
+        {
+            if (end > ownedEnd)
+                last.size = VK_WHOLE_SIZE;
+            else if (end > last.offset + last.size)
+                last.size = end - last.offset;
+            return;
+        }
+    }
+
+    VkMappedMemoryRange range;
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.pNext = NULL;
+    range.memory = memory;
+    range.offset = begin;
+    range.size = end > ownedEnd ? VK_WHOLE_SIZE : end - begin;
+    m_WrittenRanges.push_back(range);
+}
+
+// One vkFlushMappedMemoryRanges for everything marked since the last call. Has to run before
+// Unity submits the command buffer that reads the memory, i.e. before the plugin event returns.
+void RenderAPI_Vulkan::FlushWrittenRanges()
+{
+    if (m_WrittenRanges.empty())
+        return;
+    m_Vk->vkFlushMappedMemoryRanges(m_Instance.device, (uint32_t)m_WrittenRanges.size(), m_WrittenRanges.data());
+    m_WrittenRanges.clear();
+}
+
 void RenderAPI_Vulkan::DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4)
 {
      // not needed, we already configured the event to be inside a render pass
@@ -647,39 +981,21 @@ void RenderAPI_Vulkan::DrawSimpleTriangles(const float worldMatrix[16], int tria
     if (!m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
         return;
 
-    // Unity does not destroy render passes, so this is safe regarding ABA-problem
-    if (recordingState.renderPass != m_TrianglePipelineRenderPass)
-    {
-        if (m_TrianglePipelineLayout == VK_NULL_HANDLE)
-            m_TrianglePipelineLayout = CreateTrianglePipelineLayout(m_Instance.device);
-
-        m_TrianglePipeline = CreateTrianglePipeline(m_Instance.device, m_TrianglePipelineLayout, recordingState.renderPass, VK_NULL_HANDLE);
-		m_TrianglePipelineRenderPass = recordingState.renderPass;
-    }
-
-    if (m_TrianglePipeline != VK_NULL_HANDLE && m_TrianglePipelineLayout != VK_NULL_HANDLE)
+    if (EnsureTrianglePipeline(recordingState))
     {
         VulkanBuffer buffer;
-        if (!CreateVulkanBuffer(16 * 3 * triangleCount, &buffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT))
+        if (!CreateVulkanBuffer(16 * 3 * triangleCount, &buffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, kVulkanMemoryUsage_Dynamic))
             return;
 
         memcpy(buffer.mapped, verticesFloat3Byte4, static_cast<size_t>(buffer.sizeInBytes));
-        if (!(buffer.deviceMemoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-        {
-            VkMappedMemoryRange range;
-            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-            range.pNext = NULL;
-            range.memory = buffer.deviceMemory;
-            range.offset = 0;
-            range.size = buffer.deviceMemorySize;
-            vkFlushMappedMemoryRanges(m_Instance.device, 1, &range);
-        }
+        MarkWritten(buffer, 0, buffer.sizeInBytes);
+        FlushWrittenRanges();
 
         const VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(recordingState.commandBuffer, 0, 1, &buffer.buffer, &offset);
-        vkCmdPushConstants(recordingState.commandBuffer, m_TrianglePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, 64, (const void*)worldMatrix);
-        vkCmdBindPipeline(recordingState.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_TrianglePipeline);
-        vkCmdDraw(recordingState.commandBuffer, triangleCount * 3, 1, 0, 0);
+        m_Vk->vkCmdBindVertexBuffers(recordingState.commandBuffer, 0, 1, &buffer.buffer, &offset);
+        m_Vk->vkCmdPushConstants(recordingState.commandBuffer, m_TrianglePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, 64, (const void*)worldMatrix);
+        m_Vk->vkCmdBindPipeline(recordingState.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_TrianglePipeline);
+        m_Vk->vkCmdDraw(recordingState.commandBuffer, triangleCount * 3, 1, 0, 0);
 
         SafeDestroy(recordingState.currentFrameNumber, buffer);
     }
@@ -692,19 +1008,138 @@ void* RenderAPI_Vulkan::BeginModifyTexture(void* textureHandle, int textureWidth
     *outRowPitch = textureWidth * 4;
     const size_t stagingBufferSizeRequirements = *outRowPitch * textureHeight;
 
+    // Host image copy reads straight from CPU memory, no staging buffer needed
+    if (CanHostCopyToTexture(textureHandle))
+    {
+        m_HostTextureData.resize(stagingBufferSizeRequirements);
+        return m_HostTextureData.data();
+    }
+
     UnityVulkanRecordingState recordingState;
     if (!m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
         return NULL;
 
     SafeDestroy(recordingState.currentFrameNumber, m_TextureStagingBuffer);
     m_TextureStagingBuffer = VulkanBuffer();
-    if (!CreateVulkanBuffer(stagingBufferSizeRequirements, &m_TextureStagingBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT))
+    if (!CreateVulkanBuffer(stagingBufferSizeRequirements, &m_TextureStagingBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, kVulkanMemoryUsage_Staging))
         return NULL;
 
     return m_TextureStagingBuffer.mapped;
 }
 
 void RenderAPI_Vulkan::EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr)
+{
+    if (!m_HostTextureData.empty() && dataPtr == m_HostTextureData.data())
+    {
+        if (HostCopyToTexture(textureHandle, textureWidth, textureHeight, rowPitch, dataPtr))
+            return;
+
+        // Image can't take a host copy after all; stage what the caller wrote
+        UnityVulkanRecordingState recordingState;
+        if (!m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
+            return;
+        SafeDestroy(recordingState.currentFrameNumber, m_TextureStagingBuffer);
+        m_TextureStagingBuffer = VulkanBuffer();
+        if (!CreateVulkanBuffer(m_HostTextureData.size(), &m_TextureStagingBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, kVulkanMemoryUsage_Staging))
+            return;
+        memcpy(m_TextureStagingBuffer.mapped, dataPtr, m_HostTextureData.size());
+    }
+
+    if (m_TextureStagingBuffer.mapped)
+    {
+        MarkWritten(m_TextureStagingBuffer, 0, m_TextureStagingBuffer.sizeInBytes);
+        FlushWrittenRanges();
+    }
+    CopyStagingToTexture(textureHandle, textureWidth, textureHeight);
+}
+
+// Whether textureHandle's image was created with host transfer usage (see Hook_vkCreateImage).
+// Doesn't touch the image.
+bool RenderAPI_Vulkan::CanHostCopyToTexture(void* textureHandle)
+{
+#ifdef VK_EXT_host_image_copy
+    if (!m_HostImageCopy)
+        return false;
+    UnityVulkanImage image;
+    if (!m_UnityVulkan->AccessTexture(textureHandle, UnityVulkanWholeImage, VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, kUnityVulkanResourceAccess_ObserveOnly, &image))
+        return false;
+    // Rebuilding the mip chain takes blits in the command buffer anyway
+    if (m_GenerateMips && CanGenerateMips(image))
+        return false;
+    return (image.usage & VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT) != 0;
+#else
+    return false;
+#endif
+}
+
+// Writes the pixels into the image from the CPU: no staging buffer, no command buffer work,
+// and no need to leave Unity's render pass. Writes made before submission are visible to the
+// GPU without a barrier.
+//
+// Frames still in flight may sample the texture, and a host write isn't ordered against them.
+// So every host copy goes to a recreated image (Unity keeps the old one alive until the GPU is
+// done with it), moved from UNDEFINED into the layout Unity reports for it on the host.
+//
+// False if the write didn't happen and the caller has to stage it instead, for this upload
+// only. That includes the image being in a layout host copies can't write to: the plugin
+// must not leave the image in a layout other than the one Unity tracks.
+bool RenderAPI_Vulkan::HostCopyToTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, const void* pixels)
+{
+#ifdef VK_EXT_host_image_copy
+    if (!CanHostCopyToTexture(textureHandle))
+        return false;
+
+    UnityVulkanImage image;
+    if (!m_UnityVulkan->AccessTexture(textureHandle, UnityVulkanWholeImage, VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, kUnityVulkanResourceAccess_ObserveOnly, &image))
+        return false;
+
+    // The whole image is about to be overwritten, so it may start out UNDEFINED
+    if (image.extent.width != (uint32_t)textureWidth || image.extent.height != (uint32_t)textureHeight)
+        return false;
+    if (!m_UnityVulkan->AccessTexture(textureHandle, UnityVulkanWholeImage, ChooseHostImageCopyDstLayout(),
+        VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT, kUnityVulkanResourceAccess_Recreate, &image))
+        return false;
+    if (!IsHostImageCopyDstLayout(image.layout))
+        return false;
+
+    VkHostImageLayoutTransitionInfoEXT transition = {};
+    transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+    transition.image = image.image;
+    transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    transition.newLayout = image.layout;
+    transition.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    transition.subresourceRange.levelCount = 1;
+    transition.subresourceRange.layerCount = 1;
+    if (m_Vk->vkTransitionImageLayoutEXT(m_Instance.device, 1, &transition) != VK_SUCCESS)
+        return false;
+
+    VkMemoryToImageCopyEXT region = {};
+    region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+    region.pHostPointer = pixels;
+    region.memoryRowLength = rowPitch / 4; // in texels
+    region.memoryImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = textureWidth;
+    region.imageExtent.height = textureHeight;
+    region.imageExtent.depth = 1;
+
+    VkCopyMemoryToImageInfoEXT copyInfo = {};
+    copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+    copyInfo.dstImage = image.image;
+    copyInfo.dstImageLayout = image.layout;
+    copyInfo.regionCount = 1;
+    copyInfo.pRegions = &region;
+    return m_Vk->vkCopyMemoryToImageEXT(m_Instance.device, &copyInfo) == VK_SUCCESS;
+#else
+    return false;
+#endif
+}
+
+// Records the copy of m_TextureStagingBuffer (tightly packed rows) into the texture
+void RenderAPI_Vulkan::CopyStagingToTexture(void* textureHandle, int textureWidth, int textureHeight)
 {
     // cannot do resource uploads inside renderpass
     m_UnityVulkan->EnsureOutsideRenderPass();
@@ -732,7 +1167,91 @@ void RenderAPI_Vulkan::EndModifyTexture(void* textureHandle, int textureWidth, i
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
     region.imageSubresource.mipLevel = 0;
-    vkCmdCopyBufferToImage(recordingState.commandBuffer, m_TextureStagingBuffer.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    m_Vk->vkCmdCopyBufferToImage(recordingState.commandBuffer, m_TextureStagingBuffer.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    if (m_GenerateMips && CanGenerateMips(image))
+        RecordMipChain(recordingState.commandBuffer, image);
+}
+
+// Whether RecordMipChain can rebuild image's mips: more than one level, a single-sampled
+// color image Unity lets us blit from and to, and a format with linear-filtered blits.
+// Format support is asked once per format.
+bool RenderAPI_Vulkan::CanGenerateMips(const UnityVulkanImage& image)
+{
+    if (image.mipCount <= 1 || image.aspect != VK_IMAGE_ASPECT_COLOR_BIT || image.samples != VK_SAMPLE_COUNT_1_BIT)
+        return false;
+    const VkImageUsageFlags blitUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if ((image.usage & blitUsage) != blitUsage)
+        return false;
+
+    std::map<VkFormat, bool>::iterator it = m_MipBlitFormats.find(image.format);
+    if (it == m_MipBlitFormats.end())
+    {
+        VkFormatProperties properties;
+        m_Vk->vkGetPhysicalDeviceFormatProperties(m_Instance.physicalDevice, image.format, &properties);
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        const VkFormatFeatureFlags features = image.tiling == VK_IMAGE_TILING_LINEAR ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+        it = m_MipBlitFormats.insert(std::make_pair(image.format, (features & required) == required)).first;
+    }
+    return it->second;
+}
+
+// Records blits that filter each mip of image down from the one above, after mip 0 was
+// written by a transfer. The image comes from AccessTexture with the whole image in
+// TRANSFER_DST_OPTIMAL for a transfer write, and goes back to exactly that, so Unity's own
+// tracking of it stays right and its next barrier covers the blits.
+void RenderAPI_Vulkan::RecordMipChain(VkCommandBuffer commandBuffer, const UnityVulkanImage& image)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = (uint32_t)image.layers;
+
+    int32_t width = (int32_t)image.extent.width;
+    int32_t height = (int32_t)image.extent.height;
+    int32_t depth = (int32_t)image.extent.depth;
+    for (int level = 1; level < image.mipCount; ++level)
+    {
+        // The level above has just been written, by the upload or the previous blit; read it
+        // from here on. This level is still in TRANSFER_DST_OPTIMAL from AccessTexture.
+        barrier.subresourceRange.baseMipLevel = (uint32_t)(level - 1);
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        m_Vk->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+        VkImageBlit blit = {};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = (uint32_t)(level - 1);
+        blit.srcSubresource.layerCount = (uint32_t)image.layers;
+        blit.srcOffsets[1].x = width;
+        blit.srcOffsets[1].y = height;
+        blit.srcOffsets[1].z = depth;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        depth = depth > 1 ? depth / 2 : 1;
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = (uint32_t)level;
+        blit.dstSubresource.layerCount = (uint32_t)image.layers;
+        blit.dstOffsets[1].x = width;
+        blit.dstOffsets[1].y = height;
+        blit.dstOffsets[1].z = depth;
+        m_Vk->vkCmdBlitImage(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+    }
+
+    // Every level but the last was a blit source; the last one is already where Unity expects it
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = (uint32_t)(image.mipCount - 1);
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    m_Vk->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
 }
 
 void* RenderAPI_Vulkan::BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize)
@@ -769,15 +1288,619 @@ void RenderAPI_Vulkan::EndModifyVertexBuffer(void* bufferHandle)
     if (!m_UnityVulkan->AccessBuffer(bufferHandle, 0, 0, kUnityVulkanResourceAccess_ObserveOnly, &buffer))
         return;
 
-    if (!(buffer.memory.flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+    // BeginModifyVertexBuffer handed out the buffer's size, not its (padded) memory size
+    MarkWritten(buffer, 0, buffer.sizeInBytes);
+    FlushWrittenRanges();
+}
+
+// Imports the caller's allocation as a transfer source buffer. The memory type has to be one
+// the driver allows for that pointer (vkGetMemoryHostPointerPropertiesEXT), and base/size
+// have to be multiples of minImportedHostPointerAlignment.
+bool RenderAPI_Vulkan::RegisterHostMemory(const void* base, size_t size)
+{
+    if (!m_Vk || !m_Vk->vkGetMemoryHostPointerPropertiesEXT || s_MinImportedHostPointerAlignment == 0 || size == 0)
+        return false;
+    if ((uintptr_t)base % s_MinImportedHostPointerAlignment != 0 || size % s_MinImportedHostPointerAlignment != 0)
+        return false;
+    if (m_HostMemoryImports.find((uintptr_t)base) != m_HostMemoryImports.end())
+        return true;
+
+    VkMemoryHostPointerPropertiesEXT pointerProperties = {};
+    pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    if (m_Vk->vkGetMemoryHostPointerPropertiesEXT(m_Instance.device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, base, &pointerProperties) != VK_SUCCESS)
+        return false;
+
+    VkExternalMemoryBufferCreateInfo externalCreateInfo = {};
+    externalCreateInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    externalCreateInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.pNext = &externalCreateInfo;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VulkanBuffer buffer = VulkanBuffer();
+    if (m_Vk->vkCreateBuffer(m_Instance.device, &bufferCreateInfo, NULL, &buffer.buffer) != VK_SUCCESS)
+        return false;
+
+    VkMemoryRequirements memoryRequirements;
+    m_Vk->vkGetBufferMemoryRequirements(m_Instance.device, buffer.buffer, &memoryRequirements);
+    memoryRequirements.memoryTypeBits &= pointerProperties.memoryTypeBits;
+    memoryRequirements.size = size; // imports are exactly the host range
+
+    VkImportMemoryHostPointerInfoEXT importInfo = {};
+    importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    importInfo.pHostPointer = const_cast<void*>(base);
+
+    int memoryTypeIndex;
+    if (!AllocateVulkanMemory(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, kVulkanMemoryUsage_Staging, &importInfo, &buffer.deviceMemory, &memoryTypeIndex)
+        || m_Vk->vkBindBufferMemory(m_Instance.device, buffer.buffer, buffer.deviceMemory, 0) != VK_SUCCESS)
+    {
+        ImmediateDestroyVulkanBuffer(buffer);
+        return false;
+    }
+
+    // Not mapped by us: the caller writes through its own pointer. Host memory is coherent
+    // with the import by definition, so there is nothing to flush either.
+    buffer.sizeInBytes = size;
+    buffer.deviceMemorySize = size;
+    buffer.deviceMemoryFlags = m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+    HostMemoryImport hostImport;
+    hostImport.buffer = buffer;
+    hostImport.size = size;
+    m_HostMemoryImports[(uintptr_t)base] = hostImport;
+    return true;
+}
+
+void RenderAPI_Vulkan::UnregisterHostMemory(const void* base)
+{
+    std::map<uintptr_t, HostMemoryImport>::iterator it = m_HostMemoryImports.find((uintptr_t)base);
+    if (it == m_HostMemoryImports.end())
+        return;
+
+    UnityVulkanRecordingState recordingState;
+    if (m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
+        SafeDestroy(recordingState.currentFrameNumber, it->second.buffer);
+    else
+        ImmediateDestroyVulkanBuffer(it->second.buffer);
+    m_HostMemoryImports.erase(it);
+}
+
+bool RenderAPI_Vulkan::GetGpuFrameNumbers(unsigned long long* outCurrentFrame, unsigned long long* outSafeFrame)
+{
+    UnityVulkanRecordingState recordingState;
+    if (!m_UnityVulkan || !m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
+        return false;
+    *outCurrentFrame = recordingState.currentFrameNumber;
+    *outSafeFrame = recordingState.safeFrameNumber;
+    return true;
+}
+
+// What AccessQueue hands to WaitForQueueIdle; it may run after the backend is gone
+struct QueueIdleWait
+{
+    const VulkanDispatch* vk;
+    VkQueue queue;
+    void (*done)(void* userData);
+    void* userData;
+};
+
+static void UNITY_INTERFACE_API WaitForQueueIdle(int eventId, void* data)
+{
+    QueueIdleWait* wait = static_cast<QueueIdleWait*>(data);
+    wait->vk->vkQueueWaitIdle(wait->queue);
+    wait->done(wait->userData);
+    delete wait;
+}
+
+// Unity submits what it recorded so far, then lets us at its queue; waiting for the queue
+// covers every upload from imported memory
+void RenderAPI_Vulkan::CallWhenGpuIdle(void (*done)(void* userData), void* userData)
+{
+    if (!m_Vk)
+    {
+        done(userData);
+        return;
+    }
+    QueueIdleWait* wait = new QueueIdleWait;
+    wait->vk = m_Vk;
+    wait->queue = m_Instance.graphicsQueue;
+    wait->done = done;
+    wait->userData = userData;
+    m_UnityVulkan->AccessQueue(WaitForQueueIdle, 0, wait, true);
+}
+
+// The registered range holding all of [data, data + size), as a buffer and offset into it
+bool RenderAPI_Vulkan::FindHostMemory(const void* data, size_t size, VkBuffer* outBuffer, VkDeviceSize* outOffset) const
+{
+    if (m_HostMemoryImports.empty())
+        return false;
+
+    const uintptr_t address = (uintptr_t)data;
+    std::map<uintptr_t, HostMemoryImport>::const_iterator it = m_HostMemoryImports.upper_bound(address);
+    if (it == m_HostMemoryImports.begin())
+        return false;
+    --it;
+    if (address + size > it->first + it->second.size)
+        return false;
+
+    *outBuffer = it->second.buffer.buffer;
+    *outOffset = address - it->first;
+    return true;
+}
+
+// Secondaries cost a begin/end, state setup and an execute each; below this many draws per
+// secondary recording them inline on the render thread is cheaper
+static const int kMinDrawsPerSecondary = 64;
+
+// Splits the draws into secondaries recorded by the workers, each of them also copying its
+// draws' vertices into vertexBuffer, and executes them in order. False, with nothing recorded
+// into recordingState's command buffer, if the secondaries couldn't be set up.
+bool RenderAPI_Vulkan::RecordDrawsInSecondaries(const UnityVulkanRecordingState& recordingState, const VkCommandBufferInheritanceInfo& inheritance,
+    const VkRect2D& renderArea, const std::vector<const RenderCommand*>& draws, const VulkanBuffer& vertexBuffer)
+{
+    // A couple of secondaries per worker so stealing can even out the load
+    const int drawCount = static_cast<int>(draws.size());
+    const int targetCount = m_WorkerPool->GetThreadCount() * 2;
+    const int grain = std::max(kMinDrawsPerSecondary, (drawCount + targetCount - 1) / targetCount);
+    const int secondaryCount = (drawCount + grain - 1) / grain;
+    if (secondaryCount < 2)
+        return false;
+
+    VulkanSecondaryCommandPools::FrameSet* frame = m_SecondaryPools.BeginFrame(recordingState.currentFrameNumber, recordingState.safeFrameNumber, secondaryCount);
+    if (!frame)
+        return false;
+    std::vector<VkCommandBuffer> secondaries(secondaryCount);
+    for (int i = 0; i < secondaryCount; ++i)
+    {
+        secondaries[i] = m_SecondaryPools.Allocate(frame, i);
+        if (secondaries[i] == VK_NULL_HANDLE)
+            return false;
+    }
+
+    // Where each draw's vertices go
+    std::vector<size_t> byteOffsets(drawCount);
+    std::vector<uint32_t> firstVertices(drawCount);
+    size_t byteOffset = 0;
+    uint32_t firstVertex = 0;
+    for (int i = 0; i < drawCount; ++i)
+    {
+        byteOffsets[i] = byteOffset;
+        firstVertices[i] = firstVertex;
+        byteOffset += draws[i]->size;
+        firstVertex += draws[i]->triangleCount * 3;
+    }
+
+    const VulkanDispatch& vk = *m_Vk;
+    const VkPipeline pipeline = m_TrianglePipeline;
+    const VkPipelineLayout pipelineLayout = m_TrianglePipelineLayout;
+    m_WorkerPool->ParallelFor(drawCount, grain, [&](int begin, int end) {
+        // Chunks start at multiples of grain, and each has its own pool
+        VkCommandBuffer commandBuffer = secondaries[begin / grain];
+        for (int i = begin; i < end; ++i)
+            memcpy((unsigned char*)vertexBuffer.mapped + byteOffsets[i], draws[i]->data, draws[i]->size);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+        vk.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        VkViewport viewport;
+        viewport.x = (float)renderArea.offset.x;
+        viewport.y = (float)renderArea.offset.y;
+        viewport.width = (float)renderArea.extent.width;
+        viewport.height = (float)renderArea.extent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vk.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vk.vkCmdSetScissor(commandBuffer, 0, 1, &renderArea);
+
+        const VkDeviceSize bindOffset = 0;
+        vk.vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, &bindOffset);
+        vk.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        for (int i = begin; i < end; ++i)
+        {
+            vk.vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, 64, (const void*)draws[i]->worldMatrix);
+            vk.vkCmdDraw(commandBuffer, draws[i]->triangleCount * 3, 1, firstVertices[i], 0);
+        }
+        vk.vkEndCommandBuffer(commandBuffer);
+    });
+
+    m_Vk->vkCmdExecuteCommands(recordingState.commandBuffer, secondaryCount, secondaries.data());
+    return true;
+}
+
+// Same operations as the immediate calls above, but in one pass over the list:
+// - one recording state query and one GarbageCollect for the whole frame
+// - textures written from the CPU with host image copy where possible
+// - uploads whose data lies in RegisterHostMemory ranges copied by the GPU straight from there
+// - every other texture upload packed into a single staging buffer (one allocation)
+// - all images and buffers acquired before the first copy so Unity's transfer barriers come together
+// - the bytes written to non-coherent memory (staging, vertex buffers, draw vertices) flushed
+//   with one vkFlushMappedMemoryRanges at the end
+// - all draws from one vertex buffer with the pipeline bound once; large batches recorded
+//   into secondaries on the workers when Unity's render pass allows it
+void RenderAPI_Vulkan::ExecuteCommandList(const RenderCommandList& commandList)
+{
+    UnityVulkanRecordingState recordingState;
+    if (!m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
+        return;
+
+    // Copies recorded into Unity's command buffer; source is VK_NULL_HANDLE for the staging buffer
+    struct TextureCopy
+    {
+        const RenderCommand* command;
+        VkBuffer source;
+        VkBufferImageCopy region;
+    };
+    struct BufferCopy
+    {
+        const RenderCommand* command;
+        VkBuffer source;
+        VkDeviceSize sourceOffset;
+    };
+    std::vector<TextureCopy> textureCopies;
+    std::vector<BufferCopy> bufferCopies;
+    std::vector<const RenderCommand*> mappedVertexUploads;
+    size_t stagingBytes = 0;
+    size_t drawBytes = 0;
+    for (const RenderCommand& command : commandList)
+    {
+        if (command.type == kRenderCommand_UploadTexture)
+        {
+            if (command.width <= 0 || command.height <= 0)
+                continue;
+            if (HostCopyToTexture(command.resource, command.width, command.height, command.rowPitch, command.data))
+                continue;
+
+            TextureCopy copy = {};
+            copy.command = &command;
+            copy.region.imageExtent.width = command.width;
+            copy.region.imageExtent.height = command.height;
+            copy.region.imageExtent.depth = 1;
+            copy.region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copy.region.imageSubresource.layerCount = 1;
+
+            // bufferOffset and the row length have to be whole texels
+            const size_t dataSize = (size_t)command.rowPitch * (command.height - 1) + (size_t)command.width * 4;
+            if (command.rowPitch % 4 == 0 && FindHostMemory(command.data, dataSize, &copy.source, &copy.region.bufferOffset) && copy.region.bufferOffset % 4 == 0)
+            {
+                copy.region.bufferRowLength = command.rowPitch / 4;
+            }
+            else
+            {
+                // Keep staged copies 16-byte aligned
+                copy.source = VK_NULL_HANDLE;
+                stagingBytes = (stagingBytes + 15) & ~size_t(15);
+                copy.region.bufferOffset = stagingBytes;
+                stagingBytes += (size_t)command.width * 4 * command.height;
+            }
+            textureCopies.push_back(copy);
+        }
+        else if (command.type == kRenderCommand_UploadVertexBuffer)
+        {
+            UnityVulkanBuffer bufferInfo;
+            if (!m_UnityVulkan->AccessBuffer(command.resource, 0, 0, kUnityVulkanResourceAccess_ObserveOnly, &bufferInfo))
+                continue;
+            if (bufferInfo.sizeInBytes != command.size)
+                continue;
+
+            BufferCopy copy;
+            copy.command = &command;
+            if ((bufferInfo.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && FindHostMemory(command.data, command.size, &copy.source, &copy.sourceOffset))
+                bufferCopies.push_back(copy);
+            else if (bufferInfo.memory.mapped)
+                mappedVertexUploads.push_back(&command);
+        }
+        else if (command.type == kRenderCommand_DrawTriangles)
+        {
+            drawBytes += command.size;
+        }
+    }
+
+    // Staged texture data, tightly packed
+    if (stagingBytes > 0)
+    {
+        SafeDestroy(recordingState.currentFrameNumber, m_TextureStagingBuffer);
+        m_TextureStagingBuffer = VulkanBuffer();
+        if (!CreateVulkanBuffer(stagingBytes, &m_TextureStagingBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, kVulkanMemoryUsage_Staging))
+            m_TextureStagingBuffer = VulkanBuffer();
+        for (TextureCopy& copy : textureCopies)
+        {
+            if (copy.source != VK_NULL_HANDLE || !m_TextureStagingBuffer.mapped)
+                continue;
+            const RenderCommand& command = *copy.command;
+            const size_t rowBytes = (size_t)command.width * 4;
+            unsigned char* dst = (unsigned char*)m_TextureStagingBuffer.mapped + copy.region.bufferOffset;
+            const unsigned char* src = (const unsigned char*)command.data;
+            for (int y = 0; y < command.height; ++y)
+                memcpy(dst + y * rowBytes, src + (size_t)y * command.rowPitch, rowBytes);
+            copy.source = m_TextureStagingBuffer.buffer;
+        }
+        if (m_TextureStagingBuffer.mapped)
+            MarkWritten(m_TextureStagingBuffer, 0, stagingBytes);
+    }
+
+    if (!textureCopies.empty() || !bufferCopies.empty())
+    {
+        // cannot do resource uploads inside renderpass
+        m_UnityVulkan->EnsureOutsideRenderPass();
+
+        std::vector<UnityVulkanImage> images;
+        for (const TextureCopy& copy : textureCopies)
+        {
+            UnityVulkanImage image;
+            if (copy.source == VK_NULL_HANDLE || !m_UnityVulkan->AccessTexture(copy.command->resource, UnityVulkanWholeImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, kUnityVulkanResourceAccess_PipelineBarrier, &image))
+                image.image = VK_NULL_HANDLE;
+            images.push_back(image);
+        }
+        std::vector<VkBuffer> buffers;
+        for (const BufferCopy& copy : bufferCopies)
+        {
+            UnityVulkanBuffer buffer;
+            if (!m_UnityVulkan->AccessBuffer(copy.command->resource, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, kUnityVulkanResourceAccess_PipelineBarrier, &buffer))
+                buffer.buffer = VK_NULL_HANDLE;
+            buffers.push_back(buffer.buffer);
+        }
+
+        // Leaving the render pass may have switched command buffers
+        if (m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
+        {
+            for (size_t i = 0; i < textureCopies.size(); ++i)
+            {
+                if (images[i].image != VK_NULL_HANDLE)
+                    m_Vk->vkCmdCopyBufferToImage(recordingState.commandBuffer, textureCopies[i].source, images[i].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &textureCopies[i].region);
+            }
+            // After all the copies, so each chain's first barrier also waits for its copy
+            for (size_t i = 0; i < textureCopies.size() && m_GenerateMips; ++i)
+            {
+                if (images[i].image != VK_NULL_HANDLE && CanGenerateMips(images[i]))
+                    RecordMipChain(recordingState.commandBuffer, images[i]);
+            }
+            for (size_t i = 0; i < bufferCopies.size(); ++i)
+            {
+                if (buffers[i] == VK_NULL_HANDLE)
+                    continue;
+                VkBufferCopy region;
+                region.srcOffset = bufferCopies[i].sourceOffset;
+                region.dstOffset = 0;
+                region.size = bufferCopies[i].command->size;
+                m_Vk->vkCmdCopyBuffer(recordingState.commandBuffer, bufferCopies[i].source, buffers[i], 1, &region);
+            }
+        }
+    }
+
+    // Remaining vertex buffer uploads, straight into recreated host-visible buffers
+    for (const RenderCommand* upload : mappedVertexUploads)
+    {
+        const RenderCommand& command = *upload;
+
+        // We don't want to start modifying a resource that might still be used by the GPU,
+        // so we can use kUnityVulkanResourceAccess_Recreate to recreate it while still keeping the old one alive if it's in use.
+        UnityVulkanBuffer recreatedBuffer;
+        if (!m_UnityVulkan->AccessBuffer(command.resource, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT, kUnityVulkanResourceAccess_Recreate, &recreatedBuffer))
+            continue;
+        memcpy(recreatedBuffer.memory.mapped, command.data, command.size);
+        MarkWritten(recreatedBuffer, 0, command.size);
+    }
+
+    // Draws
+    if (drawBytes > 0)
+    {
+        m_UnityVulkan->EnsureInsideRenderPass();
+        VulkanBuffer vertexBuffer;
+        if (m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare)
+            && EnsureTrianglePipeline(recordingState)
+            && CreateVulkanBuffer(drawBytes, &vertexBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, kVulkanMemoryUsage_Dynamic))
+        {
+            std::vector<const RenderCommand*> draws;
+            for (const RenderCommand& command : commandList)
+            {
+                if (command.type == kRenderCommand_DrawTriangles)
+                    draws.push_back(&command);
+            }
+
+            SecondaryRenderPassState renderPassState;
+            bool recorded = false;
+            if (m_WorkerPool && draws.size() >= 2 * kMinDrawsPerSecondary && GetSecondaryRenderPassState(recordingState, &renderPassState))
+            {
+                VkCommandBufferInheritanceInfo inheritance = {};
+                inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+                inheritance.renderPass = renderPassState.renderPass;
+                inheritance.subpass = renderPassState.subpass;
+                inheritance.framebuffer = renderPassState.framebuffer;
+                recorded = RecordDrawsInSecondaries(recordingState, inheritance, renderPassState.renderArea, draws, vertexBuffer);
+            }
+
+            if (!recorded)
+            {
+                size_t offset = 0;
+                for (const RenderCommand* command : draws)
+                {
+                    memcpy((unsigned char*)vertexBuffer.mapped + offset, command->data, command->size);
+                    offset += command->size;
+                }
+
+                const VkDeviceSize bindOffset = 0;
+                m_Vk->vkCmdBindVertexBuffers(recordingState.commandBuffer, 0, 1, &vertexBuffer.buffer, &bindOffset);
+                m_Vk->vkCmdBindPipeline(recordingState.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_TrianglePipeline);
+                uint32_t firstVertex = 0;
+                for (const RenderCommand* command : draws)
+                {
+                    m_Vk->vkCmdPushConstants(recordingState.commandBuffer, m_TrianglePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, 64, (const void*)command->worldMatrix);
+                    m_Vk->vkCmdDraw(recordingState.commandBuffer, command->triangleCount * 3, 1, firstVertex, 0);
+                    firstVertex += command->triangleCount * 3;
+                }
+            }
+            MarkWritten(vertexBuffer, 0, drawBytes);
+            SafeDestroy(recordingState.currentFrameNumber, vertexBuffer);
+        }
+    }
+
+    FlushWrittenRanges();
+    GarbageCollect();
+}
+
+// Smallest readback ring; one 512x512 readback per frame for a few frames fits
+static const VkDeviceSize kMinReadbackRingSize = 4 * 1024 * 1024;
+
+static bool IsReadbackFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Room for size bytes in the readback ring, after everything still pending in it. When it
+// doesn't fit, the ring is retired and a bigger one takes its place.
+bool RenderAPI_Vulkan::AllocateReadback(VkDeviceSize size, VkDeviceSize* outOffset)
+{
+    if (m_ReadbackRing.buffer != VK_NULL_HANDLE)
+    {
+        // Oldest readback still in the current ring; the ones in front of it are in retired rings
+        const PendingReadback* tail = NULL;
+        for (size_t i = 0; i < m_PendingReadbacks.size() && !tail; ++i)
+            if (m_PendingReadbacks[i].ring.buffer == m_ReadbackRing.buffer)
+                tail = &m_PendingReadbacks[i];
+
+        const VkDeviceSize capacity = m_ReadbackRing.sizeInBytes;
+        VkDeviceSize offset = capacity;
+        if (!tail)
+            offset = size <= capacity ? 0 : capacity;
+        else if (m_ReadbackHead > tail->offset)
+            offset = capacity - m_ReadbackHead >= size ? m_ReadbackHead : size <= tail->offset ? 0 : capacity;
+        else if (tail->offset - m_ReadbackHead >= size)
+            offset = m_ReadbackHead;
+
+        if (offset < capacity)
+        {
+            *outOffset = offset;
+            m_ReadbackHead = offset + size;
+            return true;
+        }
+
+        // Nothing in the ring is pending: the GPU and the CPU are both done with it
+        if (!tail)
+            ImmediateDestroyVulkanBuffer(m_ReadbackRing);
+        else
+            m_RetiredReadbackRings.push_back(m_ReadbackRing);
+    }
+
+    const VkDeviceSize capacity = std::max(std::max(kMinReadbackRingSize, m_ReadbackRing.sizeInBytes * 2), size);
+    m_ReadbackRing = VulkanBuffer();
+    m_ReadbackHead = 0;
+    if (!CreateVulkanBuffer(static_cast<size_t>(capacity), &m_ReadbackRing, VK_BUFFER_USAGE_TRANSFER_DST_BIT, kVulkanMemoryUsage_Readback))
+    {
+        m_ReadbackRing = VulkanBuffer();
+        return false;
+    }
+    *outOffset = 0;
+    m_ReadbackHead = size;
+    return true;
+}
+
+bool RenderAPI_Vulkan::BeginReadback(const ReadbackRequest& request)
+{
+    if (!m_Vk)
+        return false;
+
+    UnityVulkanImage image;
+    if (!m_UnityVulkan->AccessTexture(request.textureHandle, UnityVulkanWholeImage, VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, kUnityVulkanResourceAccess_ObserveOnly, &image))
+        return false;
+    if (!IsReadbackFormat(image.format) || image.samples != VK_SAMPLE_COUNT_1_BIT
+        || (uint32_t)request.x + request.width > image.extent.width || (uint32_t)request.y + request.height > image.extent.height)
+        return false;
+
+    // Copies can't be recorded inside a render pass
+    m_UnityVulkan->EnsureOutsideRenderPass();
+    if (!m_UnityVulkan->AccessTexture(request.textureHandle, UnityVulkanWholeImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, kUnityVulkanResourceAccess_PipelineBarrier, &image))
+        return false;
+
+    UnityVulkanRecordingState recordingState;
+    if (!m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
+        return false;
+
+    // Whole atoms, so the range can be invalidated without touching a neighbour's
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(m_NonCoherentAtomSize, 16);
+    const VkDeviceSize size = ((VkDeviceSize)request.width * request.height * 4 + alignment - 1) / alignment * alignment;
+    VkDeviceSize offset;
+    if (!AllocateReadback(size, &offset))
+        return false;
+
+    VkBufferImageCopy region = {};
+    region.bufferOffset = offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset.x = request.x;
+    region.imageOffset.y = request.y;
+    region.imageExtent.width = request.width;
+    region.imageExtent.height = request.height;
+    region.imageExtent.depth = 1;
+    m_Vk->vkCmdCopyImageToBuffer(recordingState.commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_ReadbackRing.buffer, 1, &region);
+
+    // Makes the copy visible to the host once the frame's fence has signalled
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    m_Vk->vkCmdPipelineBarrier(recordingState.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+    PendingReadback pending;
+    pending.id = request.id;
+    pending.ring = m_ReadbackRing;
+    pending.offset = offset;
+    pending.size = size;
+    pending.width = request.width;
+    pending.frameNumber = recordingState.currentFrameNumber;
+    m_PendingReadbacks.push_back(pending);
+    return true;
+}
+
+void RenderAPI_Vulkan::PollReadbacks(ReadbackQueue* queue)
+{
+    if (!m_Vk || m_PendingReadbacks.empty())
+        return;
+
+    UnityVulkanRecordingState recordingState;
+    if (!m_UnityVulkan->CommandRecordingState(&recordingState, kUnityVulkanGraphicsQueueAccess_DontCare))
+        return;
+
+    while (!m_PendingReadbacks.empty() && m_PendingReadbacks.front().frameNumber <= recordingState.safeFrameNumber)
+    {
+        const PendingReadback& readback = m_PendingReadbacks.front();
+        if ((readback.ring.deviceMemoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+        {
+            VkMappedMemoryRange range = {};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = readback.ring.deviceMemory;
+            range.offset = readback.offset;
+            range.size = readback.size;
+            m_Vk->vkInvalidateMappedMemoryRanges(m_Instance.device, 1, &range);
+        }
+        queue->Complete(readback.id, static_cast<const unsigned char*>(readback.ring.mapped) + readback.offset, (size_t)readback.width * 4);
+        m_PendingReadbacks.pop_front();
+    }
+
+    // Everything in the retired rings has been collected once the oldest pending readback is in the current one
+    if (m_PendingReadbacks.empty() || m_PendingReadbacks.front().ring.buffer == m_ReadbackRing.buffer)
     {
-        VkMappedMemoryRange range;
-        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        range.pNext = NULL;
-        range.memory = buffer.memory.memory;
-        range.offset = buffer.memory.offset; // size and offset also must be multiple of nonCoherentAtomSize
-        range.size = buffer.memory.size;
-        vkFlushMappedMemoryRanges(m_Instance.device, 1, &range);
+        for (size_t i = 0; i < m_RetiredReadbackRings.size(); ++i)
+            ImmediateDestroyVulkanBuffer(m_RetiredReadbackRings[i]);
+        m_RetiredReadbackRings.clear();
     }
 }
 
@@ -0,0 +1,159 @@
+#pragma once
+
+// Hooks the Vulkan RenderAPI installs into Unity's own Vulkan initialization.
+//
+// Instead of standing up a second VkInstance/VkDevice next to Unity's, the plugin
+// intercepts vkCreateInstance/vkCreateDevice and asks for the extensions it needs
+// on Unity's objects. Anything else in the plugin can then use the device that
+// IUnityGraphicsVulkan::Instance() returns.
+
+#include "PlatformBase.h"
+#include "RenderAPI.h"
+
+struct IUnityInterfaces;
+
+// What the creation hooks managed to enable on Unity's instance and device.
+// Extensions are only injected when the driver reports them, so check before use.
+struct VulkanInjectedExtensions
+{
+    bool externalMemoryCapabilities; // VK_KHR_external_memory_capabilities (instance)
+    bool externalMemory;             // VK_KHR_external_memory
+    bool externalMemoryPlatform;     // VK_KHR_external_memory_win32 / VK_KHR_external_memory_fd
+    bool externalSemaphore;          // VK_KHR_external_semaphore (+ platform variant)
+    bool timelineSemaphore;          // VK_KHR_timeline_semaphore, feature enabled as well
+    bool memoryBudget;               // VK_EXT_memory_budget
+    bool hostImageCopy;              // VK_EXT_host_image_copy, feature enabled as well
+    bool externalMemoryHost;         // VK_EXT_external_memory_host
+    bool nestedCommandBuffer;        // VK_EXT_nested_command_buffer, feature enabled as well
+    bool graphicsPipelineLibrary;    // VK_EXT_graphics_pipeline_library + VK_KHR_pipeline_library, feature enabled as well
+};
+
+// Must be called from UnityPluginLoad, before Unity creates its Vulkan instance.
+extern "C" void RenderAPI_Vulkan_OnPluginLoad(IUnityInterfaces* interfaces);
+
+// Valid after Unity's vkCreateDevice went through our hook; all false otherwise.
+const VulkanInjectedExtensions& RenderAPI_Vulkan_GetInjectedExtensions();
+
+#if SUPPORT_VULKAN
+
+#include <deque>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include "ReadbackQueue.h"
+#include "VulkanDispatch.h"
+#include "VulkanMemoryPolicy.h"
+#include "VulkanSecondaryCommands.h"
+#include "VulkanTrianglePipeline.h"
+
+struct RenderCommand;
+
+struct VulkanBuffer
+{
+    VkBuffer buffer;
+    VkDeviceMemory deviceMemory;
+    void* mapped;
+    VkDeviceSize sizeInBytes;
+    VkDeviceSize deviceMemorySize;
+    VkMemoryPropertyFlags deviceMemoryFlags;
+};
+
+// Vulkan implementation of RenderAPI. Declared here so RenderAPIDispatch.h can call it
+// directly; final, so those calls need no vtable.
+class RenderAPI_Vulkan final : public RenderAPI
+{
+public:
+    RenderAPI_Vulkan();
+    virtual ~RenderAPI_Vulkan() { }
+
+    virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
+    virtual bool GetUsesReverseZ() { return true; }
+    virtual void DrawSimpleTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
+    virtual void* BeginModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int* outRowPitch);
+    virtual void EndModifyTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, void* dataPtr);
+    virtual void* BeginModifyVertexBuffer(void* bufferHandle, size_t* outBufferSize);
+    virtual void EndModifyVertexBuffer(void* bufferHandle);
+    virtual void ExecuteCommandList(const RenderCommandList& commandList);
+    virtual bool RegisterHostMemory(const void* base, size_t size);
+    virtual void UnregisterHostMemory(const void* base);
+    virtual bool GetGpuFrameNumbers(unsigned long long* outCurrentFrame, unsigned long long* outSafeFrame);
+    virtual void CallWhenGpuIdle(void (*done)(void* userData), void* userData);
+    virtual void SetWorkerPool(WorkerPool* pool);
+    virtual void SetGenerateMipsOnUpload(bool enabled) { m_GenerateMips = enabled; }
+    virtual bool BeginReadback(const ReadbackRequest& request);
+    virtual void PollReadbacks(ReadbackQueue* queue);
+
+private:
+    typedef std::vector<VulkanBuffer> VulkanBuffers;
+    typedef std::map<unsigned long long, VulkanBuffers> DeleteQueue;
+
+private:
+    bool CreateVulkanBuffer(size_t bytes, VulkanBuffer* buffer, VkBufferUsageFlags usage, VulkanMemoryUsage memoryUsage);
+    bool AllocateVulkanMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags requiredFlags, VulkanMemoryUsage memoryUsage,
+        const void* pNext, VkDeviceMemory* outMemory, int* outMemoryTypeIndex);
+    void ImmediateDestroyVulkanBuffer(const VulkanBuffer& buffer);
+    void SafeDestroy(unsigned long long frameNumber, const VulkanBuffer& buffer);
+    void GarbageCollect(bool force = false);
+    bool EnsureTrianglePipeline(const UnityVulkanRecordingState& recordingState);
+    void MarkWritten(const VulkanBuffer& buffer, VkDeviceSize offset, VkDeviceSize size);
+    void MarkWritten(const UnityVulkanBuffer& buffer, VkDeviceSize offset, VkDeviceSize size);
+    void MarkWrittenMemory(VkDeviceMemory memory, VkMemoryPropertyFlags flags, VkDeviceSize begin, VkDeviceSize end, VkDeviceSize ownedEnd);
+    void FlushWrittenRanges();
+    bool CanHostCopyToTexture(void* textureHandle);
+    bool HostCopyToTexture(void* textureHandle, int textureWidth, int textureHeight, int rowPitch, const void* pixels);
+    void CopyStagingToTexture(void* textureHandle, int textureWidth, int textureHeight);
+    bool CanGenerateMips(const UnityVulkanImage& image);
+    void RecordMipChain(VkCommandBuffer commandBuffer, const UnityVulkanImage& image);
+    bool AllocateReadback(VkDeviceSize size, VkDeviceSize* outOffset);
+    bool FindHostMemory(const void* data, size_t size, VkBuffer* outBuffer, VkDeviceSize* outOffset) const;
+    bool RecordDrawsInSecondaries(const UnityVulkanRecordingState& recordingState, const VkCommandBufferInheritanceInfo& inheritance,
+        const VkRect2D& renderArea, const std::vector<const RenderCommand*>& draws, const VulkanBuffer& vertexBuffer);
+
+private:
+    IUnityGraphicsVulkan* m_UnityVulkan;
+    UnityVulkanInstance m_Instance;
+    const VulkanDispatch* m_Vk;               // Unity's device, shared table; NULL until initialized
+    VulkanBuffer m_TextureStagingBuffer;
+    VulkanBuffer m_VertexStagingBuffer;
+    std::map<unsigned long long, VulkanBuffers> m_DeleteQueue;
+    VulkanTrianglePipelines m_TrianglePipelines;
+    VkPipelineLayout m_TrianglePipelineLayout; // what EnsureTrianglePipeline found for the current render pass
+    VkPipeline m_TrianglePipeline;
+    VkDeviceSize m_NonCoherentAtomSize;
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+    VulkanMemoryBudget m_MemoryBudget; // refreshed by GarbageCollect, plus what we allocated since
+    // Host writes to non-coherent memory since the last FlushWrittenRanges, atom aligned
+    std::vector<VkMappedMemoryRange> m_WrittenRanges;
+    bool m_HostImageCopy;                     // VK_EXT_host_image_copy usable for Unity's textures
+    std::vector<unsigned char> m_HostTextureData; // what BeginModifyTexture hands out on that path
+    bool m_GenerateMips;                      // see RenderAPI::SetGenerateMipsOnUpload
+    std::map<VkFormat, bool> m_MipBlitFormats; // formats checked for linear blits so far
+    // RegisterHostMemory ranges imported through VK_EXT_external_memory_host, by base address
+    struct HostMemoryImport
+    {
+        VulkanBuffer buffer;
+        size_t size;
+    };
+    std::map<uintptr_t, HostMemoryImport> m_HostMemoryImports;
+    WorkerPool* m_WorkerPool;                 // see RenderAPI::SetWorkerPool; NULL records everything inline
+    VulkanSecondaryCommandPools m_SecondaryPools;
+    // Readbacks are copied into a HOST_CACHED ring and collected once Unity reports their
+    // frame safe, oldest first. A ring that turns out too small is replaced by a bigger one
+    // and destroyed once nothing pending is left in it.
+    struct PendingReadback
+    {
+        PluginHandle id;
+        VulkanBuffer ring;                  // the ring it was copied into, maybe retired since
+        VkDeviceSize offset;
+        VkDeviceSize size;                  // atom aligned
+        int width;                          // rows are width * 4 bytes apart
+        unsigned long long frameNumber;
+    };
+    VulkanBuffer m_ReadbackRing;
+    VkDeviceSize m_ReadbackHead;            // where the next readback goes if it fits
+    std::deque<PendingReadback> m_PendingReadbacks;
+    std::vector<VulkanBuffer> m_RetiredReadbackRings;
+};
+
+#endif // #if SUPPORT_VULKAN
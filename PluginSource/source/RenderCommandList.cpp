@@ -0,0 +1,94 @@
+#include "RenderCommandList.h"
+
+#include <string.h>
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+RenderCommandArena::RenderCommandArena(size_t chunkSize)
+	: m_ChunkSize(chunkSize), m_Used(0), m_Allocated(0)
+{
+}
+
+void* RenderCommandArena::Allocate(size_t size, size_t alignment)
+{
+	m_Allocated += size + alignment;
+	if (!m_Chunks.empty())
+	{
+		Chunk& chunk = m_Chunks.back();
+		// Chunks come from new[], aligned for anything up to max_align_t; offsets keep it
+		const size_t offset = AlignUp(m_Used, alignment);
+		if (offset + size <= chunk.size)
+		{
+			m_Used = offset + size;
+			return chunk.memory.get() + offset;
+		}
+	}
+
+	Chunk chunk;
+	chunk.size = size + alignment > m_ChunkSize ? size + alignment : m_ChunkSize;
+	chunk.memory.reset(new unsigned char[chunk.size]);
+	m_Chunks.push_back(std::move(chunk));
+	m_Used = size;
+	return m_Chunks.back().memory.get();
+}
+
+void RenderCommandArena::Reset()
+{
+	if (m_Chunks.size() > 1)
+	{
+		// Last frame didn't fit in one chunk; make one that would have
+		while (m_ChunkSize < m_Allocated)
+			m_ChunkSize *= 2;
+		m_Chunks.clear();
+	}
+	m_Used = 0;
+	m_Allocated = 0;
+}
+
+void RenderCommandList::Reset()
+{
+	m_Commands.clear();
+	m_Arena.Reset();
+}
+
+void RenderCommandList::UploadTexture(void* textureHandle, int width, int height, int rowPitch, const void* pixels)
+{
+	RenderCommand command = {};
+	command.type = kRenderCommand_UploadTexture;
+	command.resource = textureHandle;
+	command.data = pixels;
+	command.width = width;
+	command.height = height;
+	command.rowPitch = rowPitch;
+	m_Commands.push_back(command);
+}
+
+void RenderCommandList::UploadVertexBuffer(void* bufferHandle, size_t size, const void* data)
+{
+	RenderCommand command = {};
+	command.type = kRenderCommand_UploadVertexBuffer;
+	command.resource = bufferHandle;
+	command.data = data;
+	command.size = size;
+	m_Commands.push_back(command);
+}
+
+void RenderCommandList::DrawTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4)
+{
+	const size_t vertexBytes = static_cast<size_t>(triangleCount) * 3 * 16;
+	float* matrix = static_cast<float*>(m_Arena.Allocate(16 * sizeof(float)));
+	memcpy(matrix, worldMatrix, 16 * sizeof(float));
+	void* vertices = m_Arena.Allocate(vertexBytes);
+	memcpy(vertices, verticesFloat3Byte4, vertexBytes);
+
+	RenderCommand command = {};
+	command.type = kRenderCommand_DrawTriangles;
+	command.data = vertices;
+	command.size = vertexBytes;
+	command.triangleCount = triangleCount;
+	command.worldMatrix = matrix;
+	m_Commands.push_back(command);
+}
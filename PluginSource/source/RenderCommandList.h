@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+// Bump allocator for a frame's command payloads. Reset() rewinds it; once a frame needed
+// more than one chunk, the next Reset() replaces them with a single chunk that fits, so
+// steady-state frames allocate nothing.
+class RenderCommandArena
+{
+public:
+	explicit RenderCommandArena(size_t chunkSize = 64 * 1024);
+
+	void* Allocate(size_t size, size_t alignment = 16);
+	void Reset();
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<unsigned char[]> memory;
+		size_t size;
+	};
+
+	std::vector<Chunk> m_Chunks;
+	size_t m_ChunkSize;
+	size_t m_Used;      // in the last chunk
+	size_t m_Allocated; // across all chunks since the last Reset, for resizing
+};
+
+enum RenderCommandType
+{
+	kRenderCommand_UploadTexture,
+	kRenderCommand_UploadVertexBuffer,
+	kRenderCommand_DrawTriangles,
+};
+
+struct RenderCommand
+{
+	RenderCommandType type;
+	void* resource;       // texture / vertex buffer handle from Unity; NULL for draws
+	const void* data;     // pixels / vertices
+	size_t size;          // UploadVertexBuffer: bytes, must match the buffer's size
+	int width;            // UploadTexture
+	int height;
+	int rowPitch;
+	int triangleCount;    // DrawTriangles
+	const float* worldMatrix;
+};
+
+// One frame's worth of RenderAPI work, recorded up front and handed to
+// RenderAPI::ExecuteCommandList in one go. The backend then sees every operation at
+// once and can translate them in a single pass: one recording state query, one staging
+// buffer for all texture uploads, one flush, one pipeline bind for all draws.
+//
+// Commands are small fixed-size records; variable-size payloads that the caller does not
+// keep alive (draw vertices, matrices) are copied into the arena. Reset() keeps all memory.
+class RenderCommandList
+{
+public:
+	void Reset();
+
+	// pixels (rowPitch bytes apart) must stay valid until the list has been executed
+	void UploadTexture(void* textureHandle, int width, int height, int rowPitch, const void* pixels);
+	// Skipped by the backend when the buffer isn't `size` bytes (e.g. Mesh.GetNativeVertexBufferPtr
+	// returned a buffer with an unexpected layout). data must stay valid until executed.
+	void UploadVertexBuffer(void* bufferHandle, size_t size, const void* data);
+	// float3 position + byte4 color per vertex, copied
+	void DrawTriangles(const float worldMatrix[16], int triangleCount, const void* verticesFloat3Byte4);
+
+	const RenderCommand* begin() const { return m_Commands.data(); }
+	const RenderCommand* end() const { return m_Commands.data() + m_Commands.size(); }
+	bool IsEmpty() const { return m_Commands.empty(); }
+
+private:
+	std::vector<RenderCommand> m_Commands;
+	RenderCommandArena m_Arena;
+};
@@ -1,10 +1,23 @@
 // Example low level rendering Unity plugin
 
 #include "PlatformBase.h"
+#include "CommandRing.h"
+#include "GenerationPipeline.h"
+#include "ReadbackQueue.h"
+#include "RenderAPI.h"
+#include "RenderAPIDispatch.h"
+#include "RenderAPI_Vulkan.h"
+#include "RenderCommandList.h"
 #include "VulkanExternalImageHandler.h"
+#include "VulkanProfiler.h"
+#include "VulkanValidation.h"
+#include "WorkerPool.h"
 
 #include <assert.h>
+#include <atomic>
+#include <chrono>
 #include <d3d11_1.h>
+#include <future>
 #include <iostream>
 #include <vector>
 
@@ -17,8 +30,19 @@
 
 
 static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType);
+static void RegisterPluginEvents();
 static IUnityInterfaces* s_UnityInterfaces = NULL;
 static IUnityGraphics* s_Graphics = NULL;
+static WorkerPool* s_WorkerPool = NULL;
+static RenderAPI* s_CurrentAPI = NULL;
+static GenerationPipeline* s_GenerationPipeline = NULL;
+static CommandRing* s_CommandRing = NULL;
+static const uint32_t kCommandRingCapacity = 64 * 1024;
+static ReadbackQueue* s_Readbacks = NULL;
+static bool s_GenerateMipsOnUpload = false; // render thread; handed to every RenderAPI we create
+// Render thread. The script's upload arena, registered with every RenderAPI we create
+static void* s_UploadArena = NULL;
+static size_t s_UploadArenaSize = 0;
 
 /* Unity Native Plugin Lifecycle
  * --Plugin Load
@@ -28,22 +52,110 @@ static IUnityGraphics* s_Graphics = NULL;
  * --- GraphicsDeviceEvent(Initialize)
  * --Plugin Unload
  */
+// Vulkan bring-up (loading vulkan-1, instance, device selection and creation) runs on a
+// background task so it never sits on Unity's startup path. Everything that needs the
+// device checks s_VulkanReady first, which is a single atomic load.
+static std::chrono::steady_clock::time_point s_PluginLoadTime;
+static std::future<void> s_VulkanBringUp;
+static std::atomic<bool> s_VulkanReady(false);
+static std::atomic<float> s_VulkanTimeToReadyMs(-1.0f);
+
+// Where the Vulkan side is, for the script to wait on; mirrored in UseRenderingPlugin.cs
+enum VulkanBringUpState
+{
+	kVulkanBringUp_None = 0,    // no Vulkan needed for this renderer (or no device yet)
+	kVulkanBringUp_Pending = 1,
+	kVulkanBringUp_Ready = 2,
+	kVulkanBringUp_Failed = 3,  // stays failed until the device shuts down
+};
+static std::atomic<int> s_VulkanBringUpState(kVulkanBringUp_None);
+
+static void MarkVulkanReady()
+{
+	const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - s_PluginLoadTime;
+	s_VulkanTimeToReadyMs.store(elapsed.count(), std::memory_order_relaxed);
+	s_VulkanReady.store(true, std::memory_order_release);
+	s_VulkanBringUpState.store(kVulkanBringUp_Ready, std::memory_order_release);
+}
+
 extern "C" void	UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces * unityInterfaces)
 {
+	s_PluginLoadTime = std::chrono::steady_clock::now();
 	s_UnityInterfaces = unityInterfaces;
+
+	// Validation tier is fixed for the lifetime of the plugin
+	GetVulkanValidationTier();
+	IsVulkanProfilerRequested();
+	RegisterPluginEvents();
+
+	// Workers for texture generation; owned here rather than a static so they are joined
+	// in UnityPluginUnload, not under the loader lock
+	s_WorkerPool = new WorkerPool();
+	s_GenerationPipeline = new GenerationPipeline(s_WorkerPool);
+	s_CommandRing = new CommandRing(kCommandRingCapacity);
+	s_Readbacks = new ReadbackQueue();
 	s_Graphics = s_UnityInterfaces->Get<IUnityGraphics>();
 	s_Graphics->RegisterDeviceEventCallback(OnGraphicsDeviceEvent);
 
+#if SUPPORT_VULKAN
+	// No device yet: hook Unity's Vulkan instance/device creation so it gets the
+	// extensions we need and the plugin can share Unity's VkDevice
+	if (s_Graphics->GetRenderer() == kUnityGfxRendererNull)
+		RenderAPI_Vulkan_OnPluginLoad(unityInterfaces);
+#endif // SUPPORT_VULKAN
+
 	OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
 }
 
 // Plugin Unload
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload() {
 	s_Graphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+
+	delete s_CommandRing;
+	s_CommandRing = NULL;
+	delete s_Readbacks;
+	s_Readbacks = NULL;
+	// Waits for in-flight generation, which still needs the pool
+	delete s_GenerationPipeline;
+	s_GenerationPipeline = NULL;
+	if (s_CurrentAPI)
+		s_CurrentAPI->SetWorkerPool(NULL);
+	delete s_WorkerPool;
+	s_WorkerPool = NULL;
+	DestroyVulkanProfiler();
 }
 
 // GraphicsDeviceEvent
 
+// Event IDs C# passes to GL.IssuePluginEvent / CommandBuffer.IssuePluginEventAndData
+enum PluginEventID
+{
+	kPluginEvent_Frame = 2, // once per frame: the script's commands, texture and mesh update, readbacks
+	kPluginEvent_Flush = 3, // the script's commands only, then counts itself done once the GPU is idle (GetFlushCount)
+	kPluginEvent_Count
+};
+
+// Payload for IssuePluginEventAndData; mirrors PluginEventData in UseRenderingPlugin.cs.
+// The memory belongs to the script and must stay valid until the render thread ran the event.
+struct PluginEventData
+{
+	int size;                 // sizeof(PluginEventData) as the script sees it; shorter payloads are ignored
+	int hasVulkanConfig;      // nonzero: reconfigure this event ID on Unity's Vulkan device
+	UnityVulkanPluginEventConfig vulkanConfig;
+};
+
+typedef void (*PluginEventHandler)(const PluginEventData* data);
+
+// One entry per PluginEventID, indexed directly by the ID Unity hands back
+struct PluginEventEntry
+{
+	PluginEventHandler handler;
+	UnityVulkanPluginEventConfig vulkanConfig; // what ConfigureEvent last got for this ID
+	bool hasVulkanConfig;
+};
+
+static PluginEventEntry s_PluginEvents[kPluginEvent_Count];
+
 static ID3D11Device* s_d3d11Device = nullptr;
 static VulkanExternalImageHandler* s_VulkanExternalImageHandler = NULL;
 static UnityGfxRenderer s_DeviceType = kUnityGfxRendererNull;
@@ -53,90 +165,471 @@ static UnityGfxRenderer s_DeviceType = kUnityGfxRendererNull;
 // the s_DeviceType (API) is obtained here by calling s_Graphics->GetRenderer();
 static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType)
 {
+	// UnityPluginLoad runs before Unity created its device (always the case for Vulkan), so
+	// it got RenderAPI_Null; the device's own Initialize replaces that with the real backend
+	if (eventType == kUnityGfxDeviceEventInitialize && s_CurrentAPI && s_DeviceType == kUnityGfxRendererNull
+		&& s_Graphics->GetRenderer() != kUnityGfxRendererNull)
+	{
+		s_CurrentAPI->ProcessDeviceEvent(kUnityGfxDeviceEventShutdown, s_UnityInterfaces);
+		delete s_CurrentAPI;
+		s_CurrentAPI = NULL;
+	}
+
 	// Create graphics API implementation upon initialization
-	if (eventType == kUnityGfxDeviceEventInitialize)
+	// (UnityPluginLoad and Unity may both deliver Initialize; only act on the first)
+	if (eventType == kUnityGfxDeviceEventInitialize && s_VulkanExternalImageHandler == NULL && s_CurrentAPI == NULL)
 	{
 		s_DeviceType = s_Graphics->GetRenderer();
-		assert(s_DeviceType == kUnityGfxRendererD3D11);
 
-		// Store the D3D11 Device
-		if (IUnityGraphicsD3D11* d3d11Interface = s_UnityInterfaces->Get<IUnityGraphicsD3D11>()){
-			s_d3d11Device = d3d11Interface->GetDevice();
+		// Texture and mesh modification go through Unity's own device, whatever the Vulkan handler does
+		s_CurrentAPI = CreateRenderAPI(s_DeviceType);
+		if (s_CurrentAPI)
+		{
+			s_CurrentAPI->SetWorkerPool(s_WorkerPool);
+			s_CurrentAPI->SetGenerateMipsOnUpload(s_GenerateMipsOnUpload);
+			s_CurrentAPI->ProcessDeviceEvent(eventType, s_UnityInterfaces);
+			if (s_UploadArena)
+				s_CurrentAPI->RegisterHostMemory(s_UploadArena, s_UploadArenaSize);
 		}
 
-		s_VulkanExternalImageHandler = new VulkanExternalImageHandler(s_d3d11Device);
+		if (s_DeviceType == kUnityGfxRendererD3D11)
+		{
+			// Store the D3D11 Device
+			if (IUnityGraphicsD3D11* d3d11Interface = s_UnityInterfaces->Get<IUnityGraphicsD3D11>()){
+				s_d3d11Device = d3d11Interface->GetDevice();
+			}
+
+			// Cheap: only queries the DXGI adapter we have to match
+			s_VulkanExternalImageHandler = new VulkanExternalImageHandler(s_d3d11Device);
 
-		{ // Load Library and Create Vulkan Instance
-			VulkanExternalImageHandler::LoadVulkanSharedLibrary();
-			s_VulkanExternalImageHandler->CreateVulkanInstance();
-			// Vulkan Fn Pts and Device Creation in ProcessDeviceEvent(Init)
+			// Load Library, Create Vulkan Instance, Vulkan Fn Ptrs, Select Physical Device, Create Logical Device.
+			// Nothing else touches the handler until s_VulkanReady is set, which a failed step never does.
+			VulkanExternalImageHandler* handler = s_VulkanExternalImageHandler;
+			IUnityInterfaces* interfaces = s_UnityInterfaces;
+			s_VulkanBringUpState.store(kVulkanBringUp_Pending, std::memory_order_release);
+			s_VulkanBringUp = std::async(std::launch::async, [handler, interfaces]() {
+				if (!VulkanExternalImageHandler::LoadVulkanSharedLibrary()
+					|| !handler->CreateVulkanInstance()
+					|| !handler->CreateVulkanDevice())
+				{
+					std::cout << "RenderingPlugin: Vulkan bring-up failed, no external images" << std::endl;
+					handler->DestroyVulkanObjects();
+					s_VulkanBringUpState.store(kVulkanBringUp_Failed, std::memory_order_release);
+					return;
+				}
+				handler->ProcessDeviceEvent(kUnityGfxDeviceEventInitialize, interfaces);
+				MarkVulkanReady();
+			});
 		}
+		else if (s_DeviceType == kUnityGfxRendererVulkan)
+		{
+			// Unity renders with Vulkan itself: run on its device rather than a second one
+			s_VulkanExternalImageHandler = new VulkanExternalImageHandler(nullptr);
+			const bool usesUnityDevice = s_VulkanExternalImageHandler->UseUnityVulkanDevice(s_UnityInterfaces);
+			if (usesUnityDevice)
+				s_VulkanExternalImageHandler->ProcessDeviceEvent(eventType, s_UnityInterfaces);
+
+			// The frame event uploads the texture, so it runs outside Unity's render pass
+			if (IUnityGraphicsVulkan* unityVulkan = s_UnityInterfaces->Get<IUnityGraphicsVulkan>()) {
+				for (int eventID = 0; eventID < kPluginEvent_Count; ++eventID) {
+					if (s_PluginEvents[eventID].hasVulkanConfig)
+						unityVulkan->ConfigureEvent(eventID, &s_PluginEvents[eventID].vulkanConfig);
+				}
+			}
+			if (usesUnityDevice)
+				MarkVulkanReady();
+			else
+				s_VulkanBringUpState.store(kVulkanBringUp_Failed, std::memory_order_release);
+		}
+		return;
 	}
 
-	if (s_VulkanExternalImageHandler)	{
-		/* Load Vulkan Fn Ptrs that depend on VkInstance
-		 * Select Physical Device
-		 * Create Logical Device
-		 */
+	// Bring-up may still be running; it owns the handler until it finishes
+	if (eventType == kUnityGfxDeviceEventShutdown && s_VulkanBringUp.valid())
+		s_VulkanBringUp.wait();
+
+	if (s_VulkanExternalImageHandler && s_VulkanReady.load(std::memory_order_acquire))	{
 		s_VulkanExternalImageHandler->ProcessDeviceEvent(eventType, s_UnityInterfaces);
 	}
+	if (s_CurrentAPI)
+		s_CurrentAPI->ProcessDeviceEvent(eventType, s_UnityInterfaces);
 
 	// Cleanup graphics API implementation upon shutdown
 	if (eventType == kUnityGfxDeviceEventShutdown)
 	{
+		// The copies went with the device
+		s_Readbacks->FailInFlight();
 		s_DeviceType = kUnityGfxRendererNull;
+		s_VulkanReady.store(false, std::memory_order_release);
+		s_VulkanBringUpState.store(kVulkanBringUp_None, std::memory_order_release);
 		delete s_VulkanExternalImageHandler;
 		s_VulkanExternalImageHandler = NULL;
+		delete s_CurrentAPI;
+		s_CurrentAPI = NULL;
+	}
+}
+
+// --------------------------------------------------------------------------
+// SetTimeFromUnity, an example function we export which is called by one of the scripts.
+
+// Called on the main thread before the frame's render event is issued; kicks off
+// generation of the next frame's texture and mesh on the workers and returns.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTimeFromUnity (float t) { s_GenerationPipeline->OnTimeFromUnity(t); }
+
+
+// --------------------------------------------------------------------------
+// SetTextureFromUnity, an example function we export which is called by one of the scripts.
+
+static void* g_TextureHandle = NULL;
+static int   g_TextureWidth  = 0;
+static int   g_TextureHeight = 0;
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTextureFromUnity(void* textureHandle, int w, int h)
+{
+	// A script calls this at initialization time; just remember the texture pointer here.
+	// Will update texture pixels each frame from the plugin rendering event (texture update
+	// needs to happen on the rendering thread).
+	g_TextureHandle = textureHandle;
+	g_TextureWidth = w;
+	g_TextureHeight = h;
+	s_GenerationPipeline->SetTextureSize(textureHandle ? w : 0, h);
+}
+
+// --------------------------------------------------------------------------
+// SetMeshBuffersFromUnity, an example function we export which is called by one of the scripts.
+
+static void* g_VertexBufferHandle = NULL;
+static int g_VertexBufferVertexCount;
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetMeshBuffersFromUnity(void* vertexBufferHandle, int vertexCount, float* sourceVertices, float* sourceNormals, float* sourceUV)
+{
+	// A script calls this at initialization time; just remember the pointer here.
+	// Will update buffer data each frame from the plugin rendering event (buffer update
+	// needs to happen on the rendering thread).
+	g_VertexBufferHandle = vertexBufferHandle;
+	g_VertexBufferVertexCount = vertexCount;
+
+	// The script also passes original source mesh data. The reason is that the vertex buffer we'll be modifying
+	// will be marked as "dynamic", and on many platforms this means we can only write into it, but not read its previous
+	// contents. The arrays are only pinned for the duration of this call, so take a copy, laid out for the
+	// deformation kernels. Source normals aren't needed: the deformed surface gets analytic ones.
+	(void)sourceNormals;
+	s_GenerationPipeline->SetMeshSource(vertexCount, sourceVertices, sourceUV);
+}
+
+// --------------------------------------------------------------------------
+// Command ring: the same inputs as the three exports above, written by the script into
+// plugin-owned memory and run on the render thread at the start of the frame event.
+// A script uses either the ring or the exports, the generation pipeline expects one feeding thread.
+
+static void ExecutePluginCommand(const PluginCommandHeader* command)
+{
+	switch (command->type)
+	{
+	case kPluginCommand_SetTime:
+		if (command->size >= sizeof(PluginCommand_SetTime))
+			s_GenerationPipeline->OnTimeFromUnity(reinterpret_cast<const PluginCommand_SetTime*>(command)->time);
+		break;
+	case kPluginCommand_SetTexture:
+		if (command->size >= sizeof(PluginCommand_SetTexture))
+		{
+			const PluginCommand_SetTexture* setTexture = reinterpret_cast<const PluginCommand_SetTexture*>(command);
+			g_TextureHandle = reinterpret_cast<void*>(setTexture->textureHandle);
+			g_TextureWidth = setTexture->width;
+			g_TextureHeight = setTexture->height;
+			s_GenerationPipeline->SetTextureSize(g_TextureHandle ? g_TextureWidth : 0, g_TextureHeight);
+		}
+		break;
+	case kPluginCommand_SetMeshBuffers:
+		if (command->size >= sizeof(PluginCommand_SetMeshBuffers))
+		{
+			const PluginCommand_SetMeshBuffers* setMesh = reinterpret_cast<const PluginCommand_SetMeshBuffers*>(command);
+			g_VertexBufferHandle = reinterpret_cast<void*>(setMesh->vertexBufferHandle);
+			g_VertexBufferVertexCount = setMesh->vertexCount;
+			s_GenerationPipeline->SetMeshSource(setMesh->vertexCount,
+				reinterpret_cast<const float*>(setMesh->positions), reinterpret_cast<const float*>(setMesh->uvs));
+		}
+		break;
+	case kPluginCommand_DestroyExternalImage:
+		// Handles can only come from a ready handler
+		if (command->size >= sizeof(PluginCommand_DestroyExternalImage) && s_VulkanReady.load(std::memory_order_acquire))
+			s_VulkanExternalImageHandler->DestroyExternalImage(reinterpret_cast<const PluginCommand_DestroyExternalImage*>(command)->handle);
+		break;
+	case kPluginCommand_SetGenerateMips:
+		if (command->size >= sizeof(PluginCommand_SetGenerateMips))
+		{
+			s_GenerateMipsOnUpload = reinterpret_cast<const PluginCommand_SetGenerateMips*>(command)->enabled != 0;
+			if (s_CurrentAPI)
+				s_CurrentAPI->SetGenerateMipsOnUpload(s_GenerateMipsOnUpload);
+		}
+		break;
+	case kPluginCommand_SetUploadArena:
+		if (command->size >= sizeof(PluginCommand_SetUploadArena))
+		{
+			const PluginCommand_SetUploadArena* setArena = reinterpret_cast<const PluginCommand_SetUploadArena*>(command);
+			if (s_UploadArena && s_CurrentAPI)
+				s_CurrentAPI->UnregisterHostMemory(s_UploadArena);
+			s_UploadArena = reinterpret_cast<void*>(setArena->memory);
+			s_UploadArenaSize = s_UploadArena ? (size_t)setArena->size : 0;
+			// Backends that can't import it still upload from there, through their usual copies
+			if (s_UploadArena && s_CurrentAPI && !s_CurrentAPI->RegisterHostMemory(s_UploadArena, s_UploadArenaSize))
+				std::cout << "RenderingPlugin: upload arena not imported, uploads are staged" << std::endl;
+			s_GenerationPipeline->SetUploadArena(s_UploadArena, s_UploadArenaSize);
+		}
+		break;
+	default:
+		std::cout << "RenderingPlugin: unknown command type " << command->type << std::endl;
+		break;
+	}
+}
+
+// Called once by the script: the ring's shared memory and its size in bytes, to map as a
+// NativeArray<byte>. Layout in CommandRing.h. Valid until the plugin unloads.
+extern "C" void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetCommandRing(int* outSize)
+{
+	*outSize = static_cast<int>(s_CommandRing->GetSharedMemorySize());
+	return s_CommandRing->GetSharedMemory();
+}
+
+// Frames published by the Vulkan profiler, mapped like the command ring; layout in
+// VulkanProfiler.h. NULL and 0 unless RENDERINGPLUGIN_VK_PROFILER was set and Unity's Vulkan
+// device has been initialized, so the script asks again until it gets it.
+extern "C" void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetVulkanProfilerStats(int* outSize)
+{
+	size_t size = 0;
+	void* memory = GetVulkanProfilerSharedMemory(&size);
+	*outSize = static_cast<int>(size);
+	return memory;
+}
+
+// --------------------------------------------------------------------------
+// Asynchronous readback of a texture rectangle, see ReadbackQueue.h. Copies are recorded
+// by the next frame event and collected by a later one, so a request needs frame events to
+// make progress; the data usually arrives two or three frames later.
+
+// Main thread. Only 4 bytes per texel textures; 0 if the request can't be queued.
+extern "C" unsigned int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API RequestReadback(void* textureHandle, int x, int y, int width, int height)
+{
+	return s_Readbacks->Request(textureHandle, x, y, width, height);
+}
+
+// Main thread. A ReadbackStatus: 1 once the data (width * height * 4 bytes) is in dest,
+// 0 while pending, -1 if it failed. The id is released unless pending.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API TryGetReadback(unsigned int id, void* dest, int destSize)
+{
+	return s_Readbacks->TryGet(id, dest, destSize > 0 ? (size_t)destSize : 0);
+}
+
+// Render thread only; kept between frames for its memory
+static std::vector<ReadbackRequest> s_ReadbackRequests;
+
+// Collects what the GPU has finished, then records the new requests
+static void ProcessReadbacks()
+{
+	s_Readbacks->TakeRequests(&s_ReadbackRequests);
+	if (!s_CurrentAPI)
+	{
+		for (const ReadbackRequest& request : s_ReadbackRequests)
+			s_Readbacks->Fail(request.id);
+		return;
+	}
+
+	DispatchRenderAPI(s_CurrentAPI, [](auto* api) {
+		api->PollReadbacks(s_Readbacks);
+		for (const ReadbackRequest& request : s_ReadbackRequests)
+			if (!api->BeginReadback(request))
+				s_Readbacks->Fail(request.id);
+	});
+}
+
+// Render thread only. Rebuilt every frame event; its memory is kept between frames.
+static RenderCommandList s_FrameCommands;
+
+// The "plasma effect" texture and deformed mesh were generated ahead of time on the workers
+// (see GenerationPipeline.h), into the upload arena if the script set one, where the
+// backend picks them up without staging; all that's left is to record their uploads.
+static void RecordFrameUploads(const GeneratedFrame& frame)
+{
+	void* textureHandle = g_TextureHandle;
+	// Generated before a texture change reached the workers; the next frame will match
+	if (textureHandle && frame.textureWidth == g_TextureWidth && frame.textureHeight == g_TextureHeight)
+		s_FrameCommands.UploadTexture(textureHandle, frame.textureWidth, frame.textureHeight, frame.textureWidth * 4, frame.texture);
+
+	void* bufferHandle = g_VertexBufferHandle;
+	int vertexCount = g_VertexBufferVertexCount;
+	if (bufferHandle && vertexCount > 0 && frame.vertexCount == vertexCount)
+		s_FrameCommands.UploadVertexBuffer(bufferHandle, (size_t)frame.vertexCount * sizeof(MeshVertex), frame.vertices);
+}
+
+static void OnFrame(const PluginEventData* data)
+{
+	// Everything the script queued since the last frame event, in order
+	s_CommandRing->Drain(ExecutePluginCommand);
+
+	// Texture and vertex data go through Unity's device and don't wait for Vulkan.
+	// Never waits on the workers: no finished frame yet (or none newer than the last
+	// one copied) just leaves last frame's contents in place
+	if (s_CurrentAPI)
+	{
+		// Arena regions are rewritten only once the GPU has finished the frame that uploaded from them
+		unsigned long long currentGpuFrame = 0;
+		unsigned long long safeGpuFrame = 0;
+		s_CurrentAPI->GetGpuFrameNumbers(&currentGpuFrame, &safeGpuFrame);
+		s_GenerationPipeline->SetSafeGpuFrame(safeGpuFrame);
+		if (const GeneratedFrame* frame = s_GenerationPipeline->AcquireLatest())
+		{
+			s_FrameCommands.Reset();
+			RecordFrameUploads(*frame);
+			DispatchRenderAPI(s_CurrentAPI, [](auto* api) {
+				api->ExecuteCommandList(s_FrameCommands);
+			});
+			s_GenerationPipeline->Release(frame, currentGpuFrame);
+		}
+	}
+	// After the uploads, so a readback of the plugin's texture sees this frame's contents
+	ProcessReadbacks();
+}
+
+// Flush events run so far whose GPU work has finished; see GetFlushCount
+static std::atomic<unsigned int> s_FlushesCompleted(0);
+
+static void OnFlushCompleted(void*)
+{
+	s_FlushesCompleted.fetch_add(1, std::memory_order_release);
+}
+
+static void OnFlush(const PluginEventData* data)
+{
+	s_CommandRing->Drain(ExecutePluginCommand);
+	if (s_CurrentAPI)
+		s_CurrentAPI->CallWhenGpuIdle(OnFlushCompleted, NULL);
+	else
+		OnFlushCompleted(NULL);
+}
+
+static void RegisterPluginEvents()
+{
+	s_PluginEvents[kPluginEvent_Frame].handler = OnFrame;
+	s_PluginEvents[kPluginEvent_Frame].hasVulkanConfig = true;
+	s_PluginEvents[kPluginEvent_Frame].vulkanConfig.renderPassPrecondition = kUnityVulkanRenderPass_EnsureOutside;
+	s_PluginEvents[kPluginEvent_Frame].vulkanConfig.graphicsQueueAccess = kUnityVulkanGraphicsQueueAccess_DontCare;
+	s_PluginEvents[kPluginEvent_Frame].vulkanConfig.flags = kUnityVulkanEventConfigFlag_EnsurePreviousFrameSubmission;
+	s_PluginEvents[kPluginEvent_Flush] = s_PluginEvents[kPluginEvent_Frame];
+	s_PluginEvents[kPluginEvent_Flush].handler = OnFlush;
+}
+
+// Unity has already looked up this event's Vulkan config by the time the callback runs, so a
+// config carried in the payload takes effect from the next time the script issues this ID.
+// Only meaningful when Unity itself renders with Vulkan; our own device ignores it.
+static void ApplyPayloadVulkanConfig(int eventID, const PluginEventData* data)
+{
+	if (!data->hasVulkanConfig || s_DeviceType != kUnityGfxRendererVulkan)
+		return;
+
+	PluginEventEntry& entry = s_PluginEvents[eventID];
+	const UnityVulkanPluginEventConfig& config = data->vulkanConfig;
+	if (entry.hasVulkanConfig
+		&& entry.vulkanConfig.renderPassPrecondition == config.renderPassPrecondition
+		&& entry.vulkanConfig.graphicsQueueAccess == config.graphicsQueueAccess
+		&& entry.vulkanConfig.flags == config.flags)
+		return;
+
+	if (IUnityGraphicsVulkan* unityVulkan = s_UnityInterfaces->Get<IUnityGraphicsVulkan>()) {
+		unityVulkan->ConfigureEvent(eventID, &config);
+		entry.vulkanConfig = config;
+		entry.hasVulkanConfig = true;
 	}
 }
 
+/*
+ * OnRenderEventAndData - This will be called for CommandBuffer.IssuePluginEventAndData script calls;
+ * eventID will be the integer passed to IssuePluginEventAndData, data the pointer (may be NULL).
+ */
+static void UNITY_INTERFACE_API OnRenderEventAndData(int eventID, void* data)
+{
+	if (eventID < 0 || eventID >= kPluginEvent_Count || !s_PluginEvents[eventID].handler)
+		return;
+
+	const PluginEventData* payload = static_cast<const PluginEventData*>(data);
+	if (payload && payload->size < (int)sizeof(PluginEventData))
+		payload = NULL;
+	if (payload)
+		ApplyPayloadVulkanConfig(eventID, payload);
+
+	s_PluginEvents[eventID].handler(payload);
+}
+
 /*
  * OnRenderEvent - This will be called for GL.IssuePluginEvent script calls; eventID will
  * be the integer passed to IssuePluginEvent.
  */
 static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
 {
-	// Unknown / unsupported graphics device type? Do nothing
-	if (s_VulkanExternalImageHandler == NULL)
-		return;
-
-	// Use
-	if (eventID == 1) {
-		// Use Vulkan to draw to VkImage
-	}
+	OnRenderEventAndData(eventID, NULL);
 }
 
 // Return to Unity the Per-Frame Callback
 extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc() { return OnRenderEvent; }
 
+// Same events with a PluginEventData payload, for CommandBuffer.IssuePluginEventAndData
+extern "C" UnityRenderingEventAndData UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventAndDataFunc() { return OnRenderEventAndData; }
+
+// Whether the background Vulkan bring-up has finished; C# should wait for this before
+// asking for external images
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API IsVulkanReady() { return s_VulkanReady.load(std::memory_order_acquire); }
+
+// How many kPluginEvent_Flush events have run, each counted once everything the GPU had been
+// given before it has finished. Memory the script handed to the plugin (event payloads,
+// an unregistered upload arena) may be freed once this passes the flush issued after its last use.
+extern "C" unsigned int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetFlushCount() { return s_FlushesCompleted.load(std::memory_order_acquire); }
+
+// Milliseconds from UnityPluginLoad until Vulkan was ready, or -1 while still pending
+extern "C" float UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetVulkanTimeToReadyMs() { return s_VulkanTimeToReadyMs.load(std::memory_order_relaxed); }
+
+// A VulkanBringUpState. The script waits only while it is pending; None means the
+// renderer needs no Vulkan device of ours, Failed that IsVulkanReady will stay false.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetVulkanBringUpState() { return s_VulkanBringUpState.load(std::memory_order_acquire); }
+
 /*
- * Method called from Unity to obtain a shared handle that can be used to create a Texture2D via
- * https://docs.unity3d.com/ScriptReference/Texture2D.CreateExternalTexture.html
- * In DX11 the return value expected is a ID3D11Texture2D*
+ * Creates an image shared between Vulkan and D3D11 and returns its handle, or 0 on failure.
+ * The plugin owns it: destroy it with the DestroyExternalImage ring command, or it goes with
+ * the device. GetExternalImageNativePtr gives what
+ * https://docs.unity3d.com/ScriptReference/Texture2D.CreateExternalTexture.html takes.
  */
-extern "C" __declspec(dllexport) intptr_t CreateExternalVkImageForUnityTexture2D(int w, int h) {
+extern "C" unsigned int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateExternalImage(int w, int h) {
 #if defined(_WIN32)
-
-	// Unity expects ID3D11Texture2D* d3d11Texture to pass to Texture2D.CreateExternalTexture
-	// Docs: https://docs.unity3d.com/ScriptReference/Texture2D.CreateExternalTexture.html
-	ID3D11Texture2D* d3d11Texture = nullptr;
-
-	if(s_VulkanExternalImageHandler) {
+	if(s_VulkanReady.load(std::memory_order_acquire)) {
 
 		// Option:1 Vulkan creates External Image to share with DX11
 		// Currently does not work since DX11 is not able to open shared image
-		s_VulkanExternalImageHandler->DX11Handle_VulkanCreatedExternalImage(w, h, &d3d11Texture);
-		if (d3d11Texture != nullptr) {
-			return reinterpret_cast<intptr_t>(d3d11Texture);
-		} 
+		PluginHandle handle = s_VulkanExternalImageHandler->DX11Handle_VulkanCreatedExternalImage(w, h);
+		if (handle != kInvalidPluginHandle) {
+			return handle;
+		}
 
 		// Option2: DX11 creates External ID3D11Texture2D and shares with Vulkan
 		// DX11 is able to create texture;  Unity is unable to create a texture with it:
 		// https://issuetracker.unity3d.com/issues/warning-registering-a-native-texture-with-depth-equals-0-while-the-actual-texture-has-depth-equals-1-is-thrown-when-in-play-mode-and-creating-a-cubemap-from-another-cubemaps-native-texture-1
-		ID3D11ShaderResourceView* shaderResourceView;
-		s_VulkanExternalImageHandler->DX11Handle_VulkanShared_ExternalImage(w, h, &shaderResourceView);
-		return reinterpret_cast<intptr_t>(shaderResourceView);
+		return s_VulkanExternalImageHandler->DX11Handle_VulkanShared_ExternalImage(w, h);
 	}
 #endif
-	return reinterpret_cast<intptr_t>(nullptr);
+	return kInvalidPluginHandle;
+}
+
+// ID3D11Texture2D* (option 1) or ID3D11ShaderResourceView* (option 2) of an external image,
+// NULL for destroyed or unknown handles
+extern "C" intptr_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetExternalImageNativePtr(unsigned int handle) {
+	if (!s_VulkanReady.load(std::memory_order_acquire))
+		return reinterpret_cast<intptr_t>(nullptr);
+	return reinterpret_cast<intptr_t>(s_VulkanExternalImageHandler->GetExternalImageNativePtr(handle));
+}
+
+/*
+ * Method called from Unity to obtain a shared handle that can be used to create a Texture2D via
+ * https://docs.unity3d.com/ScriptReference/Texture2D.CreateExternalTexture.html
+ * In DX11 the return value expected is a ID3D11Texture2D*
+ * Kept for older scripts; the image lives until the device shuts down.
+ */
+extern "C" __declspec(dllexport) intptr_t CreateExternalVkImageForUnityTexture2D(int w, int h) {
+	return GetExternalImageNativePtr(CreateExternalImage(w, h));
 }
@@ -0,0 +1,114 @@
+#include "SimdMath.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static const char* kSimdEnvVar = "RENDERINGPLUGIN_SIMD";
+
+static SimdLevel DetectSimdLevel()
+{
+#if SIMD_NEON
+	// Baseline on every AArch64 CPU
+	return kSimdLevel_NEON;
+#elif SIMD_X86 && defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	const bool sse41 = (info[2] & (1 << 19)) != 0;
+	const bool fma = (info[2] & (1 << 12)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+
+	bool avx2 = false, avx512f = false, avx512bw = false;
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+		avx512f = (info[1] & (1 << 16)) != 0;
+		avx512bw = (info[1] & (1 << 30)) != 0;
+	}
+
+	// The OS has to save the wider registers too: XMM|YMM for AVX, plus opmask/ZMM state for AVX-512
+	const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	const bool osAvx = (xcr0 & 0x6) == 0x6;
+	const bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+
+	if (avx512f && avx512bw && avx2 && fma && osAvx512)
+		return kSimdLevel_AVX512;
+	if (avx && avx2 && fma && osAvx)
+		return kSimdLevel_AVX2;
+	if (sse41)
+		return kSimdLevel_SSE41;
+	return kSimdLevel_Scalar;
+#elif SIMD_X86
+	// Checks OS register state support as well
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return kSimdLevel_AVX512;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return kSimdLevel_AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return kSimdLevel_SSE41;
+	return kSimdLevel_Scalar;
+#else
+	return kSimdLevel_Scalar;
+#endif
+}
+
+static SimdLevel ReadSimdLevel()
+{
+	SimdLevel level = DetectSimdLevel();
+
+	char value[32] = {};
+#if defined(_MSC_VER)
+	char* envValue = NULL;
+	size_t envLength = 0;
+	if (_dupenv_s(&envValue, &envLength, kSimdEnvVar) == 0 && envValue)
+	{
+		strncpy_s(value, envValue, sizeof(value) - 1);
+		free(envValue);
+	}
+#else
+	if (const char* envValue = getenv(kSimdEnvVar))
+		strncpy(value, envValue, sizeof(value) - 1);
+#endif
+
+	// Only ever lowers the level; asking for more than the CPU has is ignored
+	SimdLevel cap = level;
+	if (strcmp(value, "scalar") == 0)
+		cap = kSimdLevel_Scalar;
+	else if (strcmp(value, "sse41") == 0)
+		cap = kSimdLevel_SSE41;
+	else if (strcmp(value, "avx2") == 0)
+		cap = kSimdLevel_AVX2;
+	if (level != kSimdLevel_NEON && cap < level)
+		level = cap;
+	else if (level == kSimdLevel_NEON && cap == kSimdLevel_Scalar)
+		level = kSimdLevel_Scalar;
+
+	return level;
+}
+
+SimdLevel GetSimdLevel()
+{
+	static const SimdLevel s_Level = ReadSimdLevel();
+	return s_Level;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case kSimdLevel_SSE41: return "SSE4.1";
+	case kSimdLevel_AVX2: return "AVX2";
+	case kSimdLevel_AVX512: return "AVX-512";
+	case kSimdLevel_NEON: return "NEON";
+	default: return "scalar";
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+// Small SIMD toolbox for the CPU-side generators (plasma texture, heightfield).
+//
+// Every ISA variant is compiled into the same binary and picked at runtime with
+// GetSimdLevel(), so the plugin still loads on CPUs without AVX. GCC/Clang need a
+// target attribute on each function using wider intrinsics than the TU is built
+// for; MSVC allows any intrinsic anywhere, so the SIMD_TARGET_* macros are empty there.
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define SIMD_X86 1
+	#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+	#define SIMD_NEON 1
+	#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+	#define SIMD_TARGET_SSE41
+	#define SIMD_TARGET_AVX2
+	#define SIMD_TARGET_AVX512
+#else
+	#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+	#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+	#define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,fma")))
+#endif
+
+enum SimdLevel
+{
+	kSimdLevel_Scalar = 0,
+	kSimdLevel_SSE41,
+	kSimdLevel_AVX2,    // AVX2 + FMA
+	kSimdLevel_AVX512,  // AVX-512 F + BW
+	kSimdLevel_NEON,
+};
+
+// Best level the CPU and OS support, detected once and cached. The
+// RENDERINGPLUGIN_SIMD environment variable (scalar, sse41, avx2, avx512) caps it,
+// which is how the variants get compared against each other.
+SimdLevel GetSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
+
+// sin(x) to ~4e-6 absolute for moderate |x|, the same way in every variant:
+// x = q*pi + r with r in [-pi/2, pi/2], sin(x) = (-1)^q * sin(r), and sin(r)
+// from its degree-9 odd Taylor polynomial. Two-part pi keeps r accurate.
+#define SIMD_SIN_INV_PI 0.318309886f
+#define SIMD_SIN_PI_HI  3.14159274f
+#define SIMD_SIN_PI_LO  -8.74227766e-8f
+#define SIMD_SIN_C3     -1.66666667e-1f
+#define SIMD_SIN_C5     8.33333333e-3f
+#define SIMD_SIN_C7     -1.98412698e-4f
+#define SIMD_SIN_C9     2.75573192e-6f
+
+inline float SinPoly(float x)
+{
+	const float q = floorf(x * SIMD_SIN_INV_PI + 0.5f);
+	const float r = (x - q * SIMD_SIN_PI_HI) - q * SIMD_SIN_PI_LO;
+	const float r2 = r * r;
+	const float s = r + r * r2 * (SIMD_SIN_C3 + r2 * (SIMD_SIN_C5 + r2 * (SIMD_SIN_C7 + r2 * SIMD_SIN_C9)));
+	return (static_cast<int>(q) & 1) ? -s : s;
+}
+
+#if SIMD_X86
+
+SIMD_TARGET_SSE41 inline __m128 SinPoly_SSE41(__m128 x)
+{
+	const __m128i qi = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(SIMD_SIN_INV_PI)));
+	const __m128 q = _mm_cvtepi32_ps(qi);
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(SIMD_SIN_PI_HI)));
+	r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(SIMD_SIN_PI_LO)));
+	const __m128 r2 = _mm_mul_ps(r, r);
+	__m128 p = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(SIMD_SIN_C9)), _mm_set1_ps(SIMD_SIN_C7));
+	p = _mm_add_ps(_mm_mul_ps(r2, p), _mm_set1_ps(SIMD_SIN_C5));
+	p = _mm_add_ps(_mm_mul_ps(r2, p), _mm_set1_ps(SIMD_SIN_C3));
+	p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r2, r), p), r);
+	// Odd q flips the sign bit
+	const __m128 sign = _mm_castsi128_ps(_mm_slli_epi32(qi, 31));
+	return _mm_xor_ps(p, sign);
+}
+
+SIMD_TARGET_AVX2 inline __m256 SinPoly_AVX2(__m256 x)
+{
+	const __m256i qi = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(SIMD_SIN_INV_PI)));
+	const __m256 q = _mm256_cvtepi32_ps(qi);
+	__m256 r = _mm256_fnmadd_ps(q, _mm256_set1_ps(SIMD_SIN_PI_HI), x);
+	r = _mm256_fnmadd_ps(q, _mm256_set1_ps(SIMD_SIN_PI_LO), r);
+	const __m256 r2 = _mm256_mul_ps(r, r);
+	__m256 p = _mm256_fmadd_ps(r2, _mm256_set1_ps(SIMD_SIN_C9), _mm256_set1_ps(SIMD_SIN_C7));
+	p = _mm256_fmadd_ps(r2, p, _mm256_set1_ps(SIMD_SIN_C5));
+	p = _mm256_fmadd_ps(r2, p, _mm256_set1_ps(SIMD_SIN_C3));
+	p = _mm256_fmadd_ps(_mm256_mul_ps(r2, r), p, r);
+	const __m256 sign = _mm256_castsi256_ps(_mm256_slli_epi32(qi, 31));
+	return _mm256_xor_ps(p, sign);
+}
+
+SIMD_TARGET_AVX512 inline __m512 SinPoly_AVX512(__m512 x)
+{
+	const __m512i qi = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(SIMD_SIN_INV_PI)));
+	const __m512 q = _mm512_cvtepi32_ps(qi);
+	__m512 r = _mm512_fnmadd_ps(q, _mm512_set1_ps(SIMD_SIN_PI_HI), x);
+	r = _mm512_fnmadd_ps(q, _mm512_set1_ps(SIMD_SIN_PI_LO), r);
+	const __m512 r2 = _mm512_mul_ps(r, r);
+	__m512 p = _mm512_fmadd_ps(r2, _mm512_set1_ps(SIMD_SIN_C9), _mm512_set1_ps(SIMD_SIN_C7));
+	p = _mm512_fmadd_ps(r2, p, _mm512_set1_ps(SIMD_SIN_C5));
+	p = _mm512_fmadd_ps(r2, p, _mm512_set1_ps(SIMD_SIN_C3));
+	p = _mm512_fmadd_ps(_mm512_mul_ps(r2, r), p, r);
+	const __m512i sign = _mm512_slli_epi32(qi, 31);
+	return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(p), sign));
+}
+
+#elif SIMD_NEON
+
+inline float32x4_t SinPoly_NEON(float32x4_t x)
+{
+	const int32x4_t qi = vcvtnq_s32_f32(vmulq_n_f32(x, SIMD_SIN_INV_PI));
+	const float32x4_t q = vcvtq_f32_s32(qi);
+	float32x4_t r = vmlsq_n_f32(x, q, SIMD_SIN_PI_HI);
+	r = vmlsq_n_f32(r, q, SIMD_SIN_PI_LO);
+	const float32x4_t r2 = vmulq_f32(r, r);
+	float32x4_t p = vmlaq_n_f32(vdupq_n_f32(SIMD_SIN_C7), r2, SIMD_SIN_C9);
+	p = vmlaq_f32(vdupq_n_f32(SIMD_SIN_C5), r2, p);
+	p = vmlaq_f32(vdupq_n_f32(SIMD_SIN_C3), r2, p);
+	p = vmlaq_f32(r, vmulq_f32(r2, r), p);
+	const uint32x4_t sign = vshlq_n_u32(vreinterpretq_u32_s32(qi), 31);
+	return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(p), sign));
+}
+
+#endif
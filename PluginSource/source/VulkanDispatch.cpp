@@ -0,0 +1,90 @@
+#include "VulkanDispatch.h"
+
+#if SUPPORT_VULKAN
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string.h>
+
+namespace
+{
+    struct SharedDispatch
+    {
+        std::unique_ptr<VulkanDispatch> dispatch;
+        int references;
+    };
+}
+
+static std::mutex s_DispatchMutex;
+static std::map<VkDevice, SharedDispatch> s_Dispatches;
+
+void LoadVulkanInstanceDispatch(VulkanDispatch* dispatch, PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance)
+{
+    memset(dispatch, 0, sizeof(*dispatch));
+    dispatch->vkGetInstanceProcAddr = getInstanceProcAddr;
+    dispatch->instance = instance;
+
+#define LOAD_INSTANCE_FUNC(fn) dispatch->fn = (PFN_##fn)getInstanceProcAddr(instance, #fn)
+    VULKAN_INSTANCE_FUNCTIONS(LOAD_INSTANCE_FUNC);
+#undef LOAD_INSTANCE_FUNC
+
+    // Vulkan 1.0 instances only have the KHR aliases
+    if (!dispatch->vkGetPhysicalDeviceProperties2)
+        dispatch->vkGetPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)getInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR");
+    if (!dispatch->vkGetPhysicalDeviceFeatures2)
+        dispatch->vkGetPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2)getInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+    if (!dispatch->vkGetPhysicalDeviceMemoryProperties2)
+        dispatch->vkGetPhysicalDeviceMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)getInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+    if (!dispatch->vkGetPhysicalDeviceImageFormatProperties2)
+        dispatch->vkGetPhysicalDeviceImageFormatProperties2 = (PFN_vkGetPhysicalDeviceImageFormatProperties2)getInstanceProcAddr(instance, "vkGetPhysicalDeviceImageFormatProperties2KHR");
+}
+
+const VulkanDispatch* AcquireVulkanDispatch(PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance, VkDevice device)
+{
+    if (!getInstanceProcAddr || device == VK_NULL_HANDLE)
+        return NULL;
+
+    std::lock_guard<std::mutex> lock(s_DispatchMutex);
+    SharedDispatch& shared = s_Dispatches[device];
+    if (!shared.dispatch)
+    {
+        std::unique_ptr<VulkanDispatch> dispatch(new VulkanDispatch());
+        LoadVulkanInstanceDispatch(dispatch.get(), getInstanceProcAddr, instance);
+        if (!dispatch->vkGetDeviceProcAddr)
+        {
+            s_Dispatches.erase(device);
+            return NULL;
+        }
+        dispatch->device = device;
+
+#define LOAD_DEVICE_FUNC(fn) dispatch->fn = (PFN_##fn)dispatch->vkGetDeviceProcAddr(device, #fn)
+        VULKAN_DEVICE_FUNCTIONS(LOAD_DEVICE_FUNC);
+        VULKAN_DEVICE_EXTENSION_FUNCTIONS(LOAD_DEVICE_FUNC);
+#undef LOAD_DEVICE_FUNC
+
+        // Core in 1.2 without the suffix
+        if (!dispatch->vkWaitSemaphoresKHR)
+            dispatch->vkWaitSemaphoresKHR = (PFN_vkWaitSemaphoresKHR)dispatch->vkGetDeviceProcAddr(device, "vkWaitSemaphores");
+        if (!dispatch->vkGetSemaphoreCounterValueKHR)
+            dispatch->vkGetSemaphoreCounterValueKHR = (PFN_vkGetSemaphoreCounterValueKHR)dispatch->vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue");
+
+        shared.dispatch = std::move(dispatch);
+        shared.references = 0;
+    }
+    ++shared.references;
+    return shared.dispatch.get();
+}
+
+void ReleaseVulkanDispatch(const VulkanDispatch* dispatch)
+{
+    if (!dispatch)
+        return;
+
+    std::lock_guard<std::mutex> lock(s_DispatchMutex);
+    std::map<VkDevice, SharedDispatch>::iterator it = s_Dispatches.find(dispatch->device);
+    if (it != s_Dispatches.end() && --it->second.references == 0)
+        s_Dispatches.erase(it);
+}
+
+#endif // #if SUPPORT_VULKAN
@@ -0,0 +1,135 @@
+#pragma once
+
+// Per-device Vulkan dispatch table shared by everything in the plugin that talks to Vulkan.
+//
+// Device-level entry points are resolved with vkGetDeviceProcAddr, so calls (vkCmd* in
+// particular) go straight into the driver instead of through the loader's trampoline,
+// which has to look the dispatch table up from the handle on every call. One table per
+// VkDevice: when RenderAPI_Vulkan and VulkanExternalImageHandler both run on Unity's
+// device they share it.
+
+#include "PlatformBase.h"
+
+#if SUPPORT_VULKAN
+
+// This plugin does not link to the Vulkan loader, easier to support multiple APIs and systems that don't have Vulkan support
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+#include "Unity/IUnityGraphicsVulkan.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <vulkan/vulkan_win32.h>
+#endif
+
+// Resolved with vkGetInstanceProcAddr: enough to pick a physical device and create a device
+#define VULKAN_INSTANCE_FUNCTIONS(apply) \
+    apply(vkGetDeviceProcAddr); \
+    apply(vkEnumeratePhysicalDevices); \
+    apply(vkGetPhysicalDeviceFeatures); \
+    apply(vkGetPhysicalDeviceFeatures2); \
+    apply(vkGetPhysicalDeviceProperties); \
+    apply(vkGetPhysicalDeviceProperties2); \
+    apply(vkGetPhysicalDeviceQueueFamilyProperties); \
+    apply(vkGetPhysicalDeviceMemoryProperties); \
+    apply(vkGetPhysicalDeviceFormatProperties); \
+    apply(vkGetPhysicalDeviceMemoryProperties2); \
+    apply(vkGetPhysicalDeviceImageFormatProperties2); \
+    apply(vkEnumerateDeviceExtensionProperties); \
+    apply(vkCreateDevice);
+
+// Core device-level entry points
+#define VULKAN_DEVICE_FUNCTIONS(apply) \
+    apply(vkGetDeviceQueue); \
+    apply(vkDeviceWaitIdle); \
+    apply(vkQueueWaitIdle); \
+    apply(vkQueueSubmit); \
+    apply(vkAllocateMemory); \
+    apply(vkFreeMemory); \
+    apply(vkMapMemory); \
+    apply(vkUnmapMemory); \
+    apply(vkFlushMappedMemoryRanges); \
+    apply(vkInvalidateMappedMemoryRanges); \
+    apply(vkCreateBuffer); \
+    apply(vkDestroyBuffer); \
+    apply(vkGetBufferMemoryRequirements); \
+    apply(vkBindBufferMemory); \
+    apply(vkCreateImage); \
+    apply(vkDestroyImage); \
+    apply(vkGetImageMemoryRequirements); \
+    apply(vkBindImageMemory); \
+    apply(vkCreateSemaphore); \
+    apply(vkDestroySemaphore); \
+    apply(vkCreateCommandPool); \
+    apply(vkDestroyCommandPool); \
+    apply(vkResetCommandPool); \
+    apply(vkAllocateCommandBuffers); \
+    apply(vkBeginCommandBuffer); \
+    apply(vkEndCommandBuffer); \
+    apply(vkCreateShaderModule); \
+    apply(vkDestroyShaderModule); \
+    apply(vkCreatePipelineLayout); \
+    apply(vkDestroyPipelineLayout); \
+    apply(vkCreateGraphicsPipelines); \
+    apply(vkDestroyPipeline); \
+    apply(vkCmdBeginRenderPass); \
+    apply(vkCmdBindPipeline); \
+    apply(vkCmdBindVertexBuffers); \
+    apply(vkCmdPushConstants); \
+    apply(vkCmdDraw); \
+    apply(vkCmdSetViewport); \
+    apply(vkCmdSetScissor); \
+    apply(vkCmdExecuteCommands); \
+    apply(vkCmdCopyBuffer); \
+    apply(vkCmdCopyBufferToImage); \
+    apply(vkCmdCopyImageToBuffer); \
+    apply(vkCmdBlitImage); \
+    apply(vkCmdPipelineBarrier);
+
+// Extension entry points; NULL when the device doesn't have the extension enabled, so check
+// the extension (or the pointer) before calling
+#if defined(_WIN32)
+#define VULKAN_PLATFORM_DEVICE_EXTENSION_FUNCTIONS(apply) \
+    apply(vkGetMemoryWin32HandleKHR);
+#else
+#define VULKAN_PLATFORM_DEVICE_EXTENSION_FUNCTIONS(apply)
+#endif
+#ifdef VK_EXT_host_image_copy
+#define VULKAN_HOST_IMAGE_COPY_FUNCTIONS(apply) \
+    apply(vkCopyMemoryToImageEXT); \
+    apply(vkTransitionImageLayoutEXT);
+#else
+#define VULKAN_HOST_IMAGE_COPY_FUNCTIONS(apply)
+#endif
+#define VULKAN_DEVICE_EXTENSION_FUNCTIONS(apply) \
+    apply(vkWaitSemaphoresKHR); \
+    apply(vkGetSemaphoreCounterValueKHR); \
+    apply(vkGetMemoryHostPointerPropertiesEXT); \
+    VULKAN_HOST_IMAGE_COPY_FUNCTIONS(apply) \
+    VULKAN_PLATFORM_DEVICE_EXTENSION_FUNCTIONS(apply)
+
+struct VulkanDispatch
+{
+    PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr;
+    VkInstance instance;
+    VkDevice device;
+
+#define VULKAN_DECLARE_DISPATCH_MEMBER(fn) PFN_##fn fn
+    VULKAN_INSTANCE_FUNCTIONS(VULKAN_DECLARE_DISPATCH_MEMBER)
+    VULKAN_DEVICE_FUNCTIONS(VULKAN_DECLARE_DISPATCH_MEMBER)
+    VULKAN_DEVICE_EXTENSION_FUNCTIONS(VULKAN_DECLARE_DISPATCH_MEMBER)
+#undef VULKAN_DECLARE_DISPATCH_MEMBER
+};
+
+// Instance-level part only (device members stay NULL), for code that still has to create
+// its device. Not shared; the caller owns dispatch.
+void LoadVulkanInstanceDispatch(VulkanDispatch* dispatch, PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance);
+
+// The table for device, loaded on first use. Reference counted: every Acquire needs a
+// Release, the last one frees it (call it before the device is destroyed). Any thread;
+// the returned table is immutable.
+const VulkanDispatch* AcquireVulkanDispatch(PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance, VkDevice device);
+void ReleaseVulkanDispatch(const VulkanDispatch* dispatch);
+
+#endif // #if SUPPORT_VULKAN
@@ -2,6 +2,10 @@
 #include <iostream>
 
 #include "VulkanExternalImageHandler.h"
+#include "RenderAPI_Vulkan.h"
+#include "VulkanDispatch.h"
+#include "VulkanMemoryPolicy.h"
+#include "VulkanValidation.h"
 
 #include <cstring>
 #include <map>
@@ -31,72 +35,28 @@
     } \
 }
 
-#define UNITY_USED_VULKAN_API_FUNCTIONS(apply) \
-    apply(vkEnumeratePhysicalDevices); \
-	apply(vkGetPhysicalDeviceFeatures); \
-	apply(vkGetPhysicalDeviceProperties); \
-    apply(vkGetPhysicalDeviceQueueFamilyProperties); \
-    apply(vkEnumerateDeviceExtensionProperties); \
-    apply(vkCreateDevice); \
-    apply(vkGetPhysicalDeviceImageFormatProperties2); \
-    apply(vkCreateImage); \
-    apply(vkGetImageMemoryRequirements); \
-	apply(vkAllocateMemory); \
-	apply(vkBindImageMemory); \
-    apply(vkGetMemoryWin32HandleKHR); \
-    apply(vkCmdBeginRenderPass); \
-    apply(vkCreateBuffer); \
-    apply(vkGetPhysicalDeviceMemoryProperties); \
-    apply(vkGetBufferMemoryRequirements); \
-    apply(vkMapMemory); \
-    apply(vkBindBufferMemory); \
-    apply(vkDestroyBuffer); \
-    apply(vkFreeMemory); \
-    apply(vkUnmapMemory); \
-    apply(vkQueueWaitIdle); \
-    apply(vkDeviceWaitIdle); \
-    apply(vkCmdCopyBufferToImage); \
-    apply(vkFlushMappedMemoryRanges); \
-    apply(vkCreatePipelineLayout); \
-    apply(vkCreateShaderModule); \
-    apply(vkDestroyShaderModule); \
-    apply(vkCreateGraphicsPipelines); \
-    apply(vkCmdBindPipeline); \
-    apply(vkCmdDraw); \
-    apply(vkCmdPushConstants); \
-    apply(vkCmdBindVertexBuffers); \
-    apply(vkDestroyPipeline); \
-    apply(vkDestroyPipelineLayout);
-
-#define VULKAN_DEFINE_API_FUNCPTR(func) static PFN_##func func
-VULKAN_DEFINE_API_FUNCPTR(vkGetInstanceProcAddr);
-UNITY_USED_VULKAN_API_FUNCTIONS(VULKAN_DEFINE_API_FUNCPTR);
-#undef VULKAN_DEFINE_API_FUNCPTR
-
-static void LoadVulkanAPI(PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance)
-{
-    if (!vkGetInstanceProcAddr && getInstanceProcAddr)
-        vkGetInstanceProcAddr = getInstanceProcAddr;
-
-#define LOAD_VULKAN_FUNC(fn) if (!fn) fn = (PFN_##fn)vkGetInstanceProcAddr(instance, #fn)
-    UNITY_USED_VULKAN_API_FUNCTIONS(LOAD_VULKAN_FUNC);
-#undef LOAD_VULKAN_FUNC
-}
+// The loader's entry point, from LoadVulkanSharedLibrary; everything past instance creation
+// goes through VulkanDispatch
+static PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = NULL;
 
 VulkanExternalImageHandler::VulkanExternalImageHandler(ID3D11Device* d3d11Device)
-	: m_vkInstance(VK_NULL_HANDLE), m_vkPhysicalDevice(VK_NULL_HANDLE), m_vkDevice(VK_NULL_HANDLE), m_DebugUtilsMessenger(VK_NULL_HANDLE)
+	: m_vkInstance(VK_NULL_HANDLE), m_vkPhysicalDevice(VK_NULL_HANDLE), m_vkDevice(VK_NULL_HANDLE)
+	, m_DebugUtilsMessenger(VK_NULL_HANDLE), m_SharesUnityDevice(false), m_Vk(nullptr)
 {
 	m_d3d11Device = d3d11Device;
 
+	// No D3D11 device when Unity renders with Vulkan; see UseUnityVulkanDevice
 	IDXGIDevice* dxgiDevice;
-	if (SUCCEEDED(d3d11Device->QueryInterface(IID_PPV_ARGS(&dxgiDevice))))
+	if (d3d11Device && SUCCEEDED(d3d11Device->QueryInterface(IID_PPV_ARGS(&dxgiDevice))))
 	{
 		IDXGIAdapter* dxgiAdapter;
 		if (SUCCEEDED(dxgiDevice->GetAdapter(&dxgiAdapter)))
 		{
 			DXGI_ADAPTER_DESC desc;
 			dxgiAdapter->GetDesc(&desc);
-			// Store the Device Id to ensure the Vulkan Physical Device matches with it
+			// Store the adapter LUID (and Device Id as fallback) to ensure the Vulkan Physical Device matches with it
+			m_unityAdapterLuid = desc.AdapterLuid;
+			m_hasUnityAdapterLuid = true;
 			m_unitySelectedDeviceId = static_cast<int>(desc.DeviceId);
 			dxgiAdapter->Release();
 		}
@@ -105,7 +65,7 @@ VulkanExternalImageHandler::VulkanExternalImageHandler(ID3D11Device* d3d11Device
 }
 
 //PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = nullptr;
-void VulkanExternalImageHandler::LoadVulkanSharedLibrary()
+bool VulkanExternalImageHandler::LoadVulkanSharedLibrary()
 {
 #if defined _WIN32
     HMODULE vulkan_library = LoadLibrary("vulkan-1.dll");
@@ -114,9 +74,17 @@ void VulkanExternalImageHandler::LoadVulkanSharedLibrary()
     }
     
 #elif defined __LINUX
-    vulkan_library = dlopen("libvulkan.so.1", RTLD_NOW);
-    vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)dlsym(vulkan_library, "vkGetInstanceProcAddr");
+    void* vulkan_library = dlopen("libvulkan.so.1", RTLD_NOW);
+    if (vulkan_library) {
+        vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)dlsym(vulkan_library, "vkGetInstanceProcAddr");
+    }
 #endif
+
+    if (!vkGetInstanceProcAddr) {
+        std::cout << "Could not load the Vulkan loader." << std::endl;
+        return false;
+    }
+    return true;
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL debug_utils_messenger_callback(
@@ -125,25 +93,26 @@ VKAPI_ATTR VkBool32 VKAPI_CALL debug_utils_messenger_callback(
     const VkDebugUtilsMessengerCallbackDataEXT* callback_data,
     void* user_data)
 {
-    if (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
-    {
-        printf("{%d} - {%s}: %s{}", callback_data->messageIdNumber, callback_data->pMessageIdName, callback_data->pMessage);
-    }
-    else if (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
-    {
-        printf("{%d} - {%s}: {%s}", callback_data->messageIdNumber, callback_data->pMessageIdName, callback_data->pMessage);
-    }
+    // Severity filtering already happened in the messenger's messageSeverity mask
+    const char* severity = (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) ? "error" : "warning";
+    fprintf(stderr, "Vulkan validation %s {%d} - {%s}: %s\n", severity, callback_data->messageIdNumber,
+        callback_data->pMessageIdName ? callback_data->pMessageIdName : "", callback_data->pMessage);
     return VK_FALSE;
 }
 
-void VulkanExternalImageHandler::CreateVulkanInstance()
+bool VulkanExternalImageHandler::CreateVulkanInstance()
 {
-    static bool debugUtils = true;
+    // Off unless asked for at load time; see VulkanValidation.h
+    VulkanValidationTier validationTier = GetVulkanValidationTier();
 
 	// We need these b/c Vulkan fn-ptrs are loaded after VkInstance creation
     PFN_vkEnumerateInstanceExtensionProperties vkEnumerateInstanceExtensionProperties = (PFN_vkEnumerateInstanceExtensionProperties)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceExtensionProperties");
     PFN_vkEnumerateInstanceLayerProperties vkEnumerateInstanceLayerProperties = (PFN_vkEnumerateInstanceLayerProperties)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceLayerProperties");
     PFN_vkCreateInstance vkCreateInstance = (PFN_vkCreateInstance)vkGetInstanceProcAddr(nullptr, "vkCreateInstance");
+    if (!vkEnumerateInstanceExtensionProperties || !vkEnumerateInstanceLayerProperties || !vkCreateInstance) {
+        std::cout << "Could not load the Vulkan instance creation functions." << std::endl;
+        return false;
+    }
     
     // Specify Instance Extensions needed for external memory
     std::vector<const char*> desiredInstanceExtensions = {
@@ -161,7 +130,7 @@ void VulkanExternalImageHandler::CreateVulkanInstance()
         instanceExtensions.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
 #endif
 
-        if (debugUtils) {
+        if (validationTier != kVulkanValidation_Off) {
             desiredInstanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         }
     }
@@ -185,38 +154,39 @@ void VulkanExternalImageHandler::CreateVulkanInstance()
 
             if (!existsInAvailableExtension) {
                 std::cout << "Desired extension does not exist in available extensions:" << extensionName << std::endl;
-                return;
+                return false;
             }
         }
     }
 
     std::vector<const char*> desiredInstanceLayers = {};
-    {   // Specify instance layers
-        if (debugUtils) {
-            const char* validationLayerName = "VK_LAYER_KHRONOS_validation";
-            desiredInstanceLayers.emplace_back(validationLayerName);
-        }
-    }
+    if (validationTier != kVulkanValidation_Off) {
+        const char* validationLayerName = "VK_LAYER_KHRONOS_validation";
 
-	{   // Ensure Desired Instance Layers are available
+        // Ensure the validation layer is available. Only looked up when validation was asked for,
+        // so the off tier never even enumerates layers.
 		uint32_t availableInstanceLayerCount = 0;
         std::vector<VkLayerProperties> availableInstanceLayers = {};
         vkEnumerateInstanceLayerProperties(&availableInstanceLayerCount, nullptr);
         availableInstanceLayers.resize(availableInstanceLayerCount);
         vkEnumerateInstanceLayerProperties(&availableInstanceLayerCount, availableInstanceLayers.data());
 
-        for (const auto&instanceLayer : desiredInstanceLayers)
-        {
-            bool available = std::any_of(availableInstanceLayers.begin(), availableInstanceLayers.end(), [instanceLayer](const VkLayerProperties& layerProperties){
-                return strcmp(instanceLayer, layerProperties.layerName) == 0;
-                });
+        bool available = std::any_of(availableInstanceLayers.begin(), availableInstanceLayers.end(), [validationLayerName](const VkLayerProperties& layerProperties){
+            return strcmp(validationLayerName, layerProperties.layerName) == 0;
+            });
 
-            if(!available){
-                std::cout << "Did not find instance layer" << std::endl;
-                return;
-            }
+        if (available) {
+            desiredInstanceLayers.emplace_back(validationLayerName);
         }
-	}
+        else {
+            // Missing SDK shouldn't cost the user their Vulkan interop; run without validation
+            std::cout << "Did not find instance layer " << validationLayerName << ", validation disabled" << std::endl;
+            validationTier = kVulkanValidation_Off;
+            desiredInstanceExtensions.erase(std::remove_if(desiredInstanceExtensions.begin(), desiredInstanceExtensions.end(), [](const char* extensionName) {
+                return strcmp(extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0;
+                }), desiredInstanceExtensions.end());
+        }
+    }
 
     {   // Create Vulkan Instance with desired instance layers and extensions
         VkApplicationInfo appInfo = {};
@@ -224,7 +194,8 @@ void VulkanExternalImageHandler::CreateVulkanInstance()
         appInfo.pApplicationName = "Unity Vulkan Plugin";
         appInfo.pEngineName = "";
         //TODO Maybe source this from vkEnumerateInstanceVersion 
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // 1.1 for vkGetPhysicalDeviceProperties2 / VkPhysicalDeviceIDProperties used in device selection
+        appInfo.apiVersion = VK_API_VERSION_1_1;
 
         VkInstanceCreateInfo instanceCreateInfo = {};
         instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -237,38 +208,58 @@ void VulkanExternalImageHandler::CreateVulkanInstance()
         instanceCreateInfo.ppEnabledExtensionNames = desiredInstanceExtensions.data();
 
         VkDebugUtilsMessengerCreateInfoEXT debug_utils_create_info = { VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT };
-        if (debugUtils) {
+        const VkValidationFeatureEnableEXT gpuAssistedFeatures[] = {
+            VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT,
+            VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_RESERVE_BINDING_SLOT_EXT
+        };
+        VkValidationFeaturesEXT validation_features = { VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT };
+        if (validationTier != kVulkanValidation_Off) {
             // Create Debug Messenger
             // From: https://docs.vulkan.org/samples/latest/samples/extensions/debug_utils/README.html
 
-            debug_utils_create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+            debug_utils_create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+            if (validationTier >= kVulkanValidation_Full)
+                debug_utils_create_info.messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
             debug_utils_create_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
             debug_utils_create_info.pfnUserCallback = debug_utils_messenger_callback;
 
             instanceCreateInfo.pNext = &debug_utils_create_info;
+
+            // VK_EXT_validation_features is implemented by the layer itself, no extension to enable
+            if (validationTier == kVulkanValidation_GpuAssisted) {
+                validation_features.enabledValidationFeatureCount = sizeof(gpuAssistedFeatures) / sizeof(*gpuAssistedFeatures);
+                validation_features.pEnabledValidationFeatures = gpuAssistedFeatures;
+                debug_utils_create_info.pNext = &validation_features;
+            }
         }
 
-        VK_CHECK_RESULT(vkCreateInstance(&instanceCreateInfo, nullptr, &m_vkInstance))
+        const VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vkInstance);
+        if (result != VK_SUCCESS) {
+            std::cout << "Could not create a Vulkan instance: VkResult " << result << std::endl;
+            m_vkInstance = VK_NULL_HANDLE;
+            return false;
+        }
 
-            if (debugUtils) {
+            if (validationTier != kVulkanValidation_Off) {
                 PFN_vkCreateDebugUtilsMessengerEXT vkCreateDebugUtilsMessengerEXT = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(m_vkInstance, "vkCreateDebugUtilsMessengerEXT");
                 VK_CHECK_RESULT(vkCreateDebugUtilsMessengerEXT(m_vkInstance, &debug_utils_create_info, nullptr, &m_DebugUtilsMessenger))
             }
     }
 
+    return true;
 }
 
 void VulkanExternalImageHandler::LoadVulkanFnPtrs()
 {
 }
 
-bool EnumerateAvailablePhysicalDevices(VkInstance instance,
+bool EnumerateAvailablePhysicalDevices(const VulkanDispatch& vk, VkInstance instance,
     std::vector<VkPhysicalDevice>& available_devices) {
 
     uint32_t devices_count = 0;
     VkResult result = VK_SUCCESS;
 
-    result = vkEnumeratePhysicalDevices(instance, &devices_count, nullptr);
+    result = vk.vkEnumeratePhysicalDevices(instance, &devices_count, nullptr);
     if ((result != VK_SUCCESS) ||
         (devices_count == 0)) {
         std::cout << "Could not get the number of available physical devices." << std::endl;
@@ -276,7 +267,7 @@ bool EnumerateAvailablePhysicalDevices(VkInstance instance,
     }
 
     available_devices.resize(devices_count);
-    result = vkEnumeratePhysicalDevices(instance, &devices_count, available_devices.data());
+    result = vk.vkEnumeratePhysicalDevices(instance, &devices_count, available_devices.data());
     if ((result != VK_SUCCESS) ||
         (devices_count == 0)) {
         std::cout << "Could not enumerate physical devices." << std::endl;
@@ -286,57 +277,67 @@ bool EnumerateAvailablePhysicalDevices(VkInstance instance,
     return true;
 }
 
-void VulkanExternalImageHandler::CreateVulkanDevice()
+// First graphics family, -1 if there is none; that is the universal one on every desktop driver
+static int SelectGraphicsQueueFamily(const std::vector<VkQueueFamilyProperties>& queueFamilyProperties)
+{
+    for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++) {
+        if (queueFamilyProperties[i].queueCount > 0 && (queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool VulkanExternalImageHandler::CreateVulkanDevice()
 {
-    VkPhysicalDevice selectedPhysicalDevice = {};
+    VkPhysicalDevice selectedPhysicalDevice = VK_NULL_HANDLE;
     int gfxQueueFamilyIndexOfSelectedDevice = -1;
 
+    // Instance-level functions only; the device's own table is acquired once it exists
+    VulkanDispatch vk;
+    LoadVulkanInstanceDispatch(&vk, vkGetInstanceProcAddr, m_vkInstance);
+
     std::vector<VkPhysicalDevice> available_devices = {};
-    EnumerateAvailablePhysicalDevices(m_vkInstance, available_devices);
+    if (!EnumerateAvailablePhysicalDevices(vk, m_vkInstance, available_devices))
+        return false;
 
     std::vector<const char *> desiredDeviceExtensions = {"VK_KHR_external_memory"};
 
 #if defined(_WIN32)
     desiredDeviceExtensions.emplace_back("VK_KHR_external_memory_win32");
+    desiredDeviceExtensions.emplace_back("VK_KHR_external_semaphore");
     desiredDeviceExtensions.emplace_back("VK_KHR_external_semaphore_win32");
+    desiredDeviceExtensions.emplace_back("VK_KHR_external_fence");
     desiredDeviceExtensions.emplace_back("VK_KHR_external_fence_win32");
 #endif
 
 
     for (auto& physicalDevice : available_devices) {
 
-        // Obtain device features and properties
-        VkPhysicalDeviceFeatures device_features;
-        VkPhysicalDeviceProperties device_properties;
-        vkGetPhysicalDeviceFeatures(physicalDevice, &device_features);
-        vkGetPhysicalDeviceProperties(physicalDevice, &device_properties);
+        // Obtain device properties, including the IDs other APIs know the adapter by
+        VkPhysicalDeviceIDProperties device_id_properties = {};
+        device_id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 device_properties = {};
+        device_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        device_properties.pNext = &device_id_properties;
+        vk.vkGetPhysicalDeviceProperties2(physicalDevice, &device_properties);
 
         uint32_t queueFamilyCount;
         std::vector<VkQueueFamilyProperties> queueFamilyProperties = {};
-        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        vk.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
         assert(queueFamilyCount > 0);
         queueFamilyProperties.resize(queueFamilyCount);
-        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
-
-        // Selecting queueFamilyIdx with Graphics Capability 
-        int queueFamilyIdxWithGraphicsCapability = -1;
-        // Iterate through all the queueFamilies (and check the the queueFlags of their QueueFamilyProperties)
-        for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++) {
-            if ((queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0)	{
-                // Found it!
-                queueFamilyIdxWithGraphicsCapability = i;
-            }
-        }
+        vk.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
 
-        if (queueFamilyIdxWithGraphicsCapability == -1) continue;
+        const int gfxQueueFamilyIndex = SelectGraphicsQueueFamily(queueFamilyProperties);
+        if (gfxQueueFamilyIndex == -1) continue;
 
         // Get list of supported extensions
         uint32_t extCount = 0;
         std::vector<std::string> supportedExtensions = {};
-        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extCount, nullptr);
+        vk.vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extCount, nullptr);
         if (extCount > 0) {
             std::vector<VkExtensionProperties> extensions(extCount);
-            if (vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extCount, &extensions.front()) == VK_SUCCESS)
+            if (vk.vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extCount, &extensions.front()) == VK_SUCCESS)
             {
                 for (auto& ext : extensions) {
                     supportedExtensions.emplace_back(ext.extensionName);
@@ -344,18 +345,27 @@ void VulkanExternalImageHandler::CreateVulkanDevice()
             }
         }
 
-        // Check available extensions against device extensions
+        // Check available extensions against device extensions; any missing one rules the device out
+        bool supportsAllExtensions = true;
         for (auto& extension : desiredDeviceExtensions) {
             if (std::find(supportedExtensions.begin(), supportedExtensions.end(), extension) == supportedExtensions.end()){
 				std::cout << "Extension named '" << extension << "' is not supported by a physical device." << std::endl;
-                continue;
+                supportsAllExtensions = false;
+                break;
             }
         }
-
-        // Should match 
-        if (m_unitySelectedDeviceId != -1) {
-            // This is the Device that Unity Selected
-            if (device_properties.deviceID != m_unitySelectedDeviceId) {
+        if (!supportsAllExtensions) continue;
+
+        // Should match the adapter Unity renders with. DXGI identifies it by LUID; deviceID alone
+        // can't tell two identical GPUs apart, so it is only a fallback for drivers without a valid LUID.
+        if (m_hasUnityAdapterLuid) {
+            bool matches = false;
+            if (device_id_properties.deviceLUIDValid)
+                matches = memcmp(device_id_properties.deviceLUID, &m_unityAdapterLuid, VK_LUID_SIZE) == 0;
+            else
+                matches = static_cast<int>(device_properties.properties.deviceID) == m_unitySelectedDeviceId;
+
+            if (!matches) {
                 std::cout << "Not the physical device selected by Unity will not be able to share external memory." << std::endl;
                 continue;
             }
@@ -364,10 +374,16 @@ void VulkanExternalImageHandler::CreateVulkanDevice()
 
         // Reaching here means passing all the VkPhysicalDevice checks so select this device
         selectedPhysicalDevice = physicalDevice;
-        gfxQueueFamilyIndexOfSelectedDevice = queueFamilyIdxWithGraphicsCapability;
+        gfxQueueFamilyIndexOfSelectedDevice = gfxQueueFamilyIndex;
+        memcpy(m_vkDeviceUUID, device_id_properties.deviceUUID, VK_UUID_SIZE);
         break;
     }
 
+    if (selectedPhysicalDevice == VK_NULL_HANDLE) {
+        std::cout << "No physical device matches Unity's adapter and supports external memory." << std::endl;
+        return false;
+    }
+
 		// Requested Queues
 		float defaultQueuePriority = 0.0f;
 		std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
@@ -394,32 +410,68 @@ void VulkanExternalImageHandler::CreateVulkanDevice()
         };
 
 
-        VkResult result = vkCreateDevice(selectedPhysicalDevice, &device_create_info, nullptr, &m_vkDevice);
+        VkResult result = vk.vkCreateDevice(selectedPhysicalDevice, &device_create_info, nullptr, &m_vkDevice);
 
         if ((result != VK_SUCCESS) ||
             (m_vkDevice == VK_NULL_HANDLE)) {
             std::cout << "Could not create logical device." << std::endl;
+            return false;
+        }
+
+        m_Vk = AcquireVulkanDispatch(vkGetInstanceProcAddr, m_vkInstance, m_vkDevice);
+        if (!m_Vk) {
+            std::cout << "Could not load the device functions." << std::endl;
+            return false;
         }
 
         m_vkPhysicalDevice = selectedPhysicalDevice;
+        return true;
 }
 
-uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+bool VulkanExternalImageHandler::UseUnityVulkanDevice(IUnityInterfaces* interfaces)
+{
+    IUnityGraphicsVulkan* unityVulkan = interfaces->Get<IUnityGraphicsVulkan>();
+    if (!unityVulkan)
+        return false;
 
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
+    const UnityVulkanInstance unityInstance = unityVulkan->Instance();
+    m_vkInstance = unityInstance.instance;
+    m_vkPhysicalDevice = unityInstance.physicalDevice;
+    m_vkDevice = unityInstance.device;
+    m_SharesUnityDevice = true;
+
+    // Unity's loader, not the one LoadVulkanSharedLibrary would open. Same table as RenderAPI_Vulkan's.
+    m_Vk = AcquireVulkanDispatch(unityInstance.getInstanceProcAddr, m_vkInstance, m_vkDevice);
+    if (!m_Vk) {
+        std::cout << "Could not load the device functions of Unity's VkDevice." << std::endl;
+        m_vkDevice = VK_NULL_HANDLE;
+        return false;
     }
 
+    const VulkanInjectedExtensions& extensions = RenderAPI_Vulkan_GetInjectedExtensions();
+    if (!extensions.externalMemory || !extensions.externalMemoryPlatform)
+        std::cout << "Unity's VkDevice was created without external memory extensions; was the plugin loaded before graphics initialization?" << std::endl;
+    return true;
+}
+
+uint32_t FindMemoryType(const VulkanDispatch& vk, uint32_t typeFilter, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vk.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    // Shared images live as long as their handle and are only touched by the GPU
+    const int index = SelectVulkanMemoryType(memProperties, nullptr, typeFilter, properties, kVulkanMemoryUsage_LongLived, 0);
+    if (index >= 0)
+        return static_cast<uint32_t>(index);
+
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
 
-void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned int width, unsigned int height, ID3D11Texture2D** texture2DHandle)
+PluginHandle VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned int width, unsigned int height)
 {
+    if (!m_d3d11Device || m_vkDevice == VK_NULL_HANDLE)
+        return kInvalidPluginHandle;
+
        // Check if Physical Device Supports the External Image Format Needed
 
         VkExternalImageFormatProperties externalImageFormatProperties = {};
@@ -453,7 +505,7 @@ void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned
             imageFormatProperties.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2;
             imageFormatProperties.pNext = &externalImageFormatProperties;
 
-            VK_CHECK_RESULT(vkGetPhysicalDeviceImageFormatProperties2(m_vkPhysicalDevice, &physicalDeviceImageFormatInfo, &imageFormatProperties))
+            VK_CHECK_RESULT(m_Vk->vkGetPhysicalDeviceImageFormatProperties2(m_vkPhysicalDevice, &physicalDeviceImageFormatInfo, &imageFormatProperties))
     
 
         /* Check the external image format meets our needs
@@ -468,7 +520,7 @@ void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned
 			(externalImageFormatProperties.externalMemoryProperties.externalMemoryFeatures & VK_EXTERNAL_MEMORY_FEATURE_DEDICATED_ONLY_BIT_KHR) == 0) {
 
             std::cout << "Request format not compatible " << std::endl;
-            return;
+            return kInvalidPluginHandle;
         }
     
         
@@ -508,14 +560,14 @@ void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned
         externalMemoryImageInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT_KHR;
         imageInfo.pNext = &externalMemoryImageInfo;
 
-        VK_CHECK_RESULT(vkCreateImage(m_vkDevice, &imageInfo, nullptr, &vkImage))
+        VK_CHECK_RESULT(m_Vk->vkCreateImage(m_vkDevice, &imageInfo, nullptr, &vkImage))
     }
 
     VkDeviceMemory imageMemory;
     {   // Allocate and bind Memory to VK Image
 
         VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(m_vkDevice, vkImage, &memRequirements);
+        m_Vk->vkGetImageMemoryRequirements(m_vkDevice, vkImage, &memRequirements);
 
         /* Docs:
          * 1. https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkMemoryAllocateInfo.html
@@ -528,7 +580,7 @@ void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned
         VkMemoryAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
         allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkPhysicalDevice);
+        allocInfo.memoryTypeIndex = FindMemoryType(*m_Vk, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkPhysicalDevice);
 
         /* Docs:
          * 1. https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkExportMemoryAllocateInfo.html
@@ -539,8 +591,8 @@ void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned
         exportAllocInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT_KHR ;
         allocInfo.pNext = &exportAllocInfo;
 
-        VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &allocInfo, nullptr, &imageMemory))
-        VK_CHECK_RESULT(vkBindImageMemory(m_vkDevice, vkImage, imageMemory, 0))
+        VK_CHECK_RESULT(m_Vk->vkAllocateMemory(m_vkDevice, &allocInfo, nullptr, &imageMemory))
+        VK_CHECK_RESULT(m_Vk->vkBindImageMemory(m_vkDevice, vkImage, imageMemory, 0))
     }
 
     HANDLE externalHandle = nullptr;
@@ -554,7 +606,7 @@ void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned
         // NB. The handle type (singular) takes VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D11_TEXTURE_BIT
         getWin32HandleInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT_KHR;
 
-        VK_CHECK_RESULT(vkGetMemoryWin32HandleKHR(m_vkDevice, &getWin32HandleInfo, &externalHandle))
+        VK_CHECK_RESULT(m_Vk->vkGetMemoryWin32HandleKHR(m_vkDevice, &getWin32HandleInfo, &externalHandle))
     }
     
 
@@ -567,23 +619,37 @@ void VulkanExternalImageHandler::DX11Handle_VulkanCreatedExternalImage(unsigned
      * as docs give explicit example of opening ID3D11Texture2D* from HANDLE.
      * Also https://learn.microsoft.com/en-us/windows/win32/api/d3d11/nf-d3d11-id3d11device-opensharedresource
      */
+    ExternalImage externalImage = {};
+    externalImage.image = vkImage;
+    externalImage.memory = imageMemory;
+    externalImage.sharedHandle = externalHandle;
+    externalImage.width = width;
+    externalImage.height = height;
+
     ID3D11Texture2D* texture2D;
     HRESULT hr = m_d3d11Device->OpenSharedResource(externalHandle, __uuidof(ID3D11Texture2D), (void**)(&texture2D));
     // Exception thrown at 0x00007FFE5163BA99 in Unity.exe: Microsoft C++ exception: _com_error at memory location 0x000000B0EA9DD610.
 	if (FAILED(hr)) {
         printf("Unable to open native handle from D3D11 device");
+        // Never used by the GPU, nothing to wait for
+        ReleaseExternalImage(externalImage);
+        m_Vk->vkDestroyImage(m_vkDevice, vkImage, nullptr);
+        m_Vk->vkFreeMemory(m_vkDevice, imageMemory, nullptr);
+        return kInvalidPluginHandle;
     }
-    else {
-        *texture2DHandle = texture2D;
-    }
-    
+
+    externalImage.texture = texture2D;
+    return RegisterExternalImage(externalImage);
 }
 
-void VulkanExternalImageHandler::DX11Handle_VulkanShared_ExternalImage(unsigned int width, unsigned int height, ID3D11ShaderResourceView** outShaderResourceView)
+PluginHandle VulkanExternalImageHandler::DX11Handle_VulkanShared_ExternalImage(unsigned int width, unsigned int height)
 {
+    if (!m_d3d11Device)
+        return kInvalidPluginHandle;
+
     ID3D11Texture2D* texture;
     ID3D11ShaderResourceView* shaderResourceView = nullptr;
-	HANDLE handle;
+	HANDLE handle = nullptr;
     
     /* Reference Example: https://developer.nvidia.com/getting-vulkan-ready-vr
      */
@@ -611,8 +677,15 @@ void VulkanExternalImageHandler::DX11Handle_VulkanShared_ExternalImage(unsigned
                 &handle))) {
                 printf("Successfully created shared handle");
             }
+            DxgiResource1->Release();
         }
 
+        ExternalImage externalImage = {};
+        externalImage.sharedHandle = handle;
+        externalImage.texture = texture;
+        externalImage.width = width;
+        externalImage.height = height;
+
         // Create a Shader Resource View
         D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
         srvDesc.Format = descColor.Format;
@@ -620,12 +693,108 @@ void VulkanExternalImageHandler::DX11Handle_VulkanShared_ExternalImage(unsigned
         srvDesc.Texture2D.MipLevels = 1;
         if (SUCCEEDED(m_d3d11Device->CreateShaderResourceView(texture, &srvDesc, &shaderResourceView))) {
             printf("Successfully created shared handle");
-            *outShaderResourceView = shaderResourceView;
+            externalImage.shaderResourceView = shaderResourceView;
+            return RegisterExternalImage(externalImage);
         }
+        ReleaseExternalImage(externalImage);
 
     } else {
         printf("Unable to create shared texture in DX11");
     }
+    return kInvalidPluginHandle;
+}
+
+PluginHandle VulkanExternalImageHandler::RegisterExternalImage(const ExternalImage& image)
+{
+    std::lock_guard<std::mutex> lock(m_ExternalImagesMutex);
+    const PluginHandle handle = m_ExternalImages.Insert(image);
+    if (handle == kInvalidPluginHandle)
+        std::cout << "Too many external images, dropping a " << image.width << "x" << image.height << " one" << std::endl;
+    return handle;
+}
+
+void* VulkanExternalImageHandler::GetExternalImageNativePtr(PluginHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_ExternalImagesMutex);
+    const ExternalImage* image = m_ExternalImages.Get(handle);
+    if (!image)
+        return nullptr;
+    if (image->shaderResourceView)
+        return image->shaderResourceView;
+    return image->texture;
+}
+
+// D3D11 references and the shared handle; the Vulkan objects are the caller's
+void VulkanExternalImageHandler::ReleaseExternalImage(const ExternalImage& image)
+{
+    if (image.shaderResourceView)
+        image.shaderResourceView->Release();
+    if (image.texture)
+        image.texture->Release();
+    if (image.sharedHandle)
+        CloseHandle(image.sharedHandle);
+}
+
+void VulkanExternalImageHandler::DestroyExternalImage(PluginHandle handle)
+{
+    ExternalImage image;
+    {
+        std::lock_guard<std::mutex> lock(m_ExternalImagesMutex);
+        if (!m_ExternalImages.Remove(handle, &image))
+            return;
+    }
+
+    // The plugin never submits work on this device, so nothing on its queues uses them;
+    // D3D11 keeps its own reference to the shared memory
+    ReleaseExternalImage(image);
+    if (image.image != VK_NULL_HANDLE)
+        m_Vk->vkDestroyImage(m_vkDevice, image.image, nullptr);
+    if (image.memory != VK_NULL_HANDLE)
+        m_Vk->vkFreeMemory(m_vkDevice, image.memory, nullptr);
+}
+
+void VulkanExternalImageHandler::DestroyAllExternalImages()
+{
+    std::vector<PluginHandle> handles;
+    {
+        std::lock_guard<std::mutex> lock(m_ExternalImagesMutex);
+        for (size_t i = 0; i < m_ExternalImages.Size(); ++i)
+            handles.push_back(m_ExternalImages.GetHandleAt(i));
+    }
+    for (PluginHandle handle : handles)
+        DestroyExternalImage(handle);
+}
+
+void VulkanExternalImageHandler::DestroyVulkanObjects()
+{
+    // Our own device may still be executing; Unity waits for its own before Shutdown
+    if (!m_SharesUnityDevice && m_Vk)
+        m_Vk->vkDeviceWaitIdle(m_vkDevice);
+    DestroyAllExternalImages();
+    ReleaseVulkanDispatch(m_Vk);
+    m_Vk = nullptr;
+
+    if (!m_SharesUnityDevice && m_vkInstance != VK_NULL_HANDLE)
+    {
+        if (m_vkDevice != VK_NULL_HANDLE)
+        {
+            PFN_vkDestroyDevice vkDestroyDevice = (PFN_vkDestroyDevice)vkGetInstanceProcAddr(m_vkInstance, "vkDestroyDevice");
+            vkDestroyDevice(m_vkDevice, nullptr);
+        }
+        if (m_DebugUtilsMessenger != VK_NULL_HANDLE)
+        {
+            PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(m_vkInstance, "vkDestroyDebugUtilsMessengerEXT");
+            vkDestroyDebugUtilsMessengerEXT(m_vkInstance, m_DebugUtilsMessenger, nullptr);
+        }
+        PFN_vkDestroyInstance vkDestroyInstance = (PFN_vkDestroyInstance)vkGetInstanceProcAddr(m_vkInstance, "vkDestroyInstance");
+        vkDestroyInstance(m_vkInstance, nullptr);
+    }
+
+    m_vkInstance = VK_NULL_HANDLE;
+    m_vkPhysicalDevice = VK_NULL_HANDLE;
+    m_vkDevice = VK_NULL_HANDLE;
+    m_DebugUtilsMessenger = VK_NULL_HANDLE;
+    m_SharesUnityDevice = false;
 }
 
 void VulkanExternalImageHandler::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces)
@@ -633,18 +802,14 @@ void VulkanExternalImageHandler::ProcessDeviceEvent(UnityGfxDeviceEventType type
     switch (type)
     {
     case kUnityGfxDeviceEventInitialize:
-        
-        // Make sure Vulkan API functions are loaded
-        LoadVulkanAPI(vkGetInstanceProcAddr, m_vkInstance);
 
-        // Create Device
-        CreateVulkanDevice();
+        // The device is Unity's (UseUnityVulkanDevice) or was made by CreateVulkanDevice;
+        // nothing else to create on it up front
 
         break;
     case kUnityGfxDeviceEventShutdown:
 
-        // vkDestroy all Vulkan objects created here
-        // set ivars to NULL and VK_NULL_HANDLE
+        DestroyVulkanObjects();
 
         break;
 case kUnityGfxDeviceEventBeforeReset:
@@ -654,5 +819,3 @@ case kUnityGfxDeviceEventAfterReset:
 default: ;
     }
 }
-
-
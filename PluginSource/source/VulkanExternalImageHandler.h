@@ -1,7 +1,9 @@
 #pragma once
 
 #include <map>
+#include <mutex>
 
+#include "HandleTable.h"
 #include "Unity/IUnityGraphics.h"
 #include <vector>
 
@@ -17,6 +19,21 @@
 //#include <vulkan/vulkan_android.h>
 #endif
 
+struct VulkanDispatch;
+
+// An image shared between Vulkan and D3D11, created for a script and owned by the handler.
+// Depending on which side created it, the Vulkan or the view members are null.
+struct ExternalImage
+{
+    VkImage image;
+    VkDeviceMemory memory;
+    HANDLE sharedHandle;
+    ID3D11Texture2D* texture;
+    ID3D11ShaderResourceView* shaderResourceView;
+    unsigned int width;
+    unsigned int height;
+};
+
 class VulkanExternalImageHandler {
 public:
 
@@ -24,31 +41,67 @@ public:
 	VulkanExternalImageHandler(ID3D11Device* d3d11Device);
 	~VulkanExternalImageHandler() = default;
 	
-	// Vulkan Device Creation
-    static void LoadVulkanSharedLibrary();
-    void CreateVulkanInstance();
+	// Vulkan Device Creation, in this order; each returns false (and logs why) if the
+	// step failed, and nothing after a failed step may be called
+    static bool LoadVulkanSharedLibrary();
+    bool CreateVulkanInstance();
     void LoadVulkanFnPtrs();
-    void CreateVulkanDevice();
+    bool CreateVulkanDevice();
+
+    // Use the instance/device Unity created (when Unity itself renders with Vulkan)
+    // instead of creating our own. The extensions the plugin needs were injected
+    // into Unity's vkCreateDevice, see RenderAPI_Vulkan.h. False if Unity's device can't be used.
+    bool UseUnityVulkanDevice(IUnityInterfaces* interfaces);
+
+    // External images are owned by the handler and handed out as generation-checked
+    // handles; kInvalidPluginHandle on failure. Any thread.
 
     // Create Vulkan Image and Export Shared Handle
-	void DX11Handle_VulkanCreatedExternalImage(unsigned int width, unsigned int height, ID3D11Texture2D** handle);
+	PluginHandle DX11Handle_VulkanCreatedExternalImage(unsigned int width, unsigned int height);
 
     // Create DX11 Image, Share with Vulkan
-    void DX11Handle_VulkanShared_ExternalImage(unsigned int width, unsigned int height, ID3D11ShaderResourceView** outShaderResourceView);
+    PluginHandle DX11Handle_VulkanShared_ExternalImage(unsigned int width, unsigned int height);
+
+    // What Texture2D.CreateExternalTexture takes for the image (ID3D11Texture2D* or
+    // ID3D11ShaderResourceView*), NULL for stale handles
+    void* GetExternalImageNativePtr(PluginHandle handle);
+
+    // Render thread. The Vulkan objects go right away; D3D11 holds its own reference.
+    void DestroyExternalImage(PluginHandle handle);
     
     void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces);
 
+    // Destroys the external images, then the device, debug messenger and instance the
+    // creation steps made (Unity's stay alone). Also after a failed step; Shutdown calls it.
+    void DestroyVulkanObjects();
+
 private:
+    PluginHandle RegisterExternalImage(const ExternalImage& image);
+    void ReleaseExternalImage(const ExternalImage& image);
+    void DestroyAllExternalImages();
+
     // DX11 Device Details
     int m_unitySelectedDeviceId = -1;
+    LUID m_unityAdapterLuid = {};
+    bool m_hasUnityAdapterLuid = false;
     ID3D11Device* m_d3d11Device = nullptr;
 
     // Vulkan Device Details
     VkInstance m_vkInstance;
     VkPhysicalDevice m_vkPhysicalDevice;
     VkDevice m_vkDevice;
+    uint8_t m_vkDeviceUUID[VK_UUID_SIZE] = {}; // how APIs other than D3D (GL memory objects, CUDA) identify the device
     VkDebugUtilsMessengerEXT m_DebugUtilsMessenger;
 
+    // True when the handles above belong to Unity and must not be destroyed by us
+    bool m_SharesUnityDevice;
+    // m_vkDevice's functions, shared with RenderAPI_Vulkan when that is Unity's device
+    const VulkanDispatch* m_Vk;
+
+    // Created on the main thread, destroyed on the render thread
+    std::mutex m_ExternalImagesMutex;
+    HandleTable<ExternalImage> m_ExternalImages;
+
 };
 
 // Create a graphics API implementation instance for the given API type.
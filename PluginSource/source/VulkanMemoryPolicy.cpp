@@ -0,0 +1,110 @@
+#include "VulkanMemoryPolicy.h"
+
+#if SUPPORT_VULKAN
+
+#include <string.h>
+
+// Types the plugin never wants: lazily allocated (transient attachments only), protected,
+// and AMD's device-coherent/uncached types, which are slow for everything but debugging.
+// The AMD bits are spelled out since older headers don't have them.
+static const VkMemoryPropertyFlags kExcludedMemoryFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT | VK_MEMORY_PROPERTY_PROTECTED_BIT
+    | 0x00000040 /* VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD */ | 0x00000080 /* VK_MEMORY_PROPERTY_DEVICE_UNCACHED_BIT_AMD */;
+
+// Higher is better. Only the ordering within one usage class matters.
+static int ScoreMemoryType(VkMemoryPropertyFlags flags, VulkanMemoryUsage usage)
+{
+    const bool deviceLocal = (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+    const bool hostVisible = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    const bool hostCoherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    const bool hostCached = (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+
+    int score = 0;
+    switch (usage)
+    {
+    case kVulkanMemoryUsage_Dynamic:
+        // Written once in order: write-combined BAR memory is as fast to fill as system
+        // memory, and the GPU then reads it locally
+        score += deviceLocal ? 8 : 0;
+        score += hostCoherent ? 2 : 0;
+        score -= hostCached ? 1 : 0;
+        break;
+    case kVulkanMemoryUsage_Staging:
+        // The copy engine reads system memory at full speed; leave the BAR to Dynamic.
+        // On unified memory every type is device local, so this doesn't rule anything out.
+        score -= deviceLocal ? 4 : 0;
+        score += hostCoherent ? 2 : 0;
+        score -= hostCached ? 1 : 0;
+        break;
+    case kVulkanMemoryUsage_Readback:
+        // Uncached reads (write-combined or over the BAR) are an order of magnitude slower
+        score += hostCached ? 8 : 0;
+        score -= deviceLocal && hostVisible ? 4 : 0;
+        score += hostCoherent ? 2 : 0;
+        break;
+    case kVulkanMemoryUsage_LongLived:
+        score += deviceLocal ? 8 : 0;
+        score -= hostVisible ? 1 : 0; // BAR space is better spent on Dynamic
+        break;
+    }
+    return score;
+}
+
+bool QueryVulkanMemoryBudget(const VulkanDispatch& vk, VkPhysicalDevice physicalDevice, bool memoryBudgetEnabled, VulkanMemoryBudget* budget)
+{
+    memset(budget, 0, sizeof(*budget));
+    if (!memoryBudgetEnabled || !vk.vkGetPhysicalDeviceMemoryProperties2)
+        return false;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budgetProperties;
+    vk.vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+
+    for (uint32_t heap = 0; heap < properties.memoryProperties.memoryHeapCount; ++heap)
+    {
+        budget->budget[heap] = budgetProperties.heapBudget[heap];
+        budget->usage[heap] = budgetProperties.heapUsage[heap];
+    }
+    budget->valid = true;
+    return true;
+}
+
+int SelectVulkanMemoryType(const VkPhysicalDeviceMemoryProperties& properties, const VulkanMemoryBudget* budget,
+    uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VulkanMemoryUsage usage, VkDeviceSize size)
+{
+    // Within budget first; if every allowed heap is over it, the allocation may still succeed
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const bool checkBudget = pass == 0 && budget && budget->valid;
+        if (pass == 1 && !(budget && budget->valid))
+            break;
+
+        int bestIndex = -1;
+        int bestScore = 0;
+        for (uint32_t index = 0; index < properties.memoryTypeCount; ++index)
+        {
+            const VkMemoryType& type = properties.memoryTypes[index];
+            if (!(memoryTypeBits & (1u << index)))
+                continue;
+            if ((type.propertyFlags & requiredFlags) != requiredFlags || (type.propertyFlags & kExcludedMemoryFlags))
+                continue;
+            if (checkBudget && budget->usage[type.heapIndex] + size > budget->budget[type.heapIndex])
+                continue;
+
+            // Ties go to the lower index: drivers list equivalent types fastest first
+            const int score = ScoreMemoryType(type.propertyFlags, usage);
+            if (bestIndex < 0 || score > bestScore)
+            {
+                bestIndex = static_cast<int>(index);
+                bestScore = score;
+            }
+        }
+        if (bestIndex >= 0)
+            return bestIndex;
+    }
+    return -1;
+}
+
+#endif // #if SUPPORT_VULKAN
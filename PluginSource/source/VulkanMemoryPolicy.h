@@ -0,0 +1,43 @@
+#pragma once
+
+// Picks the memory type for the plugin's own Vulkan allocations by what the memory is for.
+//
+// Taking the first HOST_VISIBLE type puts per-frame vertex data in system memory on most
+// discrete GPUs, read over PCIe by every draw. Instead each usage class ranks the allowed
+// types: data the GPU reads once per upload prefers DEVICE_LOCAL|HOST_VISIBLE (the BAR, or
+// all of VRAM with resizable BAR), data the CPU reads back prefers HOST_CACHED, and staging
+// stays out of the BAR so it is left for the data that benefits. With VK_EXT_memory_budget
+// types whose heap would go over budget are only used when nothing else is allowed.
+
+#include "PlatformBase.h"
+
+#if SUPPORT_VULKAN
+
+#include "VulkanDispatch.h"
+
+enum VulkanMemoryUsage
+{
+    kVulkanMemoryUsage_Dynamic = 0, // CPU writes it every frame, GPU reads it once (per-frame vertices)
+    kVulkanMemoryUsage_Staging,     // CPU writes it, one transfer reads it
+    kVulkanMemoryUsage_Readback,    // GPU writes it, CPU reads it
+    kVulkanMemoryUsage_LongLived,   // GPU reads it many times, CPU rarely or never touches it
+};
+
+// Per-heap budget and usage, in bytes
+struct VulkanMemoryBudget
+{
+    bool valid; // false without VK_EXT_memory_budget; the arrays are then unused
+    VkDeviceSize budget[VK_MAX_MEMORY_HEAPS];
+    VkDeviceSize usage[VK_MAX_MEMORY_HEAPS];
+};
+
+// Fills budget from VK_EXT_memory_budget; budget->valid is false (and the result too) when the
+// device doesn't have the extension enabled.
+bool QueryVulkanMemoryBudget(const VulkanDispatch& vk, VkPhysicalDevice physicalDevice, bool memoryBudgetEnabled, VulkanMemoryBudget* budget);
+
+// Best type in memoryTypeBits that has all of requiredFlags for an allocation of size bytes,
+// or -1. budget may be NULL.
+int SelectVulkanMemoryType(const VkPhysicalDeviceMemoryProperties& properties, const VulkanMemoryBudget* budget,
+    uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VulkanMemoryUsage usage, VkDeviceSize size);
+
+#endif // #if SUPPORT_VULKAN
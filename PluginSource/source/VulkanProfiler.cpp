@@ -0,0 +1,291 @@
+#include "VulkanProfiler.h"
+
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(offsetof(VulkanProfilerShared, publishedFrames) == 64, "layout is shared with UseRenderingPlugin.cs");
+static_assert(offsetof(VulkanProfilerShared, renderPassHistogram) == 128, "layout is shared with UseRenderingPlugin.cs");
+static_assert(offsetof(VulkanProfilerShared, barrierHistogram) == 192, "layout is shared with UseRenderingPlugin.cs");
+static_assert(offsetof(VulkanProfilerShared, frames) == 256, "layout is shared with UseRenderingPlugin.cs");
+static_assert(sizeof(VulkanProfilerFrame) == 64, "layout is shared with UseRenderingPlugin.cs");
+
+static const char* kProfilerEnvVar = "RENDERINGPLUGIN_VK_PROFILER";
+// About four seconds at 60 fps; the script reads far more often than that
+static const uint32_t kProfilerFrameCapacity = 256;
+static const size_t kSharedAlignment = 64;
+
+static bool ReadProfilerRequested()
+{
+    bool requested = false;
+#if defined(_MSC_VER)
+    char* envValue = NULL;
+    size_t envLength = 0;
+    if (_dupenv_s(&envValue, &envLength, kProfilerEnvVar) == 0 && envValue)
+    {
+        requested = atoi(envValue) != 0;
+        free(envValue);
+    }
+#else
+    if (const char* envValue = getenv(kProfilerEnvVar))
+        requested = atoi(envValue) != 0;
+#endif
+    return requested;
+}
+
+bool IsVulkanProfilerRequested()
+{
+    static const bool s_Requested = ReadProfilerRequested();
+    return s_Requested;
+}
+
+static VulkanProfilerShared* s_Shared = NULL;
+static size_t s_SharedSize = 0;
+// s_Shared once it is filled in; the script asks for it from the main thread
+static std::atomic<VulkanProfilerShared*> s_PublishedShared(NULL);
+
+void* GetVulkanProfilerSharedMemory(size_t* outSize)
+{
+    VulkanProfilerShared* shared = s_PublishedShared.load(std::memory_order_acquire);
+    *outSize = shared ? s_SharedSize : 0;
+    return shared;
+}
+
+void DestroyVulkanProfiler()
+{
+    if (!s_Shared)
+        return;
+    s_PublishedShared.store(NULL, std::memory_order_relaxed);
+    // frames[0] is a member of VulkanProfilerShared and goes with it; the rest were
+    // placement-constructed past its end in InstallVulkanProfiler.
+    for (uint32_t i = 1; i < s_Shared->capacity; ++i)
+        s_Shared->frames[i].~VulkanProfilerFrame();
+    s_Shared->~VulkanProfilerShared();
+    ::operator delete(s_Shared, std::align_val_t(kSharedAlignment));
+    s_Shared = NULL;
+    s_SharedSize = 0;
+}
+
+#if SUPPORT_VULKAN
+
+// What the current frame has seen so far. Recording may happen on any of Unity's threads
+// at once, so these are atomics; relaxed is enough, the present that reads them is ordered
+// after the submits that made the work visible anyway.
+struct ProfilerCounters
+{
+    alignas(64) std::atomic<uint32_t> submits;
+    std::atomic<uint32_t> submittedCommandBuffers;
+    std::atomic<uint64_t> submitCpuNs;
+    std::atomic<uint64_t> maxSubmitCpuNs;
+    // Command recording is far hotter than submission; keep it off the submit line
+    alignas(64) std::atomic<uint32_t> draws;
+    std::atomic<uint32_t> dispatches;
+    std::atomic<uint32_t> renderPasses;
+    std::atomic<uint32_t> renderPassEnds;
+    std::atomic<uint32_t> pipelineBarriers;
+    std::atomic<uint32_t> barriers;
+};
+static ProfilerCounters s_Counters;
+
+// Only one present publishes at a time (Unity presents from one thread, but the editor may
+// have several swapchains); a present that finds it taken leaves its counts to the next
+static std::atomic<bool> s_Publishing(false);
+static std::chrono::steady_clock::time_point s_LastPresent;
+static bool s_Installed = false;
+
+// What each wrapper forwards to: whatever Unity (or an earlier interception) had there
+static PFN_vkQueueSubmit s_NextQueueSubmit = NULL;
+static PFN_vkQueuePresentKHR s_NextQueuePresentKHR = NULL;
+static PFN_vkCmdDraw s_NextCmdDraw = NULL;
+static PFN_vkCmdDrawIndexed s_NextCmdDrawIndexed = NULL;
+static PFN_vkCmdDrawIndirect s_NextCmdDrawIndirect = NULL;
+static PFN_vkCmdDrawIndexedIndirect s_NextCmdDrawIndexedIndirect = NULL;
+static PFN_vkCmdDispatch s_NextCmdDispatch = NULL;
+static PFN_vkCmdDispatchIndirect s_NextCmdDispatchIndirect = NULL;
+static PFN_vkCmdPipelineBarrier s_NextCmdPipelineBarrier = NULL;
+static PFN_vkCmdBeginRenderPass s_NextCmdBeginRenderPass = NULL;
+static PFN_vkCmdEndRenderPass s_NextCmdEndRenderPass = NULL;
+
+static void CountOne(std::atomic<uint32_t>& counter)
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+static uint32_t HistogramBucket(uint32_t value)
+{
+    uint32_t bucket = 0;
+    while (value != 0 && bucket < kVulkanProfilerHistogramBuckets - 1)
+    {
+        value >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+static void PublishFrame()
+{
+    if (s_Publishing.exchange(true, std::memory_order_acquire))
+        return;
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const uint64_t cpuFrameNs = s_LastPresent.time_since_epoch().count() != 0
+        ? (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - s_LastPresent).count() : 0;
+    s_LastPresent = now;
+
+    const uint64_t frameNumber = s_Shared->publishedFrames.load(std::memory_order_relaxed) + 1;
+    VulkanProfilerFrame& slot = s_Shared->frames[(frameNumber - 1) & (s_Shared->capacity - 1)];
+
+    // Seqlock: invalidate, write, then publish the new number
+    slot.frame.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.cpuFrameNs = cpuFrameNs;
+    slot.submitCpuNs = s_Counters.submitCpuNs.exchange(0, std::memory_order_relaxed);
+    slot.maxSubmitCpuNs = s_Counters.maxSubmitCpuNs.exchange(0, std::memory_order_relaxed);
+    slot.submits = s_Counters.submits.exchange(0, std::memory_order_relaxed);
+    slot.submittedCommandBuffers = s_Counters.submittedCommandBuffers.exchange(0, std::memory_order_relaxed);
+    slot.draws = s_Counters.draws.exchange(0, std::memory_order_relaxed);
+    slot.dispatches = s_Counters.dispatches.exchange(0, std::memory_order_relaxed);
+    slot.renderPasses = s_Counters.renderPasses.exchange(0, std::memory_order_relaxed);
+    slot.renderPassEnds = s_Counters.renderPassEnds.exchange(0, std::memory_order_relaxed);
+    slot.pipelineBarriers = s_Counters.pipelineBarriers.exchange(0, std::memory_order_relaxed);
+    slot.barriers = s_Counters.barriers.exchange(0, std::memory_order_relaxed);
+    slot.frame.store(frameNumber, std::memory_order_release);
+
+    s_Shared->renderPassHistogram[HistogramBucket(slot.renderPasses)].fetch_add(1, std::memory_order_relaxed);
+    s_Shared->barrierHistogram[HistogramBucket(slot.barriers)].fetch_add(1, std::memory_order_relaxed);
+    s_Shared->publishedFrames.store(frameNumber, std::memory_order_release);
+
+    s_Publishing.store(false, std::memory_order_release);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL Hook_vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence)
+{
+    uint32_t commandBuffers = 0;
+    for (uint32_t i = 0; i < submitCount; ++i)
+        commandBuffers += pSubmits[i].commandBufferCount;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const VkResult result = s_NextQueueSubmit(queue, submitCount, pSubmits, fence);
+    const uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    CountOne(s_Counters.submits);
+    s_Counters.submittedCommandBuffers.fetch_add(commandBuffers, std::memory_order_relaxed);
+    s_Counters.submitCpuNs.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t longest = s_Counters.maxSubmitCpuNs.load(std::memory_order_relaxed);
+    while (ns > longest && !s_Counters.maxSubmitCpuNs.compare_exchange_weak(longest, ns, std::memory_order_relaxed))
+        ;
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL Hook_vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* pPresentInfo)
+{
+    PublishFrame();
+    return s_NextQueuePresentKHR(queue, pPresentInfo);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdDraw(VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+    CountOne(s_Counters.draws);
+    s_NextCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdDrawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+    CountOne(s_Counters.draws);
+    s_NextCmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdDrawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
+{
+    CountOne(s_Counters.draws);
+    s_NextCmdDrawIndirect(commandBuffer, buffer, offset, drawCount, stride);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdDrawIndexedIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
+{
+    CountOne(s_Counters.draws);
+    s_NextCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdDispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+    CountOne(s_Counters.dispatches);
+    s_NextCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdDispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset)
+{
+    CountOne(s_Counters.dispatches);
+    s_NextCmdDispatchIndirect(commandBuffer, buffer, offset);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+    VkDependencyFlags dependencyFlags, uint32_t memoryBarrierCount, const VkMemoryBarrier* pMemoryBarriers,
+    uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier* pBufferMemoryBarriers,
+    uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers)
+{
+    CountOne(s_Counters.pipelineBarriers);
+    s_Counters.barriers.fetch_add(memoryBarrierCount + bufferMemoryBarrierCount + imageMemoryBarrierCount, std::memory_order_relaxed);
+    s_NextCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, dependencyFlags, memoryBarrierCount, pMemoryBarriers,
+        bufferMemoryBarrierCount, pBufferMemoryBarriers, imageMemoryBarrierCount, pImageMemoryBarriers);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdBeginRenderPass(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, VkSubpassContents contents)
+{
+    CountOne(s_Counters.renderPasses);
+    s_NextCmdBeginRenderPass(commandBuffer, pRenderPassBegin, contents);
+}
+
+static VKAPI_ATTR void VKAPI_CALL Hook_vkCmdEndRenderPass(VkCommandBuffer commandBuffer)
+{
+    CountOne(s_Counters.renderPassEnds);
+    s_NextCmdEndRenderPass(commandBuffer);
+}
+
+// Points next at what name resolved to before, then routes name to hook
+template<typename PFN>
+static bool Intercept(IUnityGraphicsVulkan* unityVulkan, const VulkanDispatch& vk, const char* name, PFN hook, PFN* next)
+{
+    *next = (PFN)vk.vkGetDeviceProcAddr(vk.device, name);
+    if (!*next)
+        return false;
+    if (PFN_vkVoidFunction previous = unityVulkan->InterceptVulkanAPI(name, (PFN_vkVoidFunction)hook))
+        *next = (PFN)previous;
+    return true;
+}
+
+bool InstallVulkanProfiler(IUnityGraphicsVulkan* unityVulkan, const VulkanDispatch& vk)
+{
+    // A second Initialize would get our own wrappers back as "previous" and recurse
+    if (s_Installed)
+        return true;
+
+    // Power of two, so a frame number maps to a slot with a mask
+    s_SharedSize = offsetof(VulkanProfilerShared, frames) + sizeof(VulkanProfilerFrame) * kProfilerFrameCapacity;
+    void* memory = ::operator new(s_SharedSize, std::align_val_t(kSharedAlignment));
+    memset(memory, 0, s_SharedSize);
+    s_Shared = new (memory) VulkanProfilerShared;
+    for (uint32_t i = 1; i < kProfilerFrameCapacity; ++i)
+        new (&s_Shared->frames[i]) VulkanProfilerFrame();
+    s_Shared->capacity = kProfilerFrameCapacity;
+    s_Shared->frameSize = sizeof(VulkanProfilerFrame);
+
+    Intercept(unityVulkan, vk, "vkQueueSubmit", Hook_vkQueueSubmit, &s_NextQueueSubmit);
+    Intercept(unityVulkan, vk, "vkQueuePresentKHR", Hook_vkQueuePresentKHR, &s_NextQueuePresentKHR);
+    Intercept(unityVulkan, vk, "vkCmdDraw", Hook_vkCmdDraw, &s_NextCmdDraw);
+    Intercept(unityVulkan, vk, "vkCmdDrawIndexed", Hook_vkCmdDrawIndexed, &s_NextCmdDrawIndexed);
+    Intercept(unityVulkan, vk, "vkCmdDrawIndirect", Hook_vkCmdDrawIndirect, &s_NextCmdDrawIndirect);
+    Intercept(unityVulkan, vk, "vkCmdDrawIndexedIndirect", Hook_vkCmdDrawIndexedIndirect, &s_NextCmdDrawIndexedIndirect);
+    Intercept(unityVulkan, vk, "vkCmdDispatch", Hook_vkCmdDispatch, &s_NextCmdDispatch);
+    Intercept(unityVulkan, vk, "vkCmdDispatchIndirect", Hook_vkCmdDispatchIndirect, &s_NextCmdDispatchIndirect);
+    Intercept(unityVulkan, vk, "vkCmdPipelineBarrier", Hook_vkCmdPipelineBarrier, &s_NextCmdPipelineBarrier);
+    Intercept(unityVulkan, vk, "vkCmdBeginRenderPass", Hook_vkCmdBeginRenderPass, &s_NextCmdBeginRenderPass);
+    Intercept(unityVulkan, vk, "vkCmdEndRenderPass", Hook_vkCmdEndRenderPass, &s_NextCmdEndRenderPass);
+
+    s_Installed = true;
+    s_PublishedShared.store(s_Shared, std::memory_order_release);
+    return true;
+}
+
+#endif // #if SUPPORT_VULKAN
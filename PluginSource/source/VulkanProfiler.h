@@ -0,0 +1,77 @@
+#pragma once
+
+// Optional profiler for Unity's own Vulkan frame.
+//
+// When RENDERINGPLUGIN_VK_PROFILER=1 is set at plugin load, RenderAPI_Vulkan wraps
+// vkQueueSubmit, vkQueuePresentKHR, the vkCmdDraw* / vkCmdDispatch* calls,
+// vkCmdPipelineBarrier and vkCmdBegin/EndRenderPass through
+// IUnityGraphicsVulkan::InterceptVulkanAPI. The wrappers only bump counters (any thread
+// Unity records on) and time each submit; every present closes a frame and publishes
+// its totals into a ring shared with the script. Off by default, so nothing is
+// intercepted unless asked for.
+
+#include "PlatformBase.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+static const uint32_t kVulkanProfilerHistogramBuckets = 16;
+
+// One present-to-present frame; mirrored in UseRenderingPlugin.cs
+struct VulkanProfilerFrame
+{
+    // 1-based frame number, stored last. 0 while the slot is being rewritten: read it
+    // before and after copying the slot and discard the copy if they differ.
+    std::atomic<uint64_t> frame;
+    uint64_t cpuFrameNs;        // since the previous present
+    uint64_t submitCpuNs;       // inside vkQueueSubmit, summed
+    uint64_t maxSubmitCpuNs;    // longest single vkQueueSubmit
+    uint32_t submits;
+    uint32_t submittedCommandBuffers;
+    uint32_t draws;             // vkCmdDraw, DrawIndexed, DrawIndirect, DrawIndexedIndirect calls
+    uint32_t dispatches;        // vkCmdDispatch, DispatchIndirect calls
+    uint32_t renderPasses;      // vkCmdBeginRenderPass calls
+    uint32_t renderPassEnds;    // vkCmdEndRenderPass calls
+    uint32_t pipelineBarriers;  // vkCmdPipelineBarrier calls
+    uint32_t barriers;          // memory, buffer and image barriers in those calls
+};
+
+// Layout of the memory shared with the script, which maps it as a NativeArray<byte>:
+//   [0, 4)       capacity: frames in the ring, a power of two
+//   [4, 8)       sizeof(VulkanProfilerFrame), for the script to check its mirror against
+//   [64, 72)     frames published so far; the newest is at (published - 1) & (capacity - 1)
+//   [128, 192)   render passes per frame histogram, uint32 counts of frames
+//   [192, 256)   barriers per frame histogram
+//   [256, ...)   frames
+// Histogram bucket 0 counts frames with none, bucket i > 0 frames with [2^(i-1), 2^i),
+// the last bucket everything above.
+struct VulkanProfilerShared
+{
+    uint32_t capacity;
+    uint32_t frameSize;
+    alignas(64) std::atomic<uint64_t> publishedFrames;
+    alignas(64) std::atomic<uint32_t> renderPassHistogram[kVulkanProfilerHistogramBuckets];
+    std::atomic<uint32_t> barrierHistogram[kVulkanProfilerHistogramBuckets];
+    alignas(64) VulkanProfilerFrame frames[1];
+};
+
+// RENDERINGPLUGIN_VK_PROFILER, read on first call and cached; call it from UnityPluginLoad
+bool IsVulkanProfilerRequested();
+
+// Shared memory and its size in bytes, or NULL before the profiler was installed. Valid until
+// DestroyVulkanProfiler.
+void* GetVulkanProfilerSharedMemory(size_t* outSize);
+
+// UnityPluginUnload; Unity's device (and with it our wrappers) is gone by then
+void DestroyVulkanProfiler();
+
+#if SUPPORT_VULKAN
+
+#include "VulkanDispatch.h"
+
+// From the Initialize device event, after the plugin's other interceptions so the wrappers
+// see what they forward to. Once per process; later calls do nothing.
+bool InstallVulkanProfiler(IUnityGraphicsVulkan* unityVulkan, const VulkanDispatch& vk);
+
+#endif // #if SUPPORT_VULKAN
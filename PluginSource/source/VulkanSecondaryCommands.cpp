@@ -0,0 +1,111 @@
+#include "VulkanSecondaryCommands.h"
+
+#if SUPPORT_VULKAN
+
+struct VulkanSecondaryCommandPools::FrameSet
+{
+    struct Slot
+    {
+        VkCommandPool pool;
+        std::vector<VkCommandBuffer> buffers; // everything ever allocated from pool
+        size_t used;                          // handed out since the last reset
+    };
+
+    unsigned long long frameNumber;
+    std::vector<Slot> slots;
+};
+
+VulkanSecondaryCommandPools::VulkanSecondaryCommandPools()
+    : m_Vk(NULL)
+    , m_QueueFamilyIndex(0)
+{
+}
+
+VulkanSecondaryCommandPools::~VulkanSecondaryCommandPools()
+{
+    Shutdown();
+}
+
+void VulkanSecondaryCommandPools::Initialize(const VulkanDispatch* vk, uint32_t queueFamilyIndex)
+{
+    Shutdown();
+    m_Vk = vk;
+    m_QueueFamilyIndex = queueFamilyIndex;
+}
+
+void VulkanSecondaryCommandPools::Shutdown()
+{
+    // Destroying a pool frees its buffers
+    for (size_t i = 0; i < m_Frames.size(); ++i)
+        for (size_t slot = 0; slot < m_Frames[i]->slots.size(); ++slot)
+            m_Vk->vkDestroyCommandPool(m_Vk->device, m_Frames[i]->slots[slot].pool, NULL);
+    m_Frames.clear();
+    m_Vk = NULL;
+}
+
+VulkanSecondaryCommandPools::FrameSet* VulkanSecondaryCommandPools::BeginFrame(unsigned long long frameNumber, unsigned long long safeFrameNumber, int slotCount)
+{
+    if (!m_Vk)
+        return NULL;
+
+    // Another event in the same frame carries on where the previous one stopped
+    FrameSet* frame = NULL;
+    for (size_t i = 0; i < m_Frames.size() && !frame; ++i)
+        if (m_Frames[i]->frameNumber == frameNumber)
+            frame = m_Frames[i].get();
+
+    for (size_t i = 0; i < m_Frames.size() && !frame; ++i)
+    {
+        if (m_Frames[i]->frameNumber > safeFrameNumber)
+            continue;
+        frame = m_Frames[i].get();
+        for (size_t slot = 0; slot < frame->slots.size(); ++slot)
+        {
+            m_Vk->vkResetCommandPool(m_Vk->device, frame->slots[slot].pool, 0);
+            frame->slots[slot].used = 0;
+        }
+    }
+
+    if (!frame)
+    {
+        m_Frames.push_back(std::unique_ptr<FrameSet>(new FrameSet()));
+        frame = m_Frames.back().get();
+    }
+    frame->frameNumber = frameNumber;
+
+    while ((int)frame->slots.size() < slotCount)
+    {
+        VkCommandPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolCreateInfo.queueFamilyIndex = m_QueueFamilyIndex;
+
+        FrameSet::Slot slot;
+        slot.used = 0;
+        if (m_Vk->vkCreateCommandPool(m_Vk->device, &poolCreateInfo, NULL, &slot.pool) != VK_SUCCESS)
+            return NULL;
+        frame->slots.push_back(slot);
+    }
+    return frame;
+}
+
+VkCommandBuffer VulkanSecondaryCommandPools::Allocate(FrameSet* frame, int slotIndex)
+{
+    FrameSet::Slot& slot = frame->slots[slotIndex];
+    if (slot.used == slot.buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = slot.pool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (m_Vk->vkAllocateCommandBuffers(m_Vk->device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+        slot.buffers.push_back(commandBuffer);
+    }
+    return slot.buffers[slot.used++];
+}
+
+#endif // #if SUPPORT_VULKAN
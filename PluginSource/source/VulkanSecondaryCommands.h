@@ -0,0 +1,49 @@
+#pragma once
+
+// Command pools for secondary command buffers recorded on worker threads.
+//
+// A VkCommandPool may only be used by one thread at a time, so recording in parallel needs
+// one pool per recording slot (a worker chunk). Buffers from a pool can't be reset while the
+// GPU may still execute them either, so the pools come in per-frame sets: a set is tied to
+// the Unity frame it was recorded for and, once Unity reports that frame safe, reset as a
+// whole with vkResetCommandPool and its buffers handed out again. Nothing is freed until
+// Shutdown.
+
+#include "PlatformBase.h"
+
+#if SUPPORT_VULKAN
+
+#include <memory>
+#include <vector>
+
+#include "VulkanDispatch.h"
+
+class VulkanSecondaryCommandPools
+{
+public:
+    struct FrameSet;
+
+    VulkanSecondaryCommandPools();
+    ~VulkanSecondaryCommandPools();
+
+    // Pools are created on queueFamilyIndex, the family the primaries are submitted to
+    void Initialize(const VulkanDispatch* vk, uint32_t queueFamilyIndex);
+    // Destroys every pool; the GPU must be done with all of them
+    void Shutdown();
+
+    // The set to record frameNumber's secondaries into, with at least slotCount pools:
+    // the one already used for frameNumber, a finished one (reset here), or a new one.
+    // Render thread only. NULL if a pool can't be created.
+    FrameSet* BeginFrame(unsigned long long frameNumber, unsigned long long safeFrameNumber, int slotCount);
+
+    // The next unused secondary of slot's pool, allocated when needed. Concurrent calls are
+    // fine as long as each slot is only used by one thread at a time. VK_NULL_HANDLE on failure.
+    VkCommandBuffer Allocate(FrameSet* frame, int slot);
+
+private:
+    const VulkanDispatch* m_Vk;
+    uint32_t m_QueueFamilyIndex;
+    std::vector<std::unique_ptr<FrameSet> > m_Frames;
+};
+
+#endif // #if SUPPORT_VULKAN
@@ -0,0 +1,605 @@
+#include "VulkanTrianglePipeline.h"
+
+#if SUPPORT_VULKAN
+
+#include <string.h>
+
+namespace Shader {
+// Source of vertex shader (filename: shader.vert)
+/*
+#version 310 es
+layout(location = 0) in highp vec3 vpos;
+layout(location = 1) in highp vec4 vcol;
+layout(location = 0) out highp vec4 color;
+layout(push_constant) uniform PushConstants { mat4 matrix; };
+void main() {
+    gl_Position = matrix * vec4(vpos, 1.0);
+    color = vcol;
+}
+*/
+
+// Source of fragment shader (filename: shader.frag)
+/*
+#version 310 es
+layout(location = 0) out highp vec4 fragColor;
+layout(location = 0) in highp vec4 color;
+void main() { fragColor = color; }
+*/
+// compiled to SPIR-V using:
+// %VULKAN_SDK%\bin\glslc -mfmt=num shader.frag shader.vert -c
+
+const uint32_t vertexShaderSpirv[] = {
+	0x07230203,0x00010000,0x000d0007,0x00000024,
+	0x00000000,0x00020011,0x00000001,0x0006000b,
+	0x00000001,0x4c534c47,0x6474732e,0x3035342e,
+	0x00000000,0x0003000e,0x00000000,0x00000001,
+	0x0009000f,0x00000000,0x00000004,0x6e69616d,
+	0x00000000,0x0000000a,0x00000016,0x00000020,
+	0x00000022,0x00030003,0x00000001,0x00000136,
+	0x000a0004,0x475f4c47,0x4c474f4f,0x70635f45,
+	0x74735f70,0x5f656c79,0x656e696c,0x7269645f,
+	0x69746365,0x00006576,0x00080004,0x475f4c47,
+	0x4c474f4f,0x6e695f45,0x64756c63,0x69645f65,
+	0x74636572,0x00657669,0x00040005,0x00000004,
+	0x6e69616d,0x00000000,0x00060005,0x00000008,
+	0x505f6c67,0x65567265,0x78657472,0x00000000,
+	0x00060006,0x00000008,0x00000000,0x505f6c67,
+	0x7469736f,0x006e6f69,0x00070006,0x00000008,
+	0x00000001,0x505f6c67,0x746e696f,0x657a6953,
+	0x00000000,0x00030005,0x0000000a,0x00000000,
+	0x00060005,0x0000000e,0x68737550,0x736e6f43,
+	0x746e6174,0x00000073,0x00050006,0x0000000e,
+	0x00000000,0x7274616d,0x00007869,0x00030005,
+	0x00000010,0x00000000,0x00040005,0x00000016,
+	0x736f7076,0x00000000,0x00040005,0x00000020,
+	0x6f6c6f63,0x00000072,0x00040005,0x00000022,
+	0x6c6f6376,0x00000000,0x00050048,0x00000008,
+	0x00000000,0x0000000b,0x00000000,0x00050048,
+	0x00000008,0x00000001,0x0000000b,0x00000001,
+	0x00030047,0x00000008,0x00000002,0x00040048,
+	0x0000000e,0x00000000,0x00000005,0x00050048,
+	0x0000000e,0x00000000,0x00000023,0x00000000,
+	0x00050048,0x0000000e,0x00000000,0x00000007,
+	0x00000010,0x00030047,0x0000000e,0x00000002,
+	0x00040047,0x00000016,0x0000001e,0x00000000,
+	0x00040047,0x00000020,0x0000001e,0x00000000,
+	0x00040047,0x00000022,0x0000001e,0x00000001,
+	0x00020013,0x00000002,0x00030021,0x00000003,
+	0x00000002,0x00030016,0x00000006,0x00000020,
+	0x00040017,0x00000007,0x00000006,0x00000004,
+	0x0004001e,0x00000008,0x00000007,0x00000006,
+	0x00040020,0x00000009,0x00000003,0x00000008,
+	0x0004003b,0x00000009,0x0000000a,0x00000003,
+	0x00040015,0x0000000b,0x00000020,0x00000001,
+	0x0004002b,0x0000000b,0x0000000c,0x00000000,
+	0x00040018,0x0000000d,0x00000007,0x00000004,
+	0x0003001e,0x0000000e,0x0000000d,0x00040020,
+	0x0000000f,0x00000009,0x0000000e,0x0004003b,
+	0x0000000f,0x00000010,0x00000009,0x00040020,
+	0x00000011,0x00000009,0x0000000d,0x00040017,
+	0x00000014,0x00000006,0x00000003,0x00040020,
+	0x00000015,0x00000001,0x00000014,0x0004003b,
+	0x00000015,0x00000016,0x00000001,0x0004002b,
+	0x00000006,0x00000018,0x3f800000,0x00040020,
+	0x0000001e,0x00000003,0x00000007,0x0004003b,
+	0x0000001e,0x00000020,0x00000003,0x00040020,
+	0x00000021,0x00000001,0x00000007,0x0004003b,
+	0x00000021,0x00000022,0x00000001,0x00050036,
+	0x00000002,0x00000004,0x00000000,0x00000003,
+	0x000200f8,0x00000005,0x00050041,0x00000011,
+	0x00000012,0x00000010,0x0000000c,0x0004003d,
+	0x0000000d,0x00000013,0x00000012,0x0004003d,
+	0x00000014,0x00000017,0x00000016,0x00050051,
+	0x00000006,0x00000019,0x00000017,0x00000000,
+	0x00050051,0x00000006,0x0000001a,0x00000017,
+	0x00000001,0x00050051,0x00000006,0x0000001b,
+	0x00000017,0x00000002,0x00070050,0x00000007,
+	0x0000001c,0x00000019,0x0000001a,0x0000001b,
+	0x00000018,0x00050091,0x00000007,0x0000001d,
+	0x00000013,0x0000001c,0x00050041,0x0000001e,
+	0x0000001f,0x0000000a,0x0000000c,0x0003003e,
+	0x0000001f,0x0000001d,0x0004003d,0x00000007,
+	0x00000023,0x00000022,0x0003003e,0x00000020,
+	0x00000023,0x000100fd,0x00010038
+};
+const uint32_t fragmentShaderSpirv[] = {
+    0x07230203,0x00010000,0x000d0006,0x0000000d,
+    0x00000000,0x00020011,0x00000001,0x0006000b,
+    0x00000001,0x4c534c47,0x6474732e,0x3035342e,
+    0x00000000,0x0003000e,0x00000000,0x00000001,
+    0x0007000f,0x00000004,0x00000004,0x6e69616d,
+    0x00000000,0x00000009,0x0000000b,0x00030010,
+    0x00000004,0x00000007,0x00030003,0x00000001,
+    0x00000136,0x000a0004,0x475f4c47,0x4c474f4f,
+    0x70635f45,0x74735f70,0x5f656c79,0x656e696c,
+    0x7269645f,0x69746365,0x00006576,0x00080004,
+    0x475f4c47,0x4c474f4f,0x6e695f45,0x64756c63,
+    0x69645f65,0x74636572,0x00657669,0x00040005,
+    0x00000004,0x6e69616d,0x00000000,0x00050005,
+    0x00000009,0x67617266,0x6f6c6f43,0x00000072,
+    0x00040005,0x0000000b,0x6f6c6f63,0x00000072,
+    0x00040047,0x00000009,0x0000001e,0x00000000,
+    0x00040047,0x0000000b,0x0000001e,0x00000000,
+    0x00020013,0x00000002,0x00030021,0x00000003,
+    0x00000002,0x00030016,0x00000006,0x00000020,
+    0x00040017,0x00000007,0x00000006,0x00000004,
+    0x00040020,0x00000008,0x00000003,0x00000007,
+    0x0004003b,0x00000008,0x00000009,0x00000003,
+    0x00040020,0x0000000a,0x00000001,0x00000007,
+    0x0004003b,0x0000000a,0x0000000b,0x00000001,
+    0x00050036,0x00000002,0x00000004,0x00000000,
+    0x00000003,0x000200f8,0x00000005,0x0004003d,
+    0x00000007,0x0000000c,0x0000000b,0x0003003e,
+    0x00000009,0x0000000c,0x000100fd,0x00010038
+};
+} // namespace Shader
+
+// Fixed-function state of the triangle pipeline, shared by the monolithic create and the
+// library parts so they can't drift apart. Points into itself: fill in place, don't copy.
+struct TrianglePipelineState
+{
+    VkPipelineShaderStageCreateInfo shaderStages[2];
+    VkVertexInputBindingDescription vertexInputBinding;
+    VkVertexInputAttributeDescription vertexInputAttributes[2];
+    VkPipelineVertexInputStateCreateInfo vertexInputState;
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyState;
+    VkPipelineViewportStateCreateInfo viewportState;
+    VkPipelineRasterizationStateCreateInfo rasterizationState;
+    VkPipelineMultisampleStateCreateInfo multisampleState;
+    VkPipelineDepthStencilStateCreateInfo depthStencilState;
+    VkPipelineColorBlendAttachmentState blendAttachmentState[1];
+    VkPipelineColorBlendStateCreateInfo colorBlendState;
+    VkDynamicState dynamicStateEnables[2];
+    VkPipelineDynamicStateCreateInfo dynamicState;
+
+    TrianglePipelineState(VkShaderModule vertexShader, VkShaderModule fragmentShader)
+    {
+        memset(this, 0, sizeof(*this));
+
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = vertexShader;
+        shaderStages[0].pName = "main";
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = fragmentShader;
+        shaderStages[1].pName = "main";
+
+        // Vertex:
+        // float3 vpos;
+        // byte4 vcol;
+        vertexInputBinding.binding = 0;
+        vertexInputBinding.stride = 16;
+        vertexInputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        vertexInputAttributes[0].binding = 0;
+        vertexInputAttributes[0].location = 0;
+        vertexInputAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        vertexInputAttributes[0].offset = 0;
+        vertexInputAttributes[1].binding = 0;
+        vertexInputAttributes[1].location = 1;
+        vertexInputAttributes[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+        vertexInputAttributes[1].offset = 12;
+
+        vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputState.vertexBindingDescriptionCount = 1;
+        vertexInputState.pVertexBindingDescriptions = &vertexInputBinding;
+        vertexInputState.vertexAttributeDescriptionCount = 2;
+        vertexInputState.pVertexAttributeDescriptions = vertexInputAttributes;
+
+        inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizationState.cullMode = VK_CULL_MODE_NONE;
+        rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterizationState.depthClampEnable = VK_FALSE;
+        rasterizationState.rasterizerDiscardEnable = VK_FALSE;
+        rasterizationState.depthBiasEnable = VK_FALSE;
+        rasterizationState.lineWidth = 1.0f;
+
+        multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisampleState.pSampleMask = NULL;
+
+        depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencilState.depthTestEnable = VK_TRUE;
+        depthStencilState.depthWriteEnable = VK_TRUE;
+        depthStencilState.depthBoundsTestEnable = VK_FALSE;
+        depthStencilState.stencilTestEnable = VK_FALSE;
+        depthStencilState.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; // Unity/Vulkan uses reverse Z
+        depthStencilState.back.failOp = VK_STENCIL_OP_KEEP;
+        depthStencilState.back.passOp = VK_STENCIL_OP_KEEP;
+        depthStencilState.back.compareOp = VK_COMPARE_OP_ALWAYS;
+        depthStencilState.front = depthStencilState.back;
+
+        blendAttachmentState[0].colorWriteMask = 0xf;
+        blendAttachmentState[0].blendEnable = VK_FALSE;
+        colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlendState.attachmentCount = 1;
+        colorBlendState.pAttachments = blendAttachmentState;
+
+        dynamicStateEnables[0] = VK_DYNAMIC_STATE_VIEWPORT;
+        dynamicStateEnables[1] = VK_DYNAMIC_STATE_SCISSOR;
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.pDynamicStates = dynamicStateEnables;
+        dynamicState.dynamicStateCount = sizeof(dynamicStateEnables) / sizeof(*dynamicStateEnables);
+    }
+};
+
+static VkShaderModule CreateShaderModule(const VulkanDispatch& vk, const uint32_t* code, size_t codeSize)
+{
+    VkShaderModuleCreateInfo moduleCreateInfo = {};
+    moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleCreateInfo.codeSize = codeSize;
+    moduleCreateInfo.pCode = code;
+    VkShaderModule module;
+    return vk.vkCreateShaderModule(vk.device, &moduleCreateInfo, NULL, &module) == VK_SUCCESS ? module : VK_NULL_HANDLE;
+}
+
+#ifdef VK_EXT_graphics_pipeline_library
+// One library part; createInfo carries the state that part owns
+static VkPipeline CreateLibrary(const VulkanDispatch& vk, VkGraphicsPipelineLibraryFlagsEXT part, VkGraphicsPipelineCreateInfo createInfo)
+{
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryCreateInfo = {};
+    libraryCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryCreateInfo.flags = part;
+
+    createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    createInfo.pNext = &libraryCreateInfo;
+    // Keep what the optimized link needs, so it doesn't have to start over from SPIR-V
+    createInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+    VkPipeline pipeline;
+    return vk.vkCreateGraphicsPipelines(vk.device, VK_NULL_HANDLE, 1, &createInfo, NULL, &pipeline) == VK_SUCCESS ? pipeline : VK_NULL_HANDLE;
+}
+#endif
+
+VulkanTrianglePipelines::VulkanTrianglePipelines()
+    : m_Vk(NULL)
+    , m_Pool(NULL)
+    , m_PipelineLibrary(false)
+    , m_Layout(VK_NULL_HANDLE)
+    , m_VertexShader(VK_NULL_HANDLE)
+    , m_FragmentShader(VK_NULL_HANDLE)
+    , m_VertexInput(VK_NULL_HANDLE)
+{
+}
+
+VulkanTrianglePipelines::~VulkanTrianglePipelines()
+{
+    Shutdown();
+}
+
+bool VulkanTrianglePipelines::Initialize(const VulkanDispatch* vk, bool pipelineLibrary)
+{
+    Shutdown();
+    m_Vk = vk;
+
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = 64; // single matrix
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    if (vk->vkCreatePipelineLayout(vk->device, &pipelineLayoutCreateInfo, NULL, &m_Layout) != VK_SUCCESS)
+        m_Layout = VK_NULL_HANDLE;
+
+    // Kept for the whole lifetime: workers compile from them at any time
+    m_VertexShader = CreateShaderModule(*vk, Shader::vertexShaderSpirv, sizeof(Shader::vertexShaderSpirv));
+    m_FragmentShader = CreateShaderModule(*vk, Shader::fragmentShaderSpirv, sizeof(Shader::fragmentShaderSpirv));
+    if (m_Layout == VK_NULL_HANDLE || m_VertexShader == VK_NULL_HANDLE || m_FragmentShader == VK_NULL_HANDLE)
+    {
+        Shutdown();
+        return false;
+    }
+
+#ifdef VK_EXT_graphics_pipeline_library
+    // The vertex input part doesn't depend on the render pass, so it can be built right away
+    if (pipelineLibrary)
+    {
+        TrianglePipelineState state(m_VertexShader, m_FragmentShader);
+        VkGraphicsPipelineCreateInfo createInfo = {};
+        createInfo.pVertexInputState = &state.vertexInputState;
+        createInfo.pInputAssemblyState = &state.inputAssemblyState;
+        m_VertexInput = CreateLibrary(*vk, VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, createInfo);
+    }
+#endif
+    m_PipelineLibrary = m_VertexInput != VK_NULL_HANDLE;
+    return true;
+}
+
+void VulkanTrianglePipelines::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_Vk)
+        return;
+    WaitForJobs();
+
+    for (std::map<VkRenderPass, std::unique_ptr<Entry> >::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+    {
+        Entry& entry = *it->second;
+        for (int part = 0; part < kPart_Count; ++part)
+            if (entry.parts[part] != VK_NULL_HANDLE)
+                m_Vk->vkDestroyPipeline(m_Vk->device, entry.parts[part], NULL);
+        if (entry.compiled != VK_NULL_HANDLE && entry.compiled != entry.current)
+            m_Vk->vkDestroyPipeline(m_Vk->device, entry.compiled, NULL);
+        if (entry.current != VK_NULL_HANDLE)
+            m_Vk->vkDestroyPipeline(m_Vk->device, entry.current, NULL);
+    }
+    m_Entries.clear();
+    for (size_t i = 0; i < m_Retired.size(); ++i)
+        m_Vk->vkDestroyPipeline(m_Vk->device, m_Retired[i].pipeline, NULL);
+    m_Retired.clear();
+
+    if (m_VertexInput != VK_NULL_HANDLE)
+        m_Vk->vkDestroyPipeline(m_Vk->device, m_VertexInput, NULL);
+    if (m_VertexShader != VK_NULL_HANDLE)
+        m_Vk->vkDestroyShaderModule(m_Vk->device, m_VertexShader, NULL);
+    if (m_FragmentShader != VK_NULL_HANDLE)
+        m_Vk->vkDestroyShaderModule(m_Vk->device, m_FragmentShader, NULL);
+    if (m_Layout != VK_NULL_HANDLE)
+        m_Vk->vkDestroyPipelineLayout(m_Vk->device, m_Layout, NULL);
+    m_VertexInput = VK_NULL_HANDLE;
+    m_VertexShader = VK_NULL_HANDLE;
+    m_FragmentShader = VK_NULL_HANDLE;
+    m_Layout = VK_NULL_HANDLE;
+    m_PipelineLibrary = false;
+    m_Vk = NULL;
+}
+
+void VulkanTrianglePipelines::SetWorkerPool(WorkerPool* pool)
+{
+    // Jobs on the old pool must finish before it can go away
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    WaitForJobs();
+    m_Pool = pool;
+}
+
+void VulkanTrianglePipelines::WaitForJobs()
+{
+    if (!m_Pool)
+        return;
+    for (std::map<VkRenderPass, std::unique_ptr<Entry> >::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+        m_Pool->Wait(&it->second->job);
+}
+
+VkPipeline VulkanTrianglePipelines::Get(VkRenderPass renderPass, unsigned long long currentFrameNumber, unsigned long long safeFrameNumber)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_Vk)
+        return VK_NULL_HANDLE;
+
+    for (size_t i = 0; i < m_Retired.size();)
+    {
+        if (m_Retired[i].frameNumber <= safeFrameNumber)
+        {
+            m_Vk->vkDestroyPipeline(m_Vk->device, m_Retired[i].pipeline, NULL);
+            m_Retired[i] = m_Retired.back();
+            m_Retired.pop_back();
+        }
+        else
+            ++i;
+    }
+
+    if (renderPass == VK_NULL_HANDLE)
+        return VK_NULL_HANDLE;
+
+    Entry* entry;
+    std::map<VkRenderPass, std::unique_ptr<Entry> >::iterator it = m_Entries.find(renderPass);
+    if (it == m_Entries.end())
+    {
+        entry = new Entry();
+        entry->owner = this;
+        entry->renderPass = renderPass;
+        entry->stage = kStage_Compiling;
+        for (int part = 0; part < kPart_Count; ++part)
+            entry->parts[part] = VK_NULL_HANDLE;
+        entry->current = VK_NULL_HANDLE;
+        entry->compiled = VK_NULL_HANDLE;
+        entry->jobFunc = NULL;
+        m_Entries[renderPass].reset(entry);
+        StartJob(entry, m_PipelineLibrary ? CompileParts : CompileMonolithic);
+    }
+    else
+        entry = it->second.get();
+    entry->lastUsedFrame = currentFrameNumber;
+
+    // Without workers the jobs ran inside StartJob, so this goes all the way in one call
+    while ((entry->stage == kStage_Compiling || entry->stage == kStage_Optimizing) && entry->job.IsDone())
+    {
+        if (entry->stage == kStage_Optimizing)
+        {
+            // Command buffers of this frame may still use the fast-linked one
+            if (entry->compiled != VK_NULL_HANDLE)
+            {
+                Retired retired = { entry->current, currentFrameNumber };
+                m_Retired.push_back(retired);
+                entry->current = entry->compiled;
+            }
+            entry->compiled = VK_NULL_HANDLE;
+            entry->stage = kStage_Done;
+        }
+        else if (entry->jobFunc == CompileMonolithic)
+        {
+            entry->current = entry->compiled;
+            entry->compiled = VK_NULL_HANDLE;
+            entry->stage = entry->current != VK_NULL_HANDLE ? kStage_Done : kStage_Failed;
+        }
+        else
+        {
+            entry->current = Link(*entry, false);
+            if (entry->current != VK_NULL_HANDLE)
+            {
+                entry->stage = kStage_Optimizing;
+                StartJob(entry, LinkOptimized);
+            }
+            else
+            {
+                // Some part failed to build or link; try the whole pipeline in one go instead
+                StartJob(entry, CompileMonolithic);
+            }
+        }
+    }
+
+    // Linked pipelines don't need their libraries any more
+    if (entry->stage == kStage_Done || entry->stage == kStage_Failed)
+    {
+        for (int part = 0; part < kPart_Count; ++part)
+        {
+            if (entry->parts[part] != VK_NULL_HANDLE)
+                m_Vk->vkDestroyPipeline(m_Vk->device, entry->parts[part], NULL);
+            entry->parts[part] = VK_NULL_HANDLE;
+        }
+    }
+    return entry->current;
+}
+
+void VulkanTrianglePipelines::OnRenderPassDestroyed(VkRenderPass renderPass)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::map<VkRenderPass, std::unique_ptr<Entry> >::iterator it = m_Entries.find(renderPass);
+    if (!m_Vk || it == m_Entries.end())
+        return;
+
+    // A worker may still be building against the render pass
+    Entry& entry = *it->second;
+    if (m_Pool)
+        m_Pool->Wait(&entry.job);
+
+    // Libraries are never bound; the pipelines may still be in command buffers of lastUsedFrame
+    for (int part = 0; part < kPart_Count; ++part)
+        if (entry.parts[part] != VK_NULL_HANDLE)
+            m_Vk->vkDestroyPipeline(m_Vk->device, entry.parts[part], NULL);
+    if (entry.compiled != VK_NULL_HANDLE && entry.compiled != entry.current)
+    {
+        Retired retired = { entry.compiled, entry.lastUsedFrame };
+        m_Retired.push_back(retired);
+    }
+    if (entry.current != VK_NULL_HANDLE)
+    {
+        Retired retired = { entry.current, entry.lastUsedFrame };
+        m_Retired.push_back(retired);
+    }
+    m_Entries.erase(it);
+}
+
+void VulkanTrianglePipelines::StartJob(Entry* entry, JobFunc func)
+{
+    entry->compiled = VK_NULL_HANDLE;
+    entry->jobFunc = func;
+    if (!m_Pool)
+    {
+        func(this, entry);
+        return;
+    }
+    m_Pool->StartParallelFor(&entry->job, 1, 1, [](void* context, int, int) {
+        Entry* entry = static_cast<Entry*>(context);
+        entry->jobFunc(entry->owner, entry);
+    }, entry);
+}
+
+void VulkanTrianglePipelines::CompileMonolithic(VulkanTrianglePipelines* self, Entry* entry)
+{
+    const VulkanDispatch& vk = *self->m_Vk;
+    TrianglePipelineState state(self->m_VertexShader, self->m_FragmentShader);
+
+    VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.layout = self->m_Layout;
+    pipelineCreateInfo.renderPass = entry->renderPass;
+    pipelineCreateInfo.stageCount = sizeof(state.shaderStages) / sizeof(*state.shaderStages);
+    pipelineCreateInfo.pStages = state.shaderStages;
+    pipelineCreateInfo.pVertexInputState = &state.vertexInputState;
+    pipelineCreateInfo.pInputAssemblyState = &state.inputAssemblyState;
+    pipelineCreateInfo.pRasterizationState = &state.rasterizationState;
+    pipelineCreateInfo.pColorBlendState = &state.colorBlendState;
+    pipelineCreateInfo.pMultisampleState = &state.multisampleState;
+    pipelineCreateInfo.pViewportState = &state.viewportState;
+    pipelineCreateInfo.pDepthStencilState = &state.depthStencilState;
+    pipelineCreateInfo.pDynamicState = &state.dynamicState;
+
+    VkPipeline pipeline;
+    if (vk.vkCreateGraphicsPipelines(vk.device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, NULL, &pipeline) == VK_SUCCESS)
+        entry->compiled = pipeline;
+}
+
+void VulkanTrianglePipelines::CompileParts(VulkanTrianglePipelines* self, Entry* entry)
+{
+#ifdef VK_EXT_graphics_pipeline_library
+    const VulkanDispatch& vk = *self->m_Vk;
+    TrianglePipelineState state(self->m_VertexShader, self->m_FragmentShader);
+
+    VkGraphicsPipelineCreateInfo preRasterization = {};
+    preRasterization.layout = self->m_Layout;
+    preRasterization.renderPass = entry->renderPass;
+    preRasterization.stageCount = 1;
+    preRasterization.pStages = &state.shaderStages[0];
+    preRasterization.pViewportState = &state.viewportState;
+    preRasterization.pRasterizationState = &state.rasterizationState;
+    preRasterization.pDynamicState = &state.dynamicState;
+    entry->parts[kPart_PreRasterization] = CreateLibrary(vk, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, preRasterization);
+
+    VkGraphicsPipelineCreateInfo fragmentShader = {};
+    fragmentShader.layout = self->m_Layout;
+    fragmentShader.renderPass = entry->renderPass;
+    fragmentShader.stageCount = 1;
+    fragmentShader.pStages = &state.shaderStages[1];
+    fragmentShader.pMultisampleState = &state.multisampleState;
+    fragmentShader.pDepthStencilState = &state.depthStencilState;
+    entry->parts[kPart_FragmentShader] = CreateLibrary(vk, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, fragmentShader);
+
+    VkGraphicsPipelineCreateInfo fragmentOutput = {};
+    fragmentOutput.renderPass = entry->renderPass;
+    fragmentOutput.pColorBlendState = &state.colorBlendState;
+    fragmentOutput.pMultisampleState = &state.multisampleState;
+    entry->parts[kPart_FragmentOutput] = CreateLibrary(vk, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, fragmentOutput);
+#else
+    (void)self;
+    (void)entry;
+#endif
+}
+
+void VulkanTrianglePipelines::LinkOptimized(VulkanTrianglePipelines* self, Entry* entry)
+{
+    entry->compiled = self->Link(*entry, true);
+}
+
+VkPipeline VulkanTrianglePipelines::Link(const Entry& entry, bool optimize) const
+{
+#ifdef VK_EXT_graphics_pipeline_library
+    VkPipeline libraries[1 + kPart_Count] = { m_VertexInput };
+    for (int part = 0; part < kPart_Count; ++part)
+    {
+        if (entry.parts[part] == VK_NULL_HANDLE)
+            return VK_NULL_HANDLE;
+        libraries[1 + part] = entry.parts[part];
+    }
+
+    VkPipelineLibraryCreateInfoKHR libraryInfo = {};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = sizeof(libraries) / sizeof(*libraries);
+    libraryInfo.pLibraries = libraries;
+
+    VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.pNext = &libraryInfo;
+    pipelineCreateInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    pipelineCreateInfo.layout = m_Layout;
+
+    VkPipeline pipeline;
+    return m_Vk->vkCreateGraphicsPipelines(m_Vk->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, NULL, &pipeline) == VK_SUCCESS ? pipeline : VK_NULL_HANDLE;
+#else
+    (void)entry;
+    (void)optimize;
+    return VK_NULL_HANDLE;
+#endif
+}
+
+#endif // #if SUPPORT_VULKAN
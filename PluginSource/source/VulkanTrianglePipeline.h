@@ -0,0 +1,114 @@
+#pragma once
+
+// The plugin's triangle pipeline, one per Unity render pass, compiled off the render thread.
+//
+// Compiling a monolithic pipeline the first time a render pass shows up used to stall the
+// render thread for the whole compile. Now the render thread never compiles:
+//
+// - With VK_EXT_graphics_pipeline_library (and fast linking), the render-pass independent
+//   vertex input part is built at Initialize, and the first use of a render pass queues its
+//   pre-rasterization, fragment shader and fragment output parts on a worker. Once they are
+//   there the render thread fast-links them, which is cheap, and a worker builds the
+//   link-time optimized pipeline from the same parts; that replaces the fast-linked one when
+//   it is done.
+// - Without it, a worker compiles the monolithic pipeline.
+//
+// Until a render pass has a pipeline, Get returns VK_NULL_HANDLE and the draws in it are
+// skipped. Without workers everything is compiled on the spot, as before.
+
+#include "PlatformBase.h"
+
+#if SUPPORT_VULKAN
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "VulkanDispatch.h"
+#include "WorkerPool.h"
+
+class VulkanTrianglePipelines
+{
+public:
+    VulkanTrianglePipelines();
+    ~VulkanTrianglePipelines();
+
+    // pipelineLibrary: VK_EXT_graphics_pipeline_library is enabled and fast linking is fast.
+    // False if the layout or shader modules can't be created.
+    bool Initialize(const VulkanDispatch* vk, bool pipelineLibrary);
+    // Waits for background compiles and destroys every pipeline; the GPU must be done with them
+    void Shutdown();
+
+    // Where compiles run from now on; NULL compiles on the calling thread. Waits for what is
+    // running on the previous pool first.
+    void SetWorkerPool(WorkerPool* pool);
+
+    // Push constants: the world matrix, 64 bytes for the vertex stage
+    VkPipelineLayout GetLayout() const { return m_Layout; }
+
+    // The best pipeline renderPass (subpass 0) has so far, VK_NULL_HANDLE while it is compiling.
+    // Starts the compile on first use and swaps finished ones in. A pipeline that gets replaced
+    // is destroyed once safeFrameNumber passes currentFrameNumber. Render thread only.
+    VkPipeline Get(VkRenderPass renderPass, unsigned long long currentFrameNumber, unsigned long long safeFrameNumber);
+
+    // Drops everything built for renderPass, which is about to be destroyed, so a later render
+    // pass that gets the same handle value starts over. Waits for a compile still using it;
+    // its pipelines go once the GPU is past the last frame Get handed them out in. Any thread.
+    void OnRenderPassDestroyed(VkRenderPass renderPass);
+
+private:
+    enum Stage
+    {
+        kStage_Compiling,   // a worker builds the parts (libraries) or the whole pipeline
+        kStage_Optimizing,  // fast-linked pipeline in use, a worker builds the optimized one
+        kStage_Done,
+        kStage_Failed,
+    };
+    enum Part
+    {
+        kPart_PreRasterization = 0,
+        kPart_FragmentShader,
+        kPart_FragmentOutput,
+        kPart_Count
+    };
+    struct Entry;
+    typedef void (*JobFunc)(VulkanTrianglePipelines* self, Entry* entry);
+    struct Entry
+    {
+        VulkanTrianglePipelines* owner;
+        VkRenderPass renderPass;
+        Stage stage;
+        VkPipeline parts[kPart_Count]; // library path only
+        VkPipeline current;            // what Get hands out
+        VkPipeline compiled;           // result of the running job, read after the job is done
+        JobFunc jobFunc;
+        WorkerPoolJob job;
+        unsigned long long lastUsedFrame; // currentFrameNumber of the last Get
+    };
+    struct Retired
+    {
+        VkPipeline pipeline;
+        unsigned long long frameNumber;
+    };
+
+    void StartJob(Entry* entry, JobFunc func);
+    static void CompileParts(VulkanTrianglePipelines* self, Entry* entry);
+    static void CompileMonolithic(VulkanTrianglePipelines* self, Entry* entry);
+    static void LinkOptimized(VulkanTrianglePipelines* self, Entry* entry);
+    VkPipeline Link(const Entry& entry, bool optimize) const;
+    void WaitForJobs();
+
+    const VulkanDispatch* m_Vk;
+    WorkerPool* m_Pool;
+    bool m_PipelineLibrary;
+    VkPipelineLayout m_Layout;
+    VkShaderModule m_VertexShader;
+    VkShaderModule m_FragmentShader;
+    VkPipeline m_VertexInput; // library path only
+    std::mutex m_Mutex; // m_Entries and m_Retired, for OnRenderPassDestroyed
+    std::map<VkRenderPass, std::unique_ptr<Entry> > m_Entries;
+    std::vector<Retired> m_Retired;
+};
+
+#endif // #if SUPPORT_VULKAN
@@ -0,0 +1,85 @@
+#include "VulkanValidation.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* kValidationEnvVar = "RENDERINGPLUGIN_VK_VALIDATION";
+static const char* kConfigFileName = "RenderingPlugin.cfg";
+static const char* kConfigKey = "vulkan_validation=";
+
+static bool ParseTier(const char* value, VulkanValidationTier* outTier)
+{
+    // Trim surrounding whitespace, the config file may have CRLF line endings
+    while (isspace((unsigned char)*value))
+        ++value;
+    size_t length = strlen(value);
+    while (length > 0 && isspace((unsigned char)value[length - 1]))
+        --length;
+
+    struct { const char* name; const char* number; VulkanValidationTier tier; } const kTiers[] =
+    {
+        { "off", "0", kVulkanValidation_Off },
+        { "errors", "1", kVulkanValidation_ErrorsOnly },
+        { "full", "2", kVulkanValidation_Full },
+        { "gpu", "3", kVulkanValidation_GpuAssisted },
+    };
+    for (size_t i = 0; i < sizeof(kTiers) / sizeof(*kTiers); ++i)
+    {
+        if ((strlen(kTiers[i].name) == length && strncmp(value, kTiers[i].name, length) == 0) ||
+            (strlen(kTiers[i].number) == length && strncmp(value, kTiers[i].number, length) == 0))
+        {
+            *outTier = kTiers[i].tier;
+            return true;
+        }
+    }
+    return false;
+}
+
+static VulkanValidationTier ReadVulkanValidationTier()
+{
+    VulkanValidationTier tier = kVulkanValidation_Off;
+
+#if defined(_MSC_VER)
+    char* envValue = NULL;
+    size_t envLength = 0;
+    if (_dupenv_s(&envValue, &envLength, kValidationEnvVar) == 0 && envValue)
+    {
+        const bool parsed = ParseTier(envValue, &tier);
+        free(envValue);
+        if (parsed)
+            return tier;
+    }
+#else
+    if (const char* envValue = getenv(kValidationEnvVar))
+        if (ParseTier(envValue, &tier))
+            return tier;
+#endif
+
+    FILE* config = NULL;
+#if defined(_MSC_VER)
+    fopen_s(&config, kConfigFileName, "r");
+#else
+    config = fopen(kConfigFileName, "r");
+#endif
+    if (config)
+    {
+        char line[256];
+        const size_t keyLength = strlen(kConfigKey);
+        while (fgets(line, sizeof(line), config))
+        {
+            if (strncmp(line, kConfigKey, keyLength) == 0 && ParseTier(line + keyLength, &tier))
+                break;
+        }
+        fclose(config);
+    }
+
+    return tier;
+}
+
+VulkanValidationTier GetVulkanValidationTier()
+{
+    static const VulkanValidationTier s_Tier = ReadVulkanValidationTier();
+    return s_Tier;
+}
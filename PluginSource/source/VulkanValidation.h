@@ -0,0 +1,20 @@
+#pragma once
+
+// How much Vulkan validation the plugin's own instance runs with.
+//
+// Chosen once at plugin load from the RENDERINGPLUGIN_VK_VALIDATION environment
+// variable, or failing that from a "vulkan_validation=" line in RenderingPlugin.cfg
+// next to the executable. Accepted values: off, errors, full, gpu (or 0-3).
+// Default is off: no validation layer, no debug utils extension and no messenger
+// are ever loaded, so shipping builds pay nothing.
+enum VulkanValidationTier
+{
+    kVulkanValidation_Off = 0,
+    kVulkanValidation_ErrorsOnly,  // validation layer, messenger reports errors only
+    kVulkanValidation_Full,        // validation layer, messenger reports warnings and errors
+    kVulkanValidation_GpuAssisted, // as Full, plus GPU-assisted validation (slow)
+};
+
+// Parsed on first call and cached; call it from UnityPluginLoad so the lookup
+// happens at load time rather than on whatever thread creates the instance.
+VulkanValidationTier GetVulkanValidationTier();
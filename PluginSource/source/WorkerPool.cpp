@@ -0,0 +1,222 @@
+#include "WorkerPool.h"
+
+#include <stdlib.h>
+
+static const char* kWorkersEnvVar = "RENDERINGPLUGIN_WORKERS";
+
+// Unity's main thread and render thread
+static const int kReservedCores = 2;
+// Chunks per thread ParallelFor callers should aim for; evens out uneven tiles
+static const int kTilesPerThread = 4;
+static const int kCacheLineSize = 64;
+
+// Which queue the current thread owns, -1 for threads that aren't workers
+static thread_local int t_WorkerIndex = -1;
+static thread_local const WorkerPool* t_WorkerPool = NULL;
+
+bool WorkerPoolJob::IsDone()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Remaining == 0;
+}
+
+int WorkerPool::GetDefaultThreadCount()
+{
+	int count = 0;
+#if defined(_MSC_VER)
+	char* envValue = NULL;
+	size_t envLength = 0;
+	if (_dupenv_s(&envValue, &envLength, kWorkersEnvVar) == 0 && envValue)
+	{
+		count = atoi(envValue);
+		free(envValue);
+	}
+#else
+	if (const char* envValue = getenv(kWorkersEnvVar))
+		count = atoi(envValue);
+#endif
+	if (count > 0)
+		return count;
+
+	count = static_cast<int>(std::thread::hardware_concurrency()) - kReservedCores;
+	return count > 1 ? count : 1;
+}
+
+WorkerPool::WorkerPool(int threadCount)
+	: m_PendingTasks(0), m_NextQueue(0), m_Stop(false)
+{
+	if (threadCount <= 0)
+		threadCount = GetDefaultThreadCount();
+	m_ThreadCount = threadCount;
+
+	m_Queues.reset(new Queue[threadCount]);
+	m_Threads.reserve(threadCount);
+	for (int i = 0; i < threadCount; ++i)
+		m_Threads.emplace_back(&WorkerPool::WorkerMain, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Stop = true;
+	}
+	m_WakeUp.notify_all();
+	for (std::thread& thread : m_Threads)
+		thread.join();
+}
+
+bool WorkerPool::PopTask(int queueIndex, Task* outTask)
+{
+	const int queueCount = GetThreadCount();
+
+	// Own work first, newest first: its data is most likely still in cache
+	if (queueIndex >= 0)
+	{
+		Queue& own = m_Queues[queueIndex];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			*outTask = own.tasks.back();
+			own.tasks.pop_back();
+			m_PendingTasks.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Then steal the oldest work from everyone else
+	const int start = queueIndex >= 0 ? queueIndex + 1 : 0;
+	for (int i = 0; i < queueCount; ++i)
+	{
+		Queue& victim = m_Queues[(start + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			*outTask = victim.tasks.front();
+			victim.tasks.pop_front();
+			m_PendingTasks.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkerPool::RunTask(const Task& task)
+{
+	WorkerPoolJob* job = task.job;
+	job->m_Func(job->m_Context, task.begin, task.end);
+
+	// Under the lock: once the waiter sees zero it may destroy the job, so the
+	// notifying thread must not touch it after unlocking
+	std::lock_guard<std::mutex> lock(job->m_Mutex);
+	if (--job->m_Remaining == 0)
+		job->m_Done.notify_all();
+}
+
+void WorkerPool::WorkerMain(int index)
+{
+	t_WorkerIndex = index;
+	t_WorkerPool = this;
+
+	for (;;)
+	{
+		Task task;
+		if (PopTask(index, &task))
+		{
+			RunTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_WakeUp.wait(lock, [this]() { return m_Stop || m_PendingTasks.load(std::memory_order_relaxed) > 0; });
+		if (m_Stop)
+			return;
+	}
+}
+
+void WorkerPool::ParallelFor(int count, int grain, WorkerPoolRangeFunc func, void* context)
+{
+	if (count <= 0)
+		return;
+
+	// Not worth a hand-off
+	if (count <= grain)
+	{
+		func(context, 0, count);
+		return;
+	}
+
+	WorkerPoolJob job;
+	StartParallelFor(&job, count, grain, func, context);
+	Wait(&job);
+}
+
+void WorkerPool::StartParallelFor(WorkerPoolJob* job, int count, int grain, WorkerPoolRangeFunc func, void* context)
+{
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	const int taskCount = (count + grain - 1) / grain;
+	job->m_Func = func;
+	job->m_Context = context;
+	{
+		std::lock_guard<std::mutex> lock(job->m_Mutex);
+		job->m_Remaining = taskCount;
+	}
+
+	// Round-robin over the deques; idle workers steal whatever lands unevenly
+	const int queueCount = GetThreadCount();
+	unsigned queue = m_NextQueue.fetch_add(1, std::memory_order_relaxed);
+	for (int begin = 0; begin < count; begin += grain, ++queue)
+	{
+		Task task = { job, begin, begin + grain < count ? begin + grain : count };
+		Queue& target = m_Queues[queue % queueCount];
+		std::lock_guard<std::mutex> lock(target.mutex);
+		target.tasks.push_back(task);
+	}
+	m_PendingTasks.fetch_add(taskCount, std::memory_order_relaxed);
+	{
+		// Taking the lock orders this against a worker checking the predicate and going to sleep
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+	}
+	m_WakeUp.notify_all();
+}
+
+void WorkerPool::Wait(WorkerPoolJob* job)
+{
+	const bool isOwnWorker = t_WorkerPool == this;
+	if (isOwnWorker)
+	{
+		// A worker blocking here could take the pool's last free thread; help instead
+		while (!job->IsDone())
+		{
+			Task task;
+			if (PopTask(t_WorkerIndex, &task))
+				RunTask(task);
+			else
+				std::this_thread::yield();
+		}
+	}
+	else
+	{
+		// Render thread (or any other caller): just wait for the join
+		std::unique_lock<std::mutex> lock(job->m_Mutex);
+		job->m_Done.wait(lock, [job]() { return job->m_Remaining == 0; });
+	}
+}
+
+int WorkerPool::GetRowTileGrain(int rowCount, int rowPitch) const
+{
+	const int tileCount = GetThreadCount() * kTilesPerThread;
+	int rows = (rowCount + tileCount - 1) / tileCount;
+
+	// Smallest row step whose byte size is a whole number of cache lines
+	int lineRows = 1;
+	while (lineRows < kCacheLineSize && ((long long)lineRows * rowPitch) % kCacheLineSize != 0)
+		++lineRows;
+
+	rows = (rows + lineRows - 1) / lineRows * lineRows;
+	return rows > 0 ? rows : 1;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for the CPU-side generators, so the render thread can
+// split a job up instead of doing all of it itself.
+//
+// Each worker owns a deque: it pops its own work from the back and, when that runs
+// dry, steals from the front of the others'. ParallelFor spreads its chunks over the
+// deques and blocks until all of them ran; called from a worker it runs queued work
+// while waiting instead, so nesting can't deadlock. StartParallelFor/Wait split that
+// in two for callers that must not block (e.g. Unity's main thread).
+//
+// Create and destroy it from UnityPluginLoad/UnityPluginUnload, not as a static:
+// joining threads from static destructors deadlocks on the Windows loader lock.
+typedef void (*WorkerPoolRangeFunc)(void* context, int begin, int end);
+
+// Completion state of one StartParallelFor. Owned by the caller; must stay alive (and
+// not be restarted) until the job is done.
+class WorkerPoolJob
+{
+public:
+	WorkerPoolJob() : m_Func(NULL), m_Context(NULL), m_Remaining(0) {}
+
+	// Never blocks; true for a job that was never started as well
+	bool IsDone();
+
+private:
+	friend class WorkerPool;
+	WorkerPoolRangeFunc m_Func;
+	void* m_Context;
+	int m_Remaining; // guarded by m_Mutex
+	std::mutex m_Mutex;
+	std::condition_variable m_Done;
+};
+
+class WorkerPool
+{
+public:
+	// threadCount <= 0 means GetDefaultThreadCount()
+	explicit WorkerPool(int threadCount = 0);
+	~WorkerPool();
+
+	// hardware_concurrency minus the cores Unity's main and render threads keep busy,
+	// at least 1. RENDERINGPLUGIN_WORKERS overrides it, e.g. to measure scaling.
+	static int GetDefaultThreadCount();
+
+	int GetThreadCount() const { return m_ThreadCount; }
+
+	// Calls func(context, begin, end) over [0, count) in chunks of grain items and
+	// returns once every chunk is done
+	void ParallelFor(int count, int grain, WorkerPoolRangeFunc func, void* context);
+
+	// Same, but returns right after queueing the chunks; see Wait/WorkerPoolJob::IsDone
+	void StartParallelFor(WorkerPoolJob* job, int count, int grain, WorkerPoolRangeFunc func, void* context);
+	void Wait(WorkerPoolJob* job);
+
+	template<typename Body>
+	void ParallelFor(int count, int grain, const Body& body)
+	{
+		ParallelFor(count, grain, [](void* context, int begin, int end) {
+			(*static_cast<const Body*>(context))(begin, end);
+		}, const_cast<Body*>(&body));
+	}
+
+	// Rows per chunk when splitting an image of rowCount rows rowPitch bytes apart:
+	// a few chunks per thread for balance, and a multiple of rows that makes every chunk
+	// start on a new cache line so neighbouring chunks never write the same line.
+	int GetRowTileGrain(int rowCount, int rowPitch) const;
+
+private:
+	struct Task
+	{
+		WorkerPoolJob* job;
+		int begin;
+		int end;
+	};
+	// Padded so the workers' locks don't share cache lines
+	struct alignas(64) Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void WorkerMain(int index);
+	bool PopTask(int queueIndex, Task* outTask);
+	void RunTask(const Task& task);
+
+	int m_ThreadCount; // fixed before the threads start, they read it while m_Threads still grows
+	std::vector<std::thread> m_Threads;
+	std::unique_ptr<Queue[]> m_Queues;
+	std::atomic<int> m_PendingTasks;
+	std::atomic<unsigned> m_NextQueue;
+
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeUp;
+	bool m_Stop;
+};
@@ -2,6 +2,9 @@ using UnityEngine;
 using System;
 using System.Collections;
 using System.Runtime.InteropServices;
+using System.Threading;
+using Unity.Collections;
+using Unity.Collections.LowLevel.Unsafe;
 using UnityEngine.Assertions;
 using UnityEngine.Rendering;
 
@@ -11,29 +14,253 @@ public class UseRenderingPlugin : MonoBehaviour
     // Native plugin rendering events are only called if a plugin is used
     // by some script. This means we have to DllImport at least
     // one function in some active script.
-    // For this example, we'll call into plugin's SetTimeFromUnity
-    // function and pass the current time so the plugin can animate.
+    // For this example, we map the plugin's command ring once and then pass
+    // the current time (and the texture and mesh) through it so the plugin can animate.
 
     [DllImport("RenderingPlugin")]
-    private static extern void SetTimeFromUnity(float t);
+    private static extern IntPtr GetCommandRing(out int size);
 
     [DllImport("RenderingPlugin")]
-    private static extern void SetMeshBuffersFromUnity(IntPtr vertexBuffer, int vertexCount, IntPtr sourceVertices, IntPtr sourceNormals, IntPtr sourceUVs);
+    private static extern IntPtr GetVulkanProfilerStats(out int size);
+
+    [DllImport("RenderingPlugin")]
+    private static extern uint RequestReadback(IntPtr textureHandle, int x, int y, int width, int height);
+
+    [DllImport("RenderingPlugin")]
+    private static extern int TryGetReadback(uint id, IntPtr dest, int destSize);
 
     [DllImport("RenderingPlugin")]
     private static extern IntPtr GetRenderEventFunc();
 
     [DllImport("RenderingPlugin")]
-    private static extern IntPtr CreateExternalVkImageForUnityTexture2D(int width, int height);
+    private static extern IntPtr GetRenderEventAndDataFunc();
+
+    [DllImport("RenderingPlugin")]
+    private static extern uint GetFlushCount();
+
+    [DllImport("RenderingPlugin")]
+    private static extern uint CreateExternalImage(int width, int height);
+
+    [DllImport("RenderingPlugin")]
+    private static extern IntPtr GetExternalImageNativePtr(uint handle);
+
+    [DllImport("RenderingPlugin")]
+    [return: MarshalAs(UnmanagedType.I1)]
+    private static extern bool IsVulkanReady();
+
+    [DllImport("RenderingPlugin")]
+    private static extern float GetVulkanTimeToReadyMs();
+
+    [DllImport("RenderingPlugin")]
+    private static extern int GetVulkanBringUpState();
+
+    // Mirrors VulkanBringUpState in RenderingPlugin.cpp
+    private const int kVulkanBringUp_None = 0;
+    private const int kVulkanBringUp_Pending = 1;
+    private const int kVulkanBringUp_Ready = 2;
+    private const int kVulkanBringUp_Failed = 3;
+
+    // Event IDs, see PluginEventID in RenderingPlugin.cpp
+    private const int kPluginEvent_Frame = 2;
+    private const int kPluginEvent_Flush = 3;
+    // How long OnDestroy waits for the flush before leaving its memory allocated
+    private const int kFlushTimeoutMs = 2000;
+
+    // Mirrors PluginEventData in RenderingPlugin.cpp
+    [StructLayout(LayoutKind.Sequential)]
+    private struct PluginEventData {
+        public int size;
+        public int hasVulkanConfig;
+        public int vulkanRenderPassPrecondition;
+        public int vulkanGraphicsQueueAccess;
+        public uint vulkanFlags;
+    }
+
+    // The render thread reads a payload up to a couple of frames after it was issued,
+    // so each frame writes the next one in a small ring instead of reusing one
+    private const int kEventPayloadCount = 4;
+    private IntPtr[] eventPayloads;
+    private int nextEventPayload = 0;
+    private CommandBuffer pluginCommands;
+
+    // Command ring shared with the plugin; layout and command structs mirror CommandRing.h.
+    // Commands are written straight into plugin memory and published once per frame, then
+    // the frame event runs them all on the render thread.
+    private const int kRingCapacityOffset = 0;
+    private const int kRingWritePositionOffset = 64;
+    private const int kRingReadPositionOffset = 128;
+    private const int kRingDataOffset = 192;
+
+    private const uint kPluginCommand_Padding = 0;
+    private const uint kPluginCommand_SetTime = 1;
+    private const uint kPluginCommand_SetTexture = 2;
+    private const uint kPluginCommand_SetMeshBuffers = 3;
+    private const uint kPluginCommand_DestroyExternalImage = 4;
+    private const uint kPluginCommand_SetGenerateMips = 5;
+    private const uint kPluginCommand_SetUploadArena = 6;
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct PluginCommandHeader {
+        public uint type;
+        public uint size;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SetTimeCommand {
+        public PluginCommandHeader header;
+        public float time;
+        public uint padding;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SetTextureCommand {
+        public PluginCommandHeader header;
+        public ulong textureHandle;
+        public int width;
+        public int height;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SetMeshBuffersCommand {
+        public PluginCommandHeader header;
+        public ulong vertexBufferHandle;
+        public ulong positions;
+        public ulong normals;
+        public ulong uvs;
+        public int vertexCount;
+        public uint padding;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct DestroyExternalImageCommand {
+        public PluginCommandHeader header;
+        public uint handle;
+        public uint padding;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SetGenerateMipsCommand {
+        public PluginCommandHeader header;
+        public int enabled;
+        public uint padding;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SetUploadArenaCommand {
+        public PluginCommandHeader header;
+        public ulong memory;
+        public ulong size;
+    }
+
+    // Vulkan profiler frames, only there when the player was started with
+    // RENDERINGPLUGIN_VK_PROFILER=1; layout mirrors VulkanProfiler.h
+    private const int kProfilerCapacityOffset = 0;
+    private const int kProfilerFrameSizeOffset = 4;
+    private const int kProfilerPublishedOffset = 64;
+    private const int kProfilerRenderPassHistogramOffset = 128;
+    private const int kProfilerBarrierHistogramOffset = 192;
+    private const int kProfilerFramesOffset = 256;
+    private const int kProfilerHistogramBuckets = 16;
+    // Frames between two profiler summaries in the log
+    private const int kProfilerReportInterval = 300;
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct VulkanProfilerFrame {
+        public ulong frame;
+        public ulong cpuFrameNs;
+        public ulong submitCpuNs;
+        public ulong maxSubmitCpuNs;
+        public uint submits;
+        public uint submittedCommandBuffers;
+        public uint draws;
+        public uint dispatches;
+        public uint renderPasses;
+        public uint renderPassEnds;
+        public uint pipelineBarriers;
+        public uint barriers;
+    }
+
+    private NativeArray<byte> vulkanProfiler;
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+    private AtomicSafetyHandle vulkanProfilerSafety;
+#endif
+    // Newest profiler frame already summarized
+    private ulong vulkanProfilerReported;
+
+    private NativeArray<byte> commandRing;
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+    private AtomicSafetyHandle commandRingSafety;
+#endif
+    private uint commandRingCapacity;
+    // Ahead of the published write position while a frame's commands are being written
+    private uint commandRingWritePosition;
+
+    // Mesh arrays stay pinned until the render thread has run the command pointing at them
+    private GCHandle[] meshPins;
+    private uint meshPinsReleasePosition;
+
+    // TryGetReadback results, see ReadbackStatus in ReadbackQueue.h
+    private const int kReadback_Failed = -1;
+    private const int kReadback_Pending = 0;
+
+    // Reads the plugin's texture back every so often and logs its average color. Vulkan and
+    // desktop OpenGL only; the data arrives a few frames after the request, nothing waits.
+    public bool logTextureReadback = false;
+    private const int kReadbackInterval = 300;
+    private IntPtr pluginTexturePtr = IntPtr.Zero;
+    private int pluginTextureWidth;
+    private int pluginTextureHeight;
+    private uint textureReadback;
+    private byte[] textureReadbackData;
+
+    // Gives the plugin's texture a mip chain that the plugin rebuilds on the GPU after every
+    // upload. Vulkan, OpenGL Core and OpenGL ES 3 only; read once at start.
+    public bool generateMipsOnUpload = false;
+
+    // Lets the plugin generate its texture and mesh into memory of ours that its Vulkan backend imports,
+    // so uploads are copied by the GPU without a staging buffer. The arena is freed in OnDestroy
+    // once the plugin has let go of it and the GPU is done with it. 4 MB holds the texture and
+    // a mesh of several thousand vertices for every frame the plugin rotates through; bigger
+    // frames are generated into the plugin's own memory instead.
+    public bool uploadFromArena = true;
+    private const int kUploadArenaSize = 4 * 1024 * 1024;
+    // Covers the import granularity of every Vulkan driver
+    private const int kUploadArenaAlignment = 64 * 1024;
+    private IntPtr uploadArenaAllocation = IntPtr.Zero;
+    private IntPtr uploadArena = IntPtr.Zero;
+    private bool uploadArenaSent;
 
     private static RenderTexture renderTex;
     private static Texture2D texture2D;
+    // Plugin handle of the image behind texture2D, 0 when there is none
+    private uint externalImage;
     private static GameObject pluginInfo;
 
     IEnumerator Start() {
-        if (SystemInfo.graphicsDeviceType == GraphicsDeviceType.Direct3D11) {
+        // The plugin brings Vulkan up in the background when it needs a device of its own; don't
+        // hold up the frame waiting for it. Other renderers have nothing to wait for.
+        int vulkanState = GetVulkanBringUpState();
+        while (vulkanState == kVulkanBringUp_Pending) {
+            yield return null;
+            vulkanState = GetVulkanBringUpState();
+        }
+        if (vulkanState == kVulkanBringUp_Ready) {
+            Debug.Log("RenderingPlugin: Vulkan ready " + GetVulkanTimeToReadyMs() + " ms after plugin load");
+        }
+        else if (vulkanState == kVulkanBringUp_Failed) {
+            Debug.LogWarning("RenderingPlugin: Vulkan bring-up failed, using a plain texture");
+        }
+        MapCommandRing();
+        if (uploadFromArena) {
+            SendUploadArenaToPlugin();
+        }
+
+        if (SystemInfo.graphicsDeviceType == GraphicsDeviceType.Direct3D11 && IsVulkanReady()) {
             CreateTexture2DWithVulkanCreatedImage();
         }
+        else {
+            CreateTextureAndPassToPlugin();
+        }
 
         SendMeshBuffersToPlugin();
         yield return StartCoroutine("CallPluginAtEndOfFrames");
@@ -42,15 +269,39 @@ public class UseRenderingPlugin : MonoBehaviour
     // custom "time" for deterministic results
     int updateTimeCounter = 0;
     private IEnumerator CallPluginAtEndOfFrames() {
+        eventPayloads = new IntPtr[kEventPayloadCount];
+        for (int i = 0; i < kEventPayloadCount; ++i) {
+            eventPayloads[i] = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(PluginEventData)));
+        }
+        pluginCommands = new CommandBuffer();
+        pluginCommands.name = "RenderingPlugin";
+
         while (true) {
             // Wait until all frame rendering is done
             yield return new WaitForEndOfFrame();
 
             ++updateTimeCounter;
-            SetTimeFromUnity((float)updateTimeCounter * 0.016f);
+            SetTimeCommand setTime = new SetTimeCommand();
+            setTime.header = CommandHeader<SetTimeCommand>(kPluginCommand_SetTime);
+            setTime.time = (float)updateTimeCounter * 0.016f;
+            WriteCommand(setTime);
+            PublishCommands();
+            ReleaseMeshPinsOnceRead();
+
+            // The plugin keeps its own Vulkan event config
+            PluginEventData data = new PluginEventData();
+            data.size = Marshal.SizeOf(typeof(PluginEventData));
+            IntPtr payload = eventPayloads[nextEventPayload];
+            nextEventPayload = (nextEventPayload + 1) % kEventPayloadCount;
+            Marshal.StructureToPtr(data, payload, false);
 
             // Draw to Texture2D
-            GL.IssuePluginEvent(GetRenderEventFunc(), 2);
+            pluginCommands.Clear();
+            pluginCommands.IssuePluginEventAndData(GetRenderEventAndDataFunc(), kPluginEvent_Frame, payload);
+            Graphics.ExecuteCommandBuffer(pluginCommands);
+
+            ReportVulkanProfiler();
+            PollTextureReadback();
         }
     }
 
@@ -59,8 +310,9 @@ public class UseRenderingPlugin : MonoBehaviour
         int width = 256;
         int height = 256;
 
-        // Native call to retrieve handle of VkImage created by Vulkan and shared with DX11
-        IntPtr externalTexturePtr = CreateExternalVkImageForUnityTexture2D(width, height);
+        // Native call to create a VkImage shared with DX11; the plugin owns it, we get a handle
+        externalImage = CreateExternalImage(width, height);
+        IntPtr externalTexturePtr = GetExternalImageNativePtr(externalImage);
 
         // Create a Texture 2D
         texture2D = Texture2D.CreateExternalTexture(width, height, TextureFormat.RGBA32, false, false, externalTexturePtr);
@@ -82,17 +334,323 @@ public class UseRenderingPlugin : MonoBehaviour
         sphere.GetComponent<Renderer>().material.mainTexture = renderTex;
     }
 
+    private void CreateTextureAndPassToPlugin() {
+        // Create a texture
+        Texture2D tex = new Texture2D(256, 256, TextureFormat.ARGB32, generateMipsOnUpload);
+        // Set point filtering just so we can see the pixels clearly, unless there are mips to blend
+        tex.filterMode = generateMipsOnUpload ? FilterMode.Trilinear : FilterMode.Point;
+        // Call Apply() so it's actually uploaded to the GPU
+        tex.Apply();
+
+        // Set texture onto our material
+        GetComponent<Renderer>().material.mainTexture = tex;
+
+        // Pass texture pointer to the plugin; it animates the pixels from the render event
+        pluginTexturePtr = tex.GetNativeTexturePtr();
+        pluginTextureWidth = tex.width;
+        pluginTextureHeight = tex.height;
+        if (generateMipsOnUpload) {
+            SetGenerateMipsCommand setGenerateMips = new SetGenerateMipsCommand();
+            setGenerateMips.header = CommandHeader<SetGenerateMipsCommand>(kPluginCommand_SetGenerateMips);
+            setGenerateMips.enabled = 1;
+            WriteCommand(setGenerateMips);
+        }
+        SetTextureCommand setTexture = new SetTextureCommand();
+        setTexture.header = CommandHeader<SetTextureCommand>(kPluginCommand_SetTexture);
+        setTexture.textureHandle = (ulong)pluginTexturePtr.ToInt64();
+        setTexture.width = tex.width;
+        setTexture.height = tex.height;
+        WriteCommand(setTexture);
+    }
+
     void OnDisable()  {
-        if (SystemInfo.graphicsDeviceType == GraphicsDeviceType.Direct3D11) {
-            // Signals to the plugin that renderTex will be destroyed
+        if (SystemInfo.graphicsDeviceType == GraphicsDeviceType.Direct3D11 && externalImage != 0) {
+            // Signals to the plugin that the image behind texture2D will be destroyed; it goes
+            // at the next frame event, or with the device if there is none
+            Destroy(texture2D);
+            texture2D = null;
+            DestroyExternalImageCommand destroyImage = new DestroyExternalImageCommand();
+            destroyImage.header = CommandHeader<DestroyExternalImageCommand>(kPluginCommand_DestroyExternalImage);
+            destroyImage.handle = externalImage;
+            WriteCommand(destroyImage);
+            PublishCommands();
+            externalImage = 0;
+        }
+    }
+
+    void OnDestroy() {
+        if (pluginCommands != null) {
+            pluginCommands.Release();
+            pluginCommands = null;
+        }
+        if (uploadArenaSent) {
+            // The plugin goes back to its own memory
+            SetUploadArenaCommand setArena = new SetUploadArenaCommand();
+            setArena.header = CommandHeader<SetUploadArenaCommand>(kPluginCommand_SetUploadArena);
+            WriteCommand(setArena);
+            PublishCommands();
+            uploadArenaSent = false;
+        }
+
+        // Frame events already issued may still point at the payloads, commands not yet drained
+        // at the mesh arrays, and uploads in flight at the arena; a flush issued after all of
+        // them has to complete first. Without one they stay allocated.
+        bool ownsPluginMemory = eventPayloads != null || meshPins != null || uploadArenaAllocation != IntPtr.Zero;
+        if (ownsPluginMemory && !FlushPlugin()) {
+            Debug.LogWarning("RenderingPlugin: flush timed out, leaving the memory the plugin reads allocated");
         }
+        else if (ownsPluginMemory) {
+            if (eventPayloads != null) {
+                foreach (IntPtr payload in eventPayloads) {
+                    Marshal.FreeHGlobal(payload);
+                }
+            }
+            if (meshPins != null) {
+                foreach (GCHandle pin in meshPins) {
+                    pin.Free();
+                }
+            }
+            if (uploadArenaAllocation != IntPtr.Zero) {
+                Marshal.FreeHGlobal(uploadArenaAllocation);
+            }
+        }
+        eventPayloads = null;
+        meshPins = null;
+        uploadArenaAllocation = IntPtr.Zero;
+        uploadArena = IntPtr.Zero;
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+        if (commandRing.IsCreated) {
+            AtomicSafetyHandle.Release(commandRingSafety);
+        }
+#endif
+        // The ring's memory belongs to the plugin
+        commandRing = default(NativeArray<byte>);
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+        if (vulkanProfiler.IsCreated) {
+            AtomicSafetyHandle.Release(vulkanProfilerSafety);
+        }
+#endif
+        vulkanProfiler = default(NativeArray<byte>);
+    }
+
+    private unsafe void MapCommandRing() {
+        int size;
+        IntPtr memory = GetCommandRing(out size);
+        commandRing = NativeArrayUnsafeUtility.ConvertExistingDataToNativeArray<byte>((void*)memory, size, Allocator.None);
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+        commandRingSafety = AtomicSafetyHandle.Create();
+        NativeArrayUnsafeUtility.SetAtomicSafetyHandle(ref commandRing, commandRingSafety);
+#endif
+        commandRingCapacity = commandRing.ReinterpretLoad<uint>(kRingCapacityOffset);
+        commandRingWritePosition = commandRing.ReinterpretLoad<uint>(kRingWritePositionOffset);
+    }
+
+    // NULL until Unity's Vulkan device is up, and always without RENDERINGPLUGIN_VK_PROFILER
+    private unsafe bool MapVulkanProfiler() {
+        if (vulkanProfiler.IsCreated) {
+            return true;
+        }
+        int size;
+        IntPtr memory = GetVulkanProfilerStats(out size);
+        if (memory == IntPtr.Zero) {
+            return false;
+        }
+        vulkanProfiler = NativeArrayUnsafeUtility.ConvertExistingDataToNativeArray<byte>((void*)memory, size, Allocator.None);
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+        vulkanProfilerSafety = AtomicSafetyHandle.Create();
+        NativeArrayUnsafeUtility.SetAtomicSafetyHandle(ref vulkanProfiler, vulkanProfilerSafety);
+#endif
+        Assert.AreEqual(Marshal.SizeOf(typeof(VulkanProfilerFrame)), vulkanProfiler.ReinterpretLoad<int>(kProfilerFrameSizeOffset));
+        return true;
+    }
+
+    // The plugin rewrites the oldest slot while we read; a copy is only good if the slot held
+    // the same frame number before and after it
+    private bool TryReadProfilerFrame(ulong frame, out VulkanProfilerFrame result) {
+        uint capacity = vulkanProfiler.ReinterpretLoad<uint>(kProfilerCapacityOffset);
+        int offset = kProfilerFramesOffset + (int)((frame - 1) & (capacity - 1)) * Marshal.SizeOf(typeof(VulkanProfilerFrame));
+        ulong before = vulkanProfiler.ReinterpretLoad<ulong>(offset);
+        Thread.MemoryBarrier();
+        result = vulkanProfiler.ReinterpretLoad<VulkanProfilerFrame>(offset);
+        Thread.MemoryBarrier();
+        ulong after = vulkanProfiler.ReinterpretLoad<ulong>(offset);
+        return before == frame && after == frame;
+    }
+
+    private void ReportVulkanProfiler() {
+        if (!MapVulkanProfiler()) {
+            return;
+        }
+        ulong published = vulkanProfiler.ReinterpretLoad<ulong>(kProfilerPublishedOffset);
+        Thread.MemoryBarrier();
+        if (published < vulkanProfilerReported + kProfilerReportInterval) {
+            return;
+        }
+
+        // Whatever of the interval is still in the ring; older frames were overwritten
+        uint capacity = vulkanProfiler.ReinterpretLoad<uint>(kProfilerCapacityOffset);
+        ulong first = Math.Max(vulkanProfilerReported + 1, published > capacity ? published - capacity + 1 : 1);
+        ulong frames = 0, cpuFrameNs = 0, submitCpuNs = 0, maxSubmitCpuNs = 0;
+        ulong submits = 0, draws = 0, dispatches = 0, renderPasses = 0, barriers = 0;
+        for (ulong frame = first; frame <= published; ++frame) {
+            VulkanProfilerFrame stats;
+            if (!TryReadProfilerFrame(frame, out stats)) {
+                continue;
+            }
+            ++frames;
+            cpuFrameNs += stats.cpuFrameNs;
+            submitCpuNs += stats.submitCpuNs;
+            maxSubmitCpuNs = Math.Max(maxSubmitCpuNs, stats.maxSubmitCpuNs);
+            submits += stats.submits;
+            draws += stats.draws;
+            dispatches += stats.dispatches;
+            renderPasses += stats.renderPasses;
+            barriers += stats.barriers;
+        }
+        vulkanProfilerReported = published;
+        if (frames == 0) {
+            return;
+        }
+
+        string renderPassHistogram = "", barrierHistogram = "";
+        for (int bucket = 0; bucket < kProfilerHistogramBuckets; ++bucket) {
+            renderPassHistogram += " " + vulkanProfiler.ReinterpretLoad<uint>(kProfilerRenderPassHistogramOffset + bucket * 4);
+            barrierHistogram += " " + vulkanProfiler.ReinterpretLoad<uint>(kProfilerBarrierHistogramOffset + bucket * 4);
+        }
+        Debug.Log(string.Format("RenderingPlugin: Vulkan over {0} frames, per frame {1:F2} ms CPU, {2:F1} submits taking {3:F3} ms (longest {4:F3} ms), "
+            + "{5:F0} draws, {6:F0} dispatches, {7:F1} render passes, {8:F0} barriers\n"
+            + "render passes per frame, log2 buckets:{9}\nbarriers per frame, log2 buckets:{10}",
+            frames, cpuFrameNs / (double)frames * 1e-6, submits / (double)frames, submitCpuNs / (double)frames * 1e-6, maxSubmitCpuNs * 1e-6,
+            draws / (double)frames, dispatches / (double)frames, renderPasses / (double)frames, barriers / (double)frames,
+            renderPassHistogram, barrierHistogram));
+    }
+
+    private unsafe void PollTextureReadback() {
+        if (!logTextureReadback || pluginTexturePtr == IntPtr.Zero) {
+            return;
+        }
+        if (textureReadback == 0) {
+            if (updateTimeCounter % kReadbackInterval == 0) {
+                textureReadback = RequestReadback(pluginTexturePtr, 0, 0, pluginTextureWidth, pluginTextureHeight);
+            }
+            return;
+        }
+
+        if (textureReadbackData == null) {
+            textureReadbackData = new byte[pluginTextureWidth * pluginTextureHeight * 4];
+        }
+        int status;
+        fixed (byte* dest = textureReadbackData) {
+            status = TryGetReadback(textureReadback, (IntPtr)dest, textureReadbackData.Length);
+        }
+        if (status == kReadback_Pending) {
+            return;
+        }
+        textureReadback = 0;
+        if (status == kReadback_Failed) {
+            Debug.LogWarning("RenderingPlugin: texture readback failed");
+            return;
+        }
+
+        ulong r = 0, g = 0, b = 0, a = 0;
+        for (int i = 0; i < textureReadbackData.Length; i += 4) {
+            r += textureReadbackData[i];
+            g += textureReadbackData[i + 1];
+            b += textureReadbackData[i + 2];
+            a += textureReadbackData[i + 3];
+        }
+        ulong texels = (ulong)(textureReadbackData.Length / 4);
+        Debug.Log(string.Format("RenderingPlugin: texture readback, average texel bytes {0} {1} {2} {3}", r / texels, g / texels, b / texels, a / texels));
+    }
+
+    private static PluginCommandHeader CommandHeader<T>(uint type) where T : struct {
+        PluginCommandHeader header = new PluginCommandHeader();
+        header.type = type;
+        header.size = (uint)UnsafeUtility.SizeOf<T>();
+        return header;
+    }
+
+    // Appends a command for the next PublishCommands. False (and dropped) if the render
+    // thread hasn't freed enough space yet; the script never waits for it.
+    private bool WriteCommand<T>(T command) where T : struct {
+        uint size = (uint)UnsafeUtility.SizeOf<T>();
+        uint offset = commandRingWritePosition & (commandRingCapacity - 1);
+        // Commands never wrap around; pad to the start of the ring instead
+        uint padding = offset + size > commandRingCapacity ? commandRingCapacity - offset : 0;
+        uint read = commandRing.ReinterpretLoad<uint>(kRingReadPositionOffset);
+        if (commandRingWritePosition + padding + size - read > commandRingCapacity) {
+            Debug.LogWarning("RenderingPlugin: command ring full, dropping a command");
+            return false;
+        }
+
+        if (padding != 0) {
+            PluginCommandHeader pad = new PluginCommandHeader();
+            pad.type = kPluginCommand_Padding;
+            pad.size = padding;
+            commandRing.ReinterpretStore(kRingDataOffset + (int)offset, pad);
+            commandRingWritePosition += padding;
+            offset = 0;
+        }
+        commandRing.ReinterpretStore(kRingDataOffset + (int)offset, command);
+        commandRingWritePosition += size;
+        return true;
+    }
+
+    // Makes everything written since the last call visible to the render thread
+    private void PublishCommands() {
+        // The command bytes must land before the position that covers them
+        Thread.MemoryBarrier();
+        commandRing.ReinterpretStore(kRingWritePositionOffset, commandRingWritePosition);
+    }
+
+    private void ReleaseMeshPinsOnceRead() {
+        if (meshPins == null) {
+            return;
+        }
+        uint read = commandRing.ReinterpretLoad<uint>(kRingReadPositionOffset);
+        if ((int)(read - meshPinsReleasePosition) >= 0) {
+            foreach (GCHandle pin in meshPins) {
+                pin.Free();
+            }
+            meshPins = null;
+        }
+    }
+
+    // Runs the commands published so far on the render thread and waits until the GPU has
+    // finished everything issued before, so memory the plugin read can be freed. False if
+    // that didn't happen within kFlushTimeoutMs (no render thread or device left).
+    private bool FlushPlugin() {
+        uint target = GetFlushCount() + 1;
+        GL.IssuePluginEvent(GetRenderEventFunc(), kPluginEvent_Flush);
+        GL.Flush();
+        System.Diagnostics.Stopwatch waited = System.Diagnostics.Stopwatch.StartNew();
+        while ((int)(GetFlushCount() - target) < 0) {
+            if (waited.ElapsedMilliseconds > kFlushTimeoutMs) {
+                return false;
+            }
+            Thread.Sleep(1);
+        }
+        return true;
+    }
+
+    private void SendUploadArenaToPlugin() {
+        if (uploadArena == IntPtr.Zero) {
+            uploadArenaAllocation = Marshal.AllocHGlobal(kUploadArenaSize + kUploadArenaAlignment);
+            long aligned = (uploadArenaAllocation.ToInt64() + kUploadArenaAlignment - 1) & ~(long)(kUploadArenaAlignment - 1);
+            uploadArena = new IntPtr(aligned);
+        }
+        SetUploadArenaCommand setArena = new SetUploadArenaCommand();
+        setArena.header = CommandHeader<SetUploadArenaCommand>(kPluginCommand_SetUploadArena);
+        setArena.memory = (ulong)uploadArena.ToInt64();
+        setArena.size = kUploadArenaSize;
+        uploadArenaSent = WriteCommand(setArena);
     }
 
     private void SendMeshBuffersToPlugin()  {
         var filter = GetComponent<MeshFilter>();
         var mesh = filter.mesh;
 
-        // This is equivalent to MeshVertex in RenderingPlugin.cpp
+        // This is equivalent to MeshVertex in HeightfieldKernel.h
         var desiredVertexLayout = new[]  {
             new VertexAttributeDescriptor(VertexAttribute.Position, VertexAttributeFormat.Float32, 3),
             new VertexAttributeDescriptor(VertexAttribute.Normal, VertexAttributeFormat.Float32, 3),
@@ -116,14 +674,26 @@ public class UseRenderingPlugin : MonoBehaviour
         var vertices = mesh.vertices;
         var normals = mesh.normals;
         var uvs = mesh.uv;
+        // The plugin reads them on the render thread, so they stay pinned until it has.
         GCHandle gcVertices = GCHandle.Alloc(vertices, GCHandleType.Pinned);
         GCHandle gcNormals = GCHandle.Alloc(normals, GCHandleType.Pinned);
         GCHandle gcUV = GCHandle.Alloc(uvs, GCHandleType.Pinned);
 
-        SetMeshBuffersFromUnity(mesh.GetNativeVertexBufferPtr(0), mesh.vertexCount, gcVertices.AddrOfPinnedObject(), gcNormals.AddrOfPinnedObject(), gcUV.AddrOfPinnedObject());
-
-        gcVertices.Free();
-        gcNormals.Free();
-        gcUV.Free();
+        SetMeshBuffersCommand setMesh = new SetMeshBuffersCommand();
+        setMesh.header = CommandHeader<SetMeshBuffersCommand>(kPluginCommand_SetMeshBuffers);
+        setMesh.vertexBufferHandle = (ulong)mesh.GetNativeVertexBufferPtr(0).ToInt64();
+        setMesh.positions = (ulong)gcVertices.AddrOfPinnedObject().ToInt64();
+        setMesh.normals = (ulong)gcNormals.AddrOfPinnedObject().ToInt64();
+        setMesh.uvs = (ulong)gcUV.AddrOfPinnedObject().ToInt64();
+        setMesh.vertexCount = mesh.vertexCount;
+        if (WriteCommand(setMesh)) {
+            meshPins = new[] { gcVertices, gcNormals, gcUV };
+            meshPinsReleasePosition = commandRingWritePosition;
+        }
+        else {
+            gcVertices.Free();
+            gcNormals.Free();
+            gcUV.Free();
+        }
     }
 }